@@ -0,0 +1,173 @@
+#include <QCoreApplication>
+#include <QDate>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSharedPointer>
+#include <QTemporaryDir>
+#include <QVector>
+#include "controllers/FitnessPlanStore.h"
+#include "controllers/FitnessSnapshot.h"
+#include "controllers/FitnessSqlStore.h"
+
+// Fitness storage benchmark: the binary snapshot with its in-memory
+// store against the SQLite store, at growing plan counts. Built only
+// with -DDESKTOPELF_BENCHMARKS=ON.
+//
+//   FitnessStoreBenchmark [plan counts...]   (default 1000 100000 1000000)
+//
+// Per size: bulk write, cold open, one month query on the cold store,
+// and 1000 random single-day count lookups.
+
+namespace {
+const int kPlansPerDay = 3;
+const int kLookups = 1000;
+
+QVector<FitnessDay> generate(int planCount, qint64 lastDay)
+{
+    QVector<FitnessDay> days;
+    const int dayCount = (planCount + kPlansPerDay - 1) / kPlansPerDay;
+    days.reserve(dayCount);
+    int remaining = planCount;
+    for (int d = 0; d < dayCount; ++d) {
+        FitnessDay day(lastDay - dayCount + 1 + d);
+        for (int p = 0; p < kPlansPerDay && remaining > 0; ++p, --remaining) {
+            FitnessPlan plan(QStringLiteral("Plan %1").arg(p), QStringLiteral("Benchmark plan"));
+            plan.completed = (d + p) % 2 == 0;
+            day.plans.append(plan);
+        }
+        days.append(day);
+    }
+    return days;
+}
+
+struct Result {
+    qint64 writeMs = 0;
+    qint64 openMs = 0;
+    qint64 monthMs = 0;
+    qint64 lookupsMs = 0;
+    int monthDays = 0;
+};
+
+Result benchFile(const QString &path, const FitnessPlanStore &store, const QVector<qint64> &lookups, const QDate &month)
+{
+    Result result;
+    QElapsedTimer timer;
+
+    timer.start();
+    FitnessSnapshot::write(path, store, 0);
+    result.writeMs = timer.elapsed();
+
+    timer.restart();
+    QSharedPointer<FitnessSnapshot> snapshot(new FitnessSnapshot);
+    FitnessPlanStore loaded;
+    if (!snapshot->open(path)) {
+        qWarning() << "Failed to open snapshot:" << snapshot->errorString();
+        return result;
+    }
+    loaded.attachSnapshot(snapshot);
+    result.openMs = timer.elapsed();
+
+    timer.restart();
+    result.monthDays = loaded.month(month.year(), month.month()).size();
+    result.monthMs = timer.elapsed();
+
+    timer.restart();
+    int total = 0;
+    for (qint64 day : lookups) {
+        total += loaded.totalCount(day);
+    }
+    result.lookupsMs = timer.elapsed();
+    Q_UNUSED(total)
+    return result;
+}
+
+Result benchSql(const QString &path, const FitnessPlanStore &store, const QVector<qint64> &lookups, const QDate &month)
+{
+    Result result;
+    QElapsedTimer timer;
+
+    timer.start();
+    {
+        FitnessSqlStore database(path);
+        if (!database.open() || !database.migrateFrom(store)) {
+            qWarning() << "Failed to populate database:" << path;
+            return result;
+        }
+    }
+    result.writeMs = timer.elapsed();
+
+    timer.restart();
+    FitnessSqlStore database(path);
+    if (!database.open()) {
+        return result;
+    }
+    result.openMs = timer.elapsed();
+
+    timer.restart();
+    result.monthDays = database.range(month.toJulianDay(), month.addMonths(1).toJulianDay() - 1).size();
+    result.monthMs = timer.elapsed();
+
+    timer.restart();
+    int completed = 0;
+    int total = 0;
+    for (qint64 day : lookups) {
+        database.counts(day, &completed, &total);
+    }
+    result.lookupsMs = timer.elapsed();
+    return result;
+}
+
+void print(const char *backend, int planCount, const Result &result)
+{
+    qInfo().noquote() << QString("%1 %2  write %3 ms  open %4 ms  month (%5 days) %6 ms  %7 lookups %8 ms")
+                             .arg(QLatin1String(backend), -7)
+                             .arg(planCount, 8)
+                             .arg(result.writeMs, 6)
+                             .arg(result.openMs, 5)
+                             .arg(result.monthDays)
+                             .arg(result.monthMs, 4)
+                             .arg(kLookups)
+                             .arg(result.lookupsMs, 5);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QVector<int> sizes;
+    for (const QString &argument : app.arguments().mid(1)) {
+        if (argument.toInt() > 0) {
+            sizes.append(argument.toInt());
+        }
+    }
+    if (sizes.isEmpty()) {
+        sizes = { 1000, 100000, 1000000 };
+    }
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qCritical() << "Cannot create a temporary directory";
+        return 1;
+    }
+
+    const QDate today = QDate::currentDate();
+    const QDate month(today.year(), today.month(), 1);
+    for (int planCount : sizes) {
+        FitnessPlanStore store;
+        store.assign(generate(planCount, today.toJulianDay()));
+
+        QVector<qint64> lookups;
+        lookups.reserve(kLookups);
+        const int span = store.dayCount();
+        for (int i = 0; i < kLookups; ++i) {
+            lookups.append(today.toJulianDay() - QRandomGenerator::global()->bounded(span));
+        }
+
+        const QString name = QString::number(planCount);
+        print("file", planCount, benchFile(dir.filePath(name + ".bin"), store, lookups, month));
+        print("sqlite", planCount, benchSql(dir.filePath(name + ".sqlite"), store, lookups, month));
+    }
+    return 0;
+}
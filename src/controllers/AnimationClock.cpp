@@ -0,0 +1,235 @@
+#include "AnimationClock.h"
+#include "WakeupMonitor.h"
+#include <QQuickWindow>
+#include <QScreen>
+#include <QtMath>
+#include <algorithm>
+#include <QDebug>
+
+AnimationClock::AnimationClock(QObject *parent)
+    : QObject(parent)
+    , m_fallbackTimer(new QTimer(this))
+    , m_tickTimer(new QTimer(this))
+    , m_tickPending(false)
+    , m_users(0)
+    , m_lastTick(-1)
+    , m_ticks(0)
+    , m_lateTicks(0)
+    , m_droppedFrames(0)
+    , m_totalLateness(0)
+    , m_maxLateness(0)
+{
+    m_time.start();
+
+    // Used only while no visible window drives the clock
+    m_fallbackTimer->setTimerType(Qt::PreciseTimer);
+    m_fallbackTimer->setSingleShot(true);
+    connect(m_fallbackTimer, &QTimer::timeout, this, [this]() {
+        WakeupMonitor::instance()->record("animationClock.fallbackTimer");
+        onFrame();
+    });
+
+    m_tickTimer->setTimerType(Qt::PreciseTimer);
+    m_tickTimer->setSingleShot(true);
+    connect(m_tickTimer, &QTimer::timeout, this, &AnimationClock::onTickTimer);
+}
+
+AnimationClock::~AnimationClock()
+{
+}
+
+void AnimationClock::attachWindow(QQuickWindow *window)
+{
+    if (m_window == window) {
+        return;
+    }
+
+    if (m_window) {
+        disconnect(m_window, nullptr, this, nullptr);
+    }
+
+    m_window = window;
+
+    if (m_window) {
+        // afterAnimating is emitted on the GUI thread once per rendered frame
+        connect(m_window, &QQuickWindow::afterAnimating, this, [this]() {
+            WakeupMonitor::instance()->record("renderLoop.frame");
+            onFrame();
+        });
+        connect(m_window, &QWindow::visibleChanged, this, &AnimationClock::onWindowVisibleChanged);
+        qDebug() << "Animation clock attached to window, refresh interval:" << frameInterval() << "ms";
+    }
+
+    if (isRunning()) {
+        scheduleNextFrame();
+    }
+}
+
+QQuickWindow *AnimationClock::window() const
+{
+    return m_window;
+}
+
+qint64 AnimationClock::now() const
+{
+    return m_time.elapsed();
+}
+
+bool AnimationClock::isRunning() const
+{
+    return m_users > 0;
+}
+
+void AnimationClock::acquire()
+{
+    if (m_users++ == 0) {
+        m_lastTick = -1;
+        scheduleNextFrame();
+        emit runningChanged();
+    }
+}
+
+void AnimationClock::requestTick(QObject *subscriber, qint64 time)
+{
+    m_tickRequests.insert(subscriber, time);
+    armTickTimer();
+}
+
+void AnimationClock::cancelTick(QObject *subscriber)
+{
+    if (m_tickRequests.remove(subscriber) > 0) {
+        armTickTimer();
+    }
+}
+
+void AnimationClock::release()
+{
+    if (m_users == 0) {
+        qWarning() << "AnimationClock released more often than acquired";
+        return;
+    }
+
+    if (--m_users == 0) {
+        m_fallbackTimer->stop();
+        emit runningChanged();
+    }
+}
+
+QVariantMap AnimationClock::latencyStats() const
+{
+    QVariantMap stats;
+    stats["ticks"] = m_ticks;
+    stats["lateTicks"] = m_lateTicks;
+    stats["droppedFrames"] = m_droppedFrames;
+    stats["maxLatenessMs"] = m_maxLateness;
+    stats["averageLatenessMs"] = m_ticks > 0 ? qreal(m_totalLateness) / m_ticks : 0.0;
+    stats["frameIntervalMs"] = frameInterval();
+    return stats;
+}
+
+void AnimationClock::resetLatencyStats()
+{
+    m_ticks = 0;
+    m_lateTicks = 0;
+    m_droppedFrames = 0;
+    m_totalLateness = 0;
+    m_maxLateness = 0;
+}
+
+void AnimationClock::onFrame()
+{
+    const bool requested = m_tickPending;
+    m_tickPending = false;
+    if (!isRunning() && !requested) {
+        return;
+    }
+
+    const qint64 current = now();
+
+    // Record how far past the expected refresh this tick arrived; only
+    // vsync-driven ticks are expected every refresh
+    if (!isRunning()) {
+        m_lastTick = -1;
+    } else if (m_lastTick >= 0) {
+        const qreal interval = frameInterval();
+        const qint64 lateness = qMax<qint64>(0, qRound64((current - m_lastTick) - interval));
+
+        ++m_ticks;
+        m_totalLateness += lateness;
+        m_maxLateness = qMax(m_maxLateness, lateness);
+        if (lateness > interval / 2) {
+            ++m_lateTicks;
+            m_droppedFrames += quint64(qFloor((lateness + interval / 2) / interval));
+        }
+    }
+    m_lastTick = current;
+
+    emit tick(current);
+
+    // Subscribers may have released the clock during tick()
+    if (isRunning()) {
+        scheduleNextFrame();
+    }
+}
+
+void AnimationClock::onWindowVisibleChanged()
+{
+    if (isRunning()) {
+        scheduleNextFrame();
+    }
+}
+
+void AnimationClock::armTickTimer()
+{
+    if (m_tickRequests.isEmpty()) {
+        m_tickTimer->stop();
+        return;
+    }
+
+    const qint64 earliest = *std::min_element(m_tickRequests.cbegin(), m_tickRequests.cend());
+    m_tickTimer->start(int(qBound<qint64>(0, earliest - now(), 60 * 1000)));
+}
+
+void AnimationClock::onTickTimer()
+{
+    WakeupMonitor::instance()->record("animationClock.frameTimer");
+
+    // Requests that are due are served by this tick; their owners ask again
+    const qint64 current = now();
+    for (auto it = m_tickRequests.begin(); it != m_tickRequests.end();) {
+        if (it.value() <= current) {
+            it = m_tickRequests.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    armTickTimer();
+
+    // One rendered frame carries the tick, so the new sprite frame is
+    // presented on the next vsync; without a window tick directly
+    m_tickPending = true;
+    if (m_window && m_window->isVisible()) {
+        m_window->update();
+    } else {
+        onFrame();
+    }
+}
+
+void AnimationClock::scheduleNextFrame()
+{
+    if (m_window && m_window->isVisible()) {
+        m_fallbackTimer->stop();
+        m_window->update();
+    } else if (!m_fallbackTimer->isActive()) {
+        m_fallbackTimer->start(qCeil(frameInterval()));
+    }
+}
+
+qreal AnimationClock::frameInterval() const
+{
+    qreal refreshRate = 60.0;
+    if (m_window && m_window->screen() && m_window->screen()->refreshRate() > 1.0) {
+        refreshRate = m_window->screen()->refreshRate();
+    }
+    return 1000.0 / refreshRate;
+}
@@ -0,0 +1,82 @@
+#ifndef ANIMATIONCLOCK_H
+#define ANIMATIONCLOCK_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+#include <QVariantMap>
+
+class QQuickWindow;
+
+// Shared animation time base driven by the Qt Quick render loop.
+// While it has users, every rendered frame of the attached window emits
+// tick() and schedules the next frame, so ticks land on vsync. Without a
+// visible window a precise fallback timer keeps time instead.
+//
+// Frame loops do not need vsync: a GIF frame lasts tens of milliseconds.
+// They call requestTick() with their next frame boundary instead; one
+// single-shot timer waits for the earliest request and asks the window
+// for one frame, whose tick() reaches every subscriber.
+class AnimationClock : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+
+public:
+    explicit AnimationClock(QObject *parent = nullptr);
+    ~AnimationClock();
+
+    void attachWindow(QQuickWindow *window);
+    QQuickWindow *window() const;
+
+    // Milliseconds on the monotonic clock
+    qint64 now() const;
+    bool isRunning() const;
+
+    // Reference counted subscription; the clock only ticks while used
+    void acquire();
+    void release();
+
+    // One tick at or after time (now() based) for this subscriber; a new
+    // request replaces its previous one
+    void requestTick(QObject *subscriber, qint64 time);
+    void cancelTick(QObject *subscriber);
+
+    // Per-tick lateness against the display refresh interval
+    Q_INVOKABLE QVariantMap latencyStats() const;
+    Q_INVOKABLE void resetLatencyStats();
+
+signals:
+    void tick(qint64 now);
+    void runningChanged();
+
+private slots:
+    void onFrame();
+    void onWindowVisibleChanged();
+
+private:
+    void scheduleNextFrame();
+    void armTickTimer();
+    void onTickTimer();
+    qreal frameInterval() const;
+
+    QPointer<QQuickWindow> m_window;
+    QTimer *m_fallbackTimer;
+    QTimer *m_tickTimer;                   // For the earliest requestTick()
+    QHash<QObject *, qint64> m_tickRequests;
+    bool m_tickPending;                    // A requested tick waits for its frame
+    QElapsedTimer m_time;
+    int m_users;
+    qint64 m_lastTick;
+
+    // Lateness accounting
+    quint64 m_ticks;
+    quint64 m_lateTicks;
+    quint64 m_droppedFrames;
+    qint64 m_totalLateness;
+    qint64 m_maxLateness;
+};
+
+#endif // ANIMATIONCLOCK_H
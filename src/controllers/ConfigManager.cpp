@@ -1,14 +1,24 @@
 #include "ConfigManager.h"
+#include "ConfigSchema.h"
 #include <QStandardPaths>
 #include <QDir>
 #include <QFile>
-#include <QJsonArray>
+#include <QFileInfo>
 #include <QFileDialog>
 #include <QDebug>
 #include <QCoreApplication>
 
+SpriteConfig::SpriteConfig()
+    : backgroundOpacity(0)
+    , stayOnTop(false)
+{
+    ConfigSchema::applyDefaults(*this);
+}
+
 ConfigManager::ConfigManager(QObject *parent)
     : QObject(parent)
+    , m_updateDepth(0)
+    , m_changedFields(0)
 {
     // Set config file path
     QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
@@ -17,11 +27,29 @@ ConfigManager::ConfigManager(QObject *parent)
     
     // Load existing config or create default
     loadConfig();
+
+    // Editors save in bursts (truncate, write, rename); reload after the last
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(300);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &ConfigManager::reloadChangedFile);
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, [this]() {
+        m_reloadTimer.start();
+    });
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, [this]() {
+        // A replaced file drops off the watch list; catch it coming back
+        if (!m_watcher.files().contains(m_configFilePath) && QFile::exists(m_configFilePath)) {
+            m_reloadTimer.start();
+        }
+    });
+    watchConfigFile();
 }
 
 ConfigManager::~ConfigManager()
 {
     saveConfig();
+    if (m_persistenceWorker) {
+        m_persistenceWorker->flush();
+    }
 }
 
 QString ConfigManager::defaultImagePath() const
@@ -64,12 +92,21 @@ bool ConfigManager::stayOnTop() const
     return m_config.stayOnTop;
 }
 
+bool ConfigManager::fitnessReminderEnabled() const
+{
+    return m_config.fitnessReminderEnabled;
+}
+
+int ConfigManager::fitnessDailyGoal() const
+{
+    return m_config.fitnessDailyGoal;
+}
+
 void ConfigManager::setDefaultImagePath(const QString &path)
 {
     if (m_config.defaultImagePath != path) {
         m_config.defaultImagePath = path;
-        emit configChanged();
-        emit spriteImagePathChanged(path);
+        markChanged(DefaultImagePathField);
     }
 }
 
@@ -77,8 +114,7 @@ void ConfigManager::setMoveAnimationPaths(const QStringList &paths)
 {
     if (m_config.moveAnimationPaths != paths) {
         m_config.moveAnimationPaths = paths;
-        emit configChanged();
-        emit moveAnimationPathChanged(paths);
+        markChanged(MoveAnimationPathsField);
     }
 }
 
@@ -86,8 +122,7 @@ void ConfigManager::setJumpAnimationPaths(const QStringList &paths)
 {
     if (m_config.jumpAnimationPaths != paths) {
         m_config.jumpAnimationPaths = paths;
-        emit configChanged();
-        emit jumpAnimationPathChanged(paths);
+        markChanged(JumpAnimationPathsField);
     }
 }
 
@@ -95,8 +130,7 @@ void ConfigManager::setTargetPosition(const QPoint &position)
 {
     if (m_config.targetPosition != position) {
         m_config.targetPosition = position;
-        emit configChanged();
-        emit positionChanged(position);
+        markChanged(TargetPositionField);
     }
 }
 
@@ -104,7 +138,7 @@ void ConfigManager::setBackgroundColor(const QColor &color)
 {
     if (m_config.backgroundColor != color) {
         m_config.backgroundColor = color;
-        emit configChanged();
+        markChanged(BackgroundColorField);
     }
 }
 
@@ -112,7 +146,7 @@ void ConfigManager::setBackgroundOpacity(int opacity)
 {
     if (m_config.backgroundOpacity != opacity) {
         m_config.backgroundOpacity = opacity;
-        emit configChanged();
+        markChanged(BackgroundOpacityField);
     }
 }
 
@@ -120,7 +154,7 @@ void ConfigManager::setFontColor(const QColor &color)
 {
     if (m_config.fontColor != color) {
         m_config.fontColor = color;
-        emit configChanged();
+        markChanged(FontColorField);
     }
 }
 
@@ -128,8 +162,121 @@ void ConfigManager::setStayOnTop(bool stayOnTop)
 {
     if (m_config.stayOnTop != stayOnTop) {
         m_config.stayOnTop = stayOnTop;
-        emit configChanged();
+        markChanged(StayOnTopField);
+    }
+}
+
+void ConfigManager::setFitnessReminderEnabled(bool enabled)
+{
+    if (m_config.fitnessReminderEnabled != enabled) {
+        m_config.fitnessReminderEnabled = enabled;
+        markChanged(FitnessReminderEnabledField);
+    }
+}
+
+void ConfigManager::setFitnessDailyGoal(int goal)
+{
+    if (m_config.fitnessDailyGoal != goal) {
+        m_config.fitnessDailyGoal = goal;
+        markChanged(FitnessDailyGoalField);
+    }
+}
+
+void ConfigManager::beginUpdate()
+{
+    ++m_updateDepth;
+}
+
+void ConfigManager::commit()
+{
+    if (m_updateDepth == 0 || --m_updateDepth > 0) {
+        return;
+    }
+
+    const int fields = m_changedFields;
+    m_changedFields = 0;
+    emitChanged(fields);
+}
+
+void ConfigManager::markChanged(Field field)
+{
+    if (m_updateDepth > 0) {
+        m_changedFields |= field;
+    } else {
+        emitChanged(field);
+    }
+}
+
+void ConfigManager::emitChanged(int fields)
+{
+    if (fields == 0) {
+        return;
+    }
+
+    if (fields & DefaultImagePathField) {
+        emit spriteImagePathChanged(m_config.defaultImagePath);
+    }
+    if (fields & MoveAnimationPathsField) {
+        emit moveAnimationPathChanged(m_config.moveAnimationPaths);
+    }
+    if (fields & JumpAnimationPathsField) {
+        emit jumpAnimationPathChanged(m_config.jumpAnimationPaths);
+    }
+    if (fields & TargetPositionField) {
+        emit positionChanged(m_config.targetPosition);
+    }
+    if (fields & BackgroundColorField) {
+        emit backgroundColorChanged(m_config.backgroundColor);
+    }
+    if (fields & BackgroundOpacityField) {
+        emit backgroundOpacityChanged(m_config.backgroundOpacity);
+    }
+    if (fields & FontColorField) {
+        emit fontColorChanged(m_config.fontColor);
+    }
+    if (fields & StayOnTopField) {
+        emit stayOnTopChanged(m_config.stayOnTop);
+    }
+    if (fields & FitnessReminderEnabledField) {
+        emit fitnessReminderEnabledChanged(m_config.fitnessReminderEnabled);
+    }
+    if (fields & FitnessDailyGoalField) {
+        emit fitnessDailyGoalChanged(m_config.fitnessDailyGoal);
+    }
+    emit configChanged();
+}
+
+void ConfigManager::applyConfig(const SpriteConfig &config)
+{
+    beginUpdate();
+    setDefaultImagePath(config.defaultImagePath);
+    setMoveAnimationPaths(config.moveAnimationPaths);
+    setJumpAnimationPaths(config.jumpAnimationPaths);
+    setTargetPosition(config.targetPosition);
+    setBackgroundColor(config.backgroundColor);
+    setBackgroundOpacity(config.backgroundOpacity);
+    setFontColor(config.fontColor);
+    setStayOnTop(config.stayOnTop);
+    setFitnessReminderEnabled(config.fitnessReminderEnabled);
+    setFitnessDailyGoal(config.fitnessDailyGoal);
+    commit();
+}
+
+SpriteConfig ConfigManager::shippedDefaults()
+{
+    SpriteConfig config;
+
+    // Packagers can change defaults in the resource without a rebuild
+    QFile file(":/resources/config/default_config.json");
+    if (file.open(QIODevice::ReadOnly)) {
+        const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+        if (doc.isObject()) {
+            ConfigSchema::fromJson(doc.object(), config);
+        } else {
+            qWarning() << "Invalid bundled default config";
+        }
     }
+    return config;
 }
 
 SpriteConfig ConfigManager::getConfig() const
@@ -137,15 +284,37 @@ SpriteConfig ConfigManager::getConfig() const
     return m_config;
 }
 
+void ConfigManager::setPersistenceWorker(PersistenceWorker *worker)
+{
+    m_persistenceWorker = worker;
+}
+
+int ConfigManager::reloadDelay() const
+{
+    return m_reloadTimer.interval();
+}
+
+void ConfigManager::setReloadDelay(int ms)
+{
+    m_reloadTimer.setInterval(qMax(0, ms));
+}
+
 void ConfigManager::saveConfig()
 {
-    QJsonObject json = configToJson();
-    QJsonDocument doc(json);
-    
-    QFile file(m_configFilePath);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson());
-        file.close();
+    // The JSON object is an implicitly shared snapshot; later edits detach
+    const QJsonObject json = configToJson();
+    const QString path = m_configFilePath;
+    m_lastSavedJson = json;
+
+    if (m_persistenceWorker) {
+        m_persistenceWorker->schedule(path, [path, json]() {
+            return PersistenceWorker::writeFile(path, QJsonDocument(json).toJson());
+        });
+        emit configSaved();
+        return;
+    }
+
+    if (PersistenceWorker::writeFile(path, QJsonDocument(json).toJson()) >= 0) {
         emit configSaved();
         qDebug() << "Config saved to:" << m_configFilePath;
     } else {
@@ -163,6 +332,7 @@ void ConfigManager::loadConfig()
         QJsonDocument doc = QJsonDocument::fromJson(data);
         if (!doc.isNull() && doc.isObject()) {
             configFromJson(doc.object());
+            m_lastSavedJson = doc.object();
             emit configLoaded();
             qDebug() << "Config loaded from:" << m_configFilePath;
         } else {
@@ -177,8 +347,7 @@ void ConfigManager::loadConfig()
 
 void ConfigManager::resetToDefaults()
 {
-    m_config = SpriteConfig(); // Use default constructor
-    emit configChanged();
+    applyConfig(shippedDefaults());
     saveConfig();
 }
 
@@ -212,7 +381,7 @@ void ConfigManager::selectMoveAnimationFiles()
         nullptr,
         tr("Select Move Animation Images"),
         "",
-        tr("Image Files (*.png *.jpg *.jpeg *.bmp)")
+        tr("Image Files (*.png *.jpg *.jpeg *.bmp);;Sprite Sheets (*.elfsheet)")
     );
     
     if (!fileNames.isEmpty()) {
@@ -226,7 +395,7 @@ void ConfigManager::selectJumpAnimationFiles()
         nullptr,
         tr("Select Jump Animation Images"),
         "",
-        tr("Image Files (*.png *.jpg *.jpeg *.bmp)")
+        tr("Image Files (*.png *.jpg *.jpeg *.bmp);;Sprite Sheets (*.elfsheet)")
     );
     
     if (!fileNames.isEmpty()) {
@@ -234,6 +403,43 @@ void ConfigManager::selectJumpAnimationFiles()
     }
 }
 
+void ConfigManager::watchConfigFile()
+{
+    const QString directory = QFileInfo(m_configFilePath).absolutePath();
+    if (!m_watcher.directories().contains(directory)) {
+        m_watcher.addPath(directory);
+    }
+    if (!m_watcher.files().contains(m_configFilePath) && QFile::exists(m_configFilePath)) {
+        m_watcher.addPath(m_configFilePath);
+    }
+}
+
+void ConfigManager::reloadChangedFile()
+{
+    // Replacing the file (QSaveFile, most editors) ends the old watch
+    watchConfigFile();
+
+    QFile file(m_configFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    // Half-written or broken files keep the current settings, unlike at startup
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) {
+        qWarning() << "Ignoring invalid config file change:" << m_configFilePath;
+        return;
+    }
+    if (doc.object() == m_lastSavedJson) {
+        return;
+    }
+
+    configFromJson(doc.object());
+    m_lastSavedJson = doc.object();
+    emit configLoaded();
+    qDebug() << "Config reloaded from:" << m_configFilePath;
+}
+
 QString ConfigManager::getConfigFilePath() const
 {
     return m_configFilePath;
@@ -241,84 +447,13 @@ QString ConfigManager::getConfigFilePath() const
 
 QJsonObject ConfigManager::configToJson() const
 {
-    QJsonObject json;
-    json["version"] = "1.0";
-    
-    QJsonObject sprite;
-    sprite["defaultImagePath"] = m_config.defaultImagePath;
-    sprite["moveAnimationPaths"] = QJsonArray::fromStringList(m_config.moveAnimationPaths);
-    sprite["jumpAnimationPaths"] = QJsonArray::fromStringList(m_config.jumpAnimationPaths);
-    
-    QJsonObject targetPos;
-    targetPos["x"] = m_config.targetPosition.x();
-    targetPos["y"] = m_config.targetPosition.y();
-    sprite["targetPosition"] = targetPos;
-    
-    json["sprite"] = sprite;
-    
-    QJsonObject ui;
-    ui["backgroundColor"] = m_config.backgroundColor.name();
-    ui["backgroundOpacity"] = m_config.backgroundOpacity;
-    ui["fontColor"] = m_config.fontColor.name();
-    ui["stayOnTop"] = m_config.stayOnTop;
-    
-    json["ui"] = ui;
-    
-    return json;
+    return ConfigSchema::toJson(m_config);
 }
 
 void ConfigManager::configFromJson(const QJsonObject &json)
 {
-    // Load sprite settings
-    if (json.contains("sprite") && json["sprite"].isObject()) {
-        QJsonObject sprite = json["sprite"].toObject();
-        
-        if (sprite.contains("defaultImagePath")) {
-            m_config.defaultImagePath = sprite["defaultImagePath"].toString();
-        }
-        
-        if (sprite.contains("moveAnimationPaths") && sprite["moveAnimationPaths"].isArray()) {
-            QJsonArray array = sprite["moveAnimationPaths"].toArray();
-            m_config.moveAnimationPaths.clear();
-            for (const auto &value : array) {
-                m_config.moveAnimationPaths.append(value.toString());
-            }
-        }
-        
-        if (sprite.contains("jumpAnimationPaths") && sprite["jumpAnimationPaths"].isArray()) {
-            QJsonArray array = sprite["jumpAnimationPaths"].toArray();
-            m_config.jumpAnimationPaths.clear();
-            for (const auto &value : array) {
-                m_config.jumpAnimationPaths.append(value.toString());
-            }
-        }
-        
-        if (sprite.contains("targetPosition") && sprite["targetPosition"].isObject()) {
-            QJsonObject pos = sprite["targetPosition"].toObject();
-            m_config.targetPosition = QPoint(pos["x"].toInt(), pos["y"].toInt());
-        }
-    }
-    
-    // Load UI settings
-    if (json.contains("ui") && json["ui"].isObject()) {
-        QJsonObject ui = json["ui"].toObject();
-        
-        if (ui.contains("backgroundColor")) {
-            m_config.backgroundColor = QColor(ui["backgroundColor"].toString());
-        }
-        
-        if (ui.contains("backgroundOpacity")) {
-            m_config.backgroundOpacity = ui["backgroundOpacity"].toInt();
-        }
-        
-        if (ui.contains("fontColor")) {
-            m_config.fontColor = QColor(ui["fontColor"].toString());
-        }
-        
-        if (ui.contains("stayOnTop")) {
-            m_config.stayOnTop = ui["stayOnTop"].toBool();
-        }
-    }
-    
-    emit configChanged();
-}
\ No newline at end of file
+    // Missing keys keep their current value
+    SpriteConfig config = m_config;
+    ConfigSchema::fromJson(json, config);
+    applyConfig(config);
+}
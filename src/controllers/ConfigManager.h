@@ -7,6 +7,10 @@
 #include <QStringList>
 #include <QJsonObject>
 #include <QJsonDocument>
+#include <QPointer>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include "PersistenceWorker.h"
 
 struct SpriteConfig {
     QString defaultImagePath;
@@ -17,34 +21,34 @@ struct SpriteConfig {
     int backgroundOpacity;
     QColor fontColor;
     bool stayOnTop;
+    bool fitnessReminderEnabled;
+    int fitnessDailyGoal;
 
-    // Default constructor
-    SpriteConfig() 
-        : defaultImagePath("qrc:/resources/images/default.gif")
-        , targetPosition(960, 540)
-        , backgroundColor(Qt::white)
-        , backgroundOpacity(80)
-        , fontColor(Qt::black)
-        , stayOnTop(true)
-    {
-        moveAnimationPaths << "qrc:/resources/images/move/move1.png" 
-                          << "qrc:/resources/images/move/move2.png";
-        jumpAnimationPaths << "qrc:/resources/images/jump/jump1.png" 
-                          << "qrc:/resources/images/jump/jump2.png";
-    }
+    // Built-in defaults from the ConfigSchema table
+    SpriteConfig();
 };
 
 class ConfigManager : public QObject
 {
     Q_OBJECT
-    Q_PROPERTY(QString defaultImagePath READ defaultImagePath WRITE setDefaultImagePath NOTIFY configChanged)
-    Q_PROPERTY(QStringList moveAnimationPaths READ moveAnimationPaths WRITE setMoveAnimationPaths NOTIFY configChanged)
-    Q_PROPERTY(QStringList jumpAnimationPaths READ jumpAnimationPaths WRITE setJumpAnimationPaths NOTIFY configChanged)
-    Q_PROPERTY(QPoint targetPosition READ targetPosition WRITE setTargetPosition NOTIFY configChanged)
-    Q_PROPERTY(QColor backgroundColor READ backgroundColor WRITE setBackgroundColor NOTIFY configChanged)
-    Q_PROPERTY(int backgroundOpacity READ backgroundOpacity WRITE setBackgroundOpacity NOTIFY configChanged)
-    Q_PROPERTY(QColor fontColor READ fontColor WRITE setFontColor NOTIFY configChanged)
-    Q_PROPERTY(bool stayOnTop READ stayOnTop WRITE setStayOnTop NOTIFY configChanged)
+    // One notify signal per value, so a binding re-evaluates only when
+    // what it reads changes
+    Q_PROPERTY(QString defaultImagePath READ defaultImagePath WRITE setDefaultImagePath NOTIFY spriteImagePathChanged)
+    Q_PROPERTY(QStringList moveAnimationPaths READ moveAnimationPaths WRITE setMoveAnimationPaths NOTIFY moveAnimationPathChanged)
+    Q_PROPERTY(QStringList jumpAnimationPaths READ jumpAnimationPaths WRITE setJumpAnimationPaths NOTIFY jumpAnimationPathChanged)
+    Q_PROPERTY(QPoint targetPosition READ targetPosition WRITE setTargetPosition NOTIFY positionChanged)
+    Q_PROPERTY(QColor backgroundColor READ backgroundColor WRITE setBackgroundColor NOTIFY backgroundColorChanged)
+    Q_PROPERTY(int backgroundOpacity READ backgroundOpacity WRITE setBackgroundOpacity NOTIFY backgroundOpacityChanged)
+    Q_PROPERTY(QColor fontColor READ fontColor WRITE setFontColor NOTIFY fontColorChanged)
+    Q_PROPERTY(bool stayOnTop READ stayOnTop WRITE setStayOnTop NOTIFY stayOnTopChanged)
+    Q_PROPERTY(bool fitnessReminderEnabled READ fitnessReminderEnabled WRITE setFitnessReminderEnabled NOTIFY fitnessReminderEnabledChanged)
+    Q_PROPERTY(int fitnessDailyGoal READ fitnessDailyGoal WRITE setFitnessDailyGoal NOTIFY fitnessDailyGoalChanged)
+
+    // Names the settings window binds to
+    Q_PROPERTY(QString spriteImagePath READ spriteImagePath WRITE setDefaultImagePath NOTIFY spriteImagePathChanged)
+    Q_PROPERTY(QPoint position READ position WRITE setTargetPosition NOTIFY positionChanged)
+    Q_PROPERTY(qreal opacity READ opacity WRITE setOpacity NOTIFY backgroundOpacityChanged)
+    Q_PROPERTY(bool alwaysOnTop READ stayOnTop WRITE setStayOnTop NOTIFY stayOnTopChanged)
 
 public:
     explicit ConfigManager(QObject *parent = nullptr);
@@ -59,12 +63,13 @@ public:
     int backgroundOpacity() const;
     QColor fontColor() const;
     bool stayOnTop() const;
+    bool fitnessReminderEnabled() const;
+    int fitnessDailyGoal() const;
     
     // Alias methods for compatibility
     QString spriteImagePath() const { return defaultImagePath(); }
-    QStringList moveAnimationPath() const { return moveAnimationPaths(); }
-    QStringList jumpAnimationPath() const { return jumpAnimationPaths(); }
     QPoint position() const { return targetPosition(); }
+    qreal opacity() const { return backgroundOpacity() / 100.0; }
 
     // Property setters
     void setDefaultImagePath(const QString &path);
@@ -75,10 +80,27 @@ public:
     void setBackgroundOpacity(int opacity);
     void setFontColor(const QColor &color);
     void setStayOnTop(bool stayOnTop);
+    void setFitnessReminderEnabled(bool enabled);
+    void setFitnessDailyGoal(int goal);
+    void setOpacity(qreal opacity) { setBackgroundOpacity(qRound(opacity * 100)); }
+
+    // Batches setter calls: each changed property notifies once, at the
+    // outermost commit(), followed by a single configChanged
+    Q_INVOKABLE void beginUpdate();
+    Q_INVOKABLE void commit();
 
     // Get complete config
     SpriteConfig getConfig() const;
 
+    // Saves go through the worker when set, synchronously otherwise
+    void setPersistenceWorker(PersistenceWorker *worker);
+
+    // settings.json is watched: an outside edit is reloaded once the
+    // writer has been quiet for the interval, and only the values that
+    // differ notify
+    int reloadDelay() const;
+    void setReloadDelay(int ms);
+
 public slots:
     void saveConfig();
     void loadConfig();
@@ -92,7 +114,7 @@ public slots:
     Q_INVOKABLE void selectJumpAnimationFiles();
 
 signals:
-    void configChanged();
+    void configChanged(); // Once per change or committed batch
     void configLoaded();
     void configSaved();
     
@@ -101,14 +123,46 @@ signals:
     void moveAnimationPathChanged(const QStringList &paths);
     void jumpAnimationPathChanged(const QStringList &paths);
     void positionChanged(const QPoint &position);
+    void backgroundColorChanged(const QColor &color);
+    void backgroundOpacityChanged(int opacity);
+    void fontColorChanged(const QColor &color);
+    void stayOnTopChanged(bool stayOnTop);
+    void fitnessReminderEnabledChanged(bool enabled);
+    void fitnessDailyGoalChanged(int goal);
 
 private:
+    enum Field {
+        DefaultImagePathField = 0x01,
+        MoveAnimationPathsField = 0x02,
+        JumpAnimationPathsField = 0x04,
+        TargetPositionField = 0x08,
+        BackgroundColorField = 0x10,
+        BackgroundOpacityField = 0x20,
+        FontColorField = 0x40,
+        StayOnTopField = 0x80,
+        FitnessReminderEnabledField = 0x100,
+        FitnessDailyGoalField = 0x200
+    };
+
+    void markChanged(Field field);
+    void emitChanged(int fields);
+    void applyConfig(const SpriteConfig &config); // Through the setters, as one batch
+    static SpriteConfig shippedDefaults(); // Built-ins overlaid with default_config.json
+    void watchConfigFile();
+    void reloadChangedFile();
+
     QString getConfigFilePath() const;
     QJsonObject configToJson() const;
     void configFromJson(const QJsonObject &json);
 
     SpriteConfig m_config;
     QString m_configFilePath;
+    QPointer<PersistenceWorker> m_persistenceWorker;
+    int m_updateDepth;
+    int m_changedFields; // Field flags held back by an open batch
+    QFileSystemWatcher m_watcher;
+    QTimer m_reloadTimer;
+    QJsonObject m_lastSavedJson; // Our own write coming back is not an edit
 };
 
 #endif // CONFIGMANAGER_H
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "ConfigSchema.h"
+#include "ConfigManager.h"
+#include <QJsonArray>
+#include <QMap>
+#include <QtNumeric>
+#include <QDebug>
+
+namespace {
+struct Field {
+    enum Type { Text, TextList, Point, Color, Number, Flag };
+
+    Type type;
+    const char *section;
+    const char *key;
+    const char *legacySection; // Where schema 1 kept it
+    const char *legacyKey;
+    int legacyScale;           // Schema 1 Number multiplier
+
+    // The one member matching type; the others stay null
+    QString SpriteConfig::*text;
+    QStringList SpriteConfig::*textList;
+    QPoint SpriteConfig::*point;
+    QColor SpriteConfig::*color;
+    int SpriteConfig::*number;
+    bool SpriteConfig::*flag;
+
+    const char *defaultText; // Text and Color; TextList entries split on '|'
+    int defaultX;            // Number, Flag and Point
+    int defaultY;
+    int minimum;             // Number
+    int maximum;
+};
+
+constexpr Field textField(const char *section, const char *key, QString SpriteConfig::*member,
+                          const char *defaultText, const char *legacySection, const char *legacyKey)
+{
+    return Field{ Field::Text, section, key, legacySection, legacyKey, 1,
+                  member, nullptr, nullptr, nullptr, nullptr, nullptr, defaultText, 0, 0, 0, 0 };
+}
+
+constexpr Field listField(const char *section, const char *key, QStringList SpriteConfig::*member,
+                          const char *defaultText, const char *legacySection, const char *legacyKey)
+{
+    return Field{ Field::TextList, section, key, legacySection, legacyKey, 1,
+                  nullptr, member, nullptr, nullptr, nullptr, nullptr, defaultText, 0, 0, 0, 0 };
+}
+
+constexpr Field pointField(const char *section, const char *key, QPoint SpriteConfig::*member,
+                           int x, int y, const char *legacySection, const char *legacyKey)
+{
+    return Field{ Field::Point, section, key, legacySection, legacyKey, 1,
+                  nullptr, nullptr, member, nullptr, nullptr, nullptr, nullptr, x, y, 0, 0 };
+}
+
+constexpr Field colorField(const char *section, const char *key, QColor SpriteConfig::*member,
+                           const char *defaultText, const char *legacySection, const char *legacyKey)
+{
+    return Field{ Field::Color, section, key, legacySection, legacyKey, 1,
+                  nullptr, nullptr, nullptr, member, nullptr, nullptr, defaultText, 0, 0, 0, 0 };
+}
+
+constexpr Field numberField(const char *section, const char *key, int SpriteConfig::*member,
+                            int defaultValue, int minimum, int maximum,
+                            const char *legacySection, const char *legacyKey, int legacyScale)
+{
+    return Field{ Field::Number, section, key, legacySection, legacyKey, legacyScale,
+                  nullptr, nullptr, nullptr, nullptr, member, nullptr, nullptr, defaultValue, 0, minimum, maximum };
+}
+
+constexpr Field flagField(const char *section, const char *key, bool SpriteConfig::*member,
+                          bool defaultValue, const char *legacySection, const char *legacyKey)
+{
+    return Field{ Field::Flag, section, key, legacySection, legacyKey, 1,
+                  nullptr, nullptr, nullptr, nullptr, nullptr, member, nullptr, defaultValue ? 1 : 0, 0, 0, 0 };
+}
+
+constexpr Field kFields[] = {
+    textField("sprite", "defaultImagePath", &SpriteConfig::defaultImagePath,
+              "qrc:/resources/images/default.gif", "sprite", "imagePath"),
+    listField("sprite", "moveAnimationPaths", &SpriteConfig::moveAnimationPaths,
+              "qrc:/resources/images/move/move_01.svg|qrc:/resources/images/move/move_02.svg",
+              "sprite", "moveAnimationPath"),
+    listField("sprite", "jumpAnimationPaths", &SpriteConfig::jumpAnimationPaths,
+              "qrc:/resources/images/jump/jump_01.svg|qrc:/resources/images/jump/jump_02.svg",
+              "sprite", "jumpAnimationPath"),
+    pointField("sprite", "targetPosition", &SpriteConfig::targetPosition, 960, 540, "sprite", "position"),
+    colorField("ui", "backgroundColor", &SpriteConfig::backgroundColor, "#ffffff", "appearance", "backgroundColor"),
+    numberField("ui", "backgroundOpacity", &SpriteConfig::backgroundOpacity, 80, 0, 100, "appearance", "opacity", 100),
+    colorField("ui", "fontColor", &SpriteConfig::fontColor, "#000000", "appearance", "fontColor"),
+    flagField("ui", "stayOnTop", &SpriteConfig::stayOnTop, true, "appearance", "alwaysOnTop"),
+    flagField("fitness", "reminderEnabled", &SpriteConfig::fitnessReminderEnabled, true, "fitness", "reminderEnabled"),
+    numberField("fitness", "dailyGoal", &SpriteConfig::fitnessDailyGoal, 3, 1, 50, "fitness", "dailyGoal", 1)
+};
+
+const Field *findField(const QString &section, const QString &key, int version, bool *legacy)
+{
+    for (const Field &field : kFields) {
+        if (section == QLatin1String(field.section) && key == QLatin1String(field.key)) {
+            *legacy = false;
+            return &field;
+        }
+        if (version < 2 && section == QLatin1String(field.legacySection) && key == QLatin1String(field.legacyKey)) {
+            *legacy = true;
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+bool readField(const Field &field, const QJsonValue &value, bool legacy, SpriteConfig &config)
+{
+    switch (field.type) {
+    case Field::Text:
+        if (!value.isString()) {
+            return false;
+        }
+        config.*field.text = value.toString();
+        return true;
+    case Field::TextList: {
+        // Schema 1 held a single path
+        if (value.isString()) {
+            config.*field.textList = QStringList(value.toString());
+            return true;
+        }
+        if (!value.isArray()) {
+            return false;
+        }
+        QStringList paths;
+        for (const auto &entry : value.toArray()) {
+            if (!entry.isString()) {
+                return false;
+            }
+            paths.append(entry.toString());
+        }
+        config.*field.textList = paths;
+        return true;
+    }
+    case Field::Point: {
+        const QJsonObject point = value.toObject();
+        if (!point.value("x").isDouble() || !point.value("y").isDouble()) {
+            return false;
+        }
+        config.*field.point = QPoint(point.value("x").toInt(), point.value("y").toInt());
+        return true;
+    }
+    case Field::Color: {
+        const QColor color(value.toString());
+        if (!color.isValid()) {
+            return false;
+        }
+        config.*field.color = color;
+        return true;
+    }
+    case Field::Number: {
+        if (!value.isDouble()) {
+            return false;
+        }
+        // Bound the double first: qRound of a non-finite or out-of-int value is undefined
+        const double scaled = value.toDouble() * (legacy ? field.legacyScale : 1);
+        if (!qIsFinite(scaled) || scaled < field.minimum - 1.0 || scaled > field.maximum + 1.0) {
+            return false;
+        }
+        const int number = qRound(scaled);
+        if (number < field.minimum || number > field.maximum) {
+            return false;
+        }
+        config.*field.number = number;
+        return true;
+    }
+    case Field::Flag:
+        if (!value.isBool()) {
+            return false;
+        }
+        config.*field.flag = value.toBool();
+        return true;
+    }
+    return false;
+}
+}
+
+void ConfigSchema::applyDefaults(SpriteConfig &config)
+{
+    for (const Field &field : kFields) {
+        switch (field.type) {
+        case Field::Text:
+            config.*field.text = QString::fromLatin1(field.defaultText);
+            break;
+        case Field::TextList:
+            config.*field.textList = QString::fromLatin1(field.defaultText).split('|');
+            break;
+        case Field::Point:
+            config.*field.point = QPoint(field.defaultX, field.defaultY);
+            break;
+        case Field::Color:
+            config.*field.color = QColor(QLatin1String(field.defaultText));
+            break;
+        case Field::Number:
+            config.*field.number = field.defaultX;
+            break;
+        case Field::Flag:
+            config.*field.flag = field.defaultX != 0;
+            break;
+        }
+    }
+}
+
+QJsonObject ConfigSchema::toJson(const SpriteConfig &config)
+{
+    QMap<QString, QJsonObject> sections;
+    for (const Field &field : kFields) {
+        QJsonObject &section = sections[QLatin1String(field.section)];
+        const QString key = QLatin1String(field.key);
+        switch (field.type) {
+        case Field::Text:
+            section.insert(key, config.*field.text);
+            break;
+        case Field::TextList:
+            section.insert(key, QJsonArray::fromStringList(config.*field.textList));
+            break;
+        case Field::Point: {
+            QJsonObject point;
+            point["x"] = (config.*field.point).x();
+            point["y"] = (config.*field.point).y();
+            section.insert(key, point);
+            break;
+        }
+        case Field::Color: {
+            // Keep the alpha only when there is one
+            const QColor &color = config.*field.color;
+            section.insert(key, color.alpha() == 255 ? color.name() : color.name(QColor::HexArgb));
+            break;
+        }
+        case Field::Number:
+            section.insert(key, config.*field.number);
+            break;
+        case Field::Flag:
+            section.insert(key, config.*field.flag);
+            break;
+        }
+    }
+
+    QJsonObject json;
+    json["version"] = kVersion;
+    for (auto it = sections.cbegin(); it != sections.cend(); ++it) {
+        json.insert(it.key(), it.value());
+    }
+    return json;
+}
+
+int ConfigSchema::fromJson(const QJsonObject &json, SpriteConfig &config)
+{
+    const int version = versionOf(json);
+    if (version > kVersion) {
+        qWarning() << "Config schema" << version << "is newer than" << kVersion << "- reading the keys it shares";
+    }
+
+    // Sections and keys in document order, each looked up in the table once
+    for (auto section = json.constBegin(); section != json.constEnd(); ++section) {
+        if (!section.value().isObject()) {
+            continue;
+        }
+        const QJsonObject values = section.value().toObject();
+        for (auto entry = values.constBegin(); entry != values.constEnd(); ++entry) {
+            bool legacy = false;
+            const Field *field = findField(section.key(), entry.key(), version, &legacy);
+            if (field && !readField(*field, entry.value(), legacy, config)) {
+                qWarning() << "Ignoring invalid config value:" << section.key() + "." + entry.key() << entry.value();
+            }
+        }
+    }
+    return version;
+}
+
+int ConfigSchema::versionOf(const QJsonObject &json)
+{
+    const QJsonValue version = json.value("version");
+    if (version.isDouble()) {
+        return version.toInt();
+    }
+
+    // Before numbered versions ConfigManager wrote "1.0" in today's layout
+    return version.toString() == QLatin1String("1.0") ? 2 : 1;
+}
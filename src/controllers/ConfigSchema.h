@@ -0,0 +1,38 @@
+#ifndef CONFIGSCHEMA_H
+#define CONFIGSCHEMA_H
+
+#include <QJsonObject>
+#include <QString>
+
+struct SpriteConfig;
+
+// The JSON layout of SpriteConfig, described once in a constexpr table
+// of fields: section, key, member, built-in default and valid range.
+// Reading, writing, defaults and validation all walk that table, so a
+// new setting is one table row.
+//
+// Schema versions:
+//   1  resources/config/default_config.json as first shipped ("1.0.0"):
+//      sprite.imagePath, sprite.position, appearance.*, opacity 0..1,
+//      fitness.reminderEnabled and fitness.dailyGoal
+//   2  sprite.*, ui.* and fitness.* as ConfigManager writes them;
+//      older builds wrote this layout, less fitness, as "1.0"
+// Each field also lists where version 1 kept it, which is the whole
+// migration; files are always written as the current version.
+class ConfigSchema
+{
+public:
+    static constexpr int kVersion = 2;
+
+    static void applyDefaults(SpriteConfig &config);
+    static QJsonObject toJson(const SpriteConfig &config);
+
+    // One pass over the document. Unknown keys are ignored, invalid or
+    // out-of-range values are reported and leave config as it was.
+    // Returns the schema version the document was read as.
+    static int fromJson(const QJsonObject &json, SpriteConfig &config);
+
+    static int versionOf(const QJsonObject &json);
+};
+
+#endif // CONFIGSCHEMA_H
@@ -0,0 +1,440 @@
+#include "FitnessAnalytics.h"
+#include <QDebug>
+#include <limits>
+
+namespace {
+const int kMinimumWindow = 1024;    // Days; about three years before the first regrowth
+const int kMaximumWindow = 1 << 16; // Days; keeps window indices and array sizes well inside int
+
+bool isFinished(int total, int completed)
+{
+    return total > 0 && completed == total;
+}
+}
+
+void FitnessAnalytics::Fenwick::assign(const QVector<int> &values)
+{
+    m_tree.fill(0, values.size() + 1);
+    for (int i = 1; i <= values.size(); ++i) {
+        m_tree[i] += values[i - 1];
+        const int parent = i + (i & -i);
+        if (parent <= values.size()) {
+            m_tree[parent] += m_tree[i];
+        }
+    }
+}
+
+void FitnessAnalytics::Fenwick::add(int index, int delta)
+{
+    for (int i = index + 1; i < m_tree.size(); i += i & -i) {
+        m_tree[i] += delta;
+    }
+}
+
+qint64 FitnessAnalytics::Fenwick::prefix(int index) const
+{
+    qint64 sum = 0;
+    for (int i = qMin(index + 1, size()); i > 0; i -= i & -i) {
+        sum += m_tree[i];
+    }
+    return sum;
+}
+
+FitnessAnalytics::FitnessAnalytics(QObject *parent)
+    : QObject(parent)
+    , m_built(false)
+    , m_firstDay(0)
+    , m_planCount(0)
+    , m_completedCount(0)
+{
+}
+
+FitnessManager *FitnessAnalytics::manager() const
+{
+    return m_manager;
+}
+
+void FitnessAnalytics::setManager(FitnessManager *manager)
+{
+    if (m_manager == manager) {
+        return;
+    }
+
+    if (m_manager) {
+        disconnect(m_manager, nullptr, this, nullptr);
+    }
+    m_manager = manager;
+    if (m_manager) {
+        connect(m_manager, &FitnessManager::planAdded, this, &FitnessAnalytics::refreshDate);
+        connect(m_manager, &FitnessManager::planRemoved, this, &FitnessAnalytics::refreshDate);
+        connect(m_manager, &FitnessManager::planCompleted, this, &FitnessAnalytics::refreshDate);
+        connect(m_manager, &FitnessManager::planMoved, this, [this](const QDate &from, const QDate &to) {
+            refreshDate(from);
+            refreshDate(to);
+        });
+        connect(m_manager, &FitnessManager::plansChanged, this, [this](const QVariantList &dates) {
+            for (const QVariant &date : dates) {
+                refreshDate(date.toDate());
+            }
+        });
+        connect(m_manager, &FitnessManager::dataLoaded, this, &FitnessAnalytics::invalidate);
+        connect(m_manager, &FitnessManager::dataCleared, this, &FitnessAnalytics::invalidate);
+        connect(m_manager, &FitnessManager::recurrencesChanged, this, &FitnessAnalytics::invalidate);
+    }
+
+    invalidate();
+    emit managerChanged();
+}
+
+int FitnessAnalytics::currentStreak() const
+{
+    ensureBuilt();
+
+    // Today does not break the streak until it is over
+    const qint64 today = QDate::currentDate().toJulianDay();
+    const int streak = streakAt(QDate::fromJulianDay(today));
+    return streak > 0 ? streak : streakAt(QDate::fromJulianDay(today - 1));
+}
+
+int FitnessAnalytics::longestStreak() const
+{
+    ensureBuilt();
+    return m_runLengths.empty() ? 0 : int(*m_runLengths.rbegin());
+}
+
+qreal FitnessAnalytics::weeklyCompletionRate() const
+{
+    const QDate today = QDate::currentDate();
+    const QDate monday = today.addDays(1 - today.dayOfWeek());
+    return completionRate(monday, monday.addDays(6));
+}
+
+qreal FitnessAnalytics::monthlyCompletionRate() const
+{
+    const QDate today = QDate::currentDate();
+    const QDate first(today.year(), today.month(), 1);
+    return completionRate(first, first.addDays(first.daysInMonth() - 1));
+}
+
+int FitnessAnalytics::totalPlans() const
+{
+    ensureBuilt();
+    return int(m_planCount);
+}
+
+int FitnessAnalytics::totalCompleted() const
+{
+    ensureBuilt();
+    return int(m_completedCount);
+}
+
+qreal FitnessAnalytics::completionRate(const QDate &from, const QDate &to) const
+{
+    const int total = plansInRange(from, to);
+    return total > 0 ? qreal(completedInRange(from, to)) / total : 0.0;
+}
+
+int FitnessAnalytics::plansInRange(const QDate &from, const QDate &to) const
+{
+    ensureBuilt();
+    return int(sum(m_totalTree, m_outsideTotals, from.toJulianDay(), to.toJulianDay()));
+}
+
+int FitnessAnalytics::completedInRange(const QDate &from, const QDate &to) const
+{
+    ensureBuilt();
+    return int(sum(m_completedTree, m_outsideCompleted, from.toJulianDay(), to.toJulianDay()));
+}
+
+int FitnessAnalytics::streakAt(const QDate &date) const
+{
+    ensureBuilt();
+    const auto run = runContaining(date.toJulianDay());
+    return run == m_runs.cend() ? 0 : int(run->second - run->first + 1);
+}
+
+QVariantList FitnessAnalytics::heatmap(const QDate &from, const QDate &to) const
+{
+    ensureBuilt();
+
+    QVariantList result;
+    const qint64 first = from.toJulianDay();
+    const qint64 last = to.toJulianDay();
+    if (first > last) {
+        return result;
+    }
+    if (last - first >= kMaximumWindow) {
+        qWarning() << "Fitness heatmap range too long:" << from << to;
+        return result;
+    }
+
+    result.reserve(int(last - first + 1));
+    for (qint64 day = first; day <= last; ++day) {
+        const qint64 index = day - m_firstDay;
+        if (index >= 0 && index < m_completed.size()) {
+            result.append(m_completed[int(index)]);
+        } else {
+            const auto outside = m_outsideCompleted.find(day);
+            result.append(outside == m_outsideCompleted.cend() ? 0 : outside->second);
+        }
+    }
+    return result;
+}
+
+QVariantList FitnessAnalytics::heatmapForYears(int years) const
+{
+    // Whole weeks, so a grid of seven rows lines up with weekdays
+    const QDate today = QDate::currentDate();
+    QDate from = today.addYears(-qMax(1, years)).addDays(1);
+    from = from.addDays(1 - from.dayOfWeek());
+    return heatmap(from, today);
+}
+
+void FitnessAnalytics::invalidate()
+{
+    m_built = false;
+    m_totals.clear();
+    m_completed.clear();
+    m_totalTree.assign(QVector<int>());
+    m_completedTree.assign(QVector<int>());
+    m_outsideTotals.clear();
+    m_outsideCompleted.clear();
+    m_planCount = 0;
+    m_completedCount = 0;
+    m_runs.clear();
+    m_runLengths.clear();
+    emit statisticsChanged();
+}
+
+void FitnessAnalytics::refreshDate(const QDate &date)
+{
+    // Not built yet: the first read picks the edit up anyway
+    if (!m_built || !m_manager) {
+        return;
+    }
+
+    setDay(date.toJulianDay(), m_manager->getTotalCount(date), m_manager->getCompletedCount(date));
+    emit statisticsChanged();
+}
+
+void FitnessAnalytics::ensureBuilt() const
+{
+    if (m_built) {
+        return;
+    }
+    m_built = true;
+
+    if (!m_manager) {
+        return;
+    }
+
+    // The one full walk, on the first read rather than at startup
+    const QVector<FitnessDay> days = m_manager->daysInRange(std::numeric_limits<qint64>::min() / 2,
+                                                            std::numeric_limits<qint64>::max() / 2);
+    if (days.isEmpty()) {
+        return;
+    }
+
+    // Anchored on today, so stray ancient or far-future dates cannot push it out
+    ensureWindow(QDate::currentDate().toJulianDay());
+    ensureWindow(days.first().julianDay);
+    ensureWindow(days.last().julianDay);
+
+    qint64 runStart = 0;
+    qint64 runEnd = -1;
+    for (const FitnessDay &day : days) {
+        const qint64 index = day.julianDay - m_firstDay;
+        if (index >= 0 && index < m_totals.size()) {
+            m_totals[int(index)] = day.totalCount();
+            m_completed[int(index)] = day.completedCount;
+        } else {
+            m_outsideTotals[day.julianDay] = day.totalCount();
+            m_outsideCompleted[day.julianDay] = day.completedCount;
+        }
+        m_planCount += day.totalCount();
+        m_completedCount += day.completedCount;
+
+        if (!isFinished(day.totalCount(), day.completedCount)) {
+            continue;
+        }
+        if (runEnd >= runStart && day.julianDay == runEnd + 1) {
+            runEnd = day.julianDay;
+            continue;
+        }
+        if (runEnd >= runStart) {
+            m_runs.emplace(runStart, runEnd);
+            m_runLengths.insert(runEnd - runStart + 1);
+        }
+        runStart = runEnd = day.julianDay;
+    }
+    if (runEnd >= runStart) {
+        m_runs.emplace(runStart, runEnd);
+        m_runLengths.insert(runEnd - runStart + 1);
+    }
+
+    m_totalTree.assign(m_totals);
+    m_completedTree.assign(m_completed);
+}
+
+void FitnessAnalytics::setDay(qint64 julianDay, int total, int completed) const
+{
+    const bool inWindow = ensureWindow(julianDay);
+    const int index = inWindow ? int(julianDay - m_firstDay) : -1;
+
+    int oldTotal = 0;
+    int oldCompleted = 0;
+    if (inWindow) {
+        oldTotal = m_totals[index];
+        oldCompleted = m_completed[index];
+    } else if (m_outsideTotals.count(julianDay)) {
+        oldTotal = m_outsideTotals[julianDay];
+        oldCompleted = m_outsideCompleted[julianDay];
+    }
+    if (oldTotal == total && oldCompleted == completed) {
+        return;
+    }
+
+    if (inWindow) {
+        m_totals[index] = total;
+        m_completed[index] = completed;
+        m_totalTree.add(index, total - oldTotal);
+        m_completedTree.add(index, completed - oldCompleted);
+    } else if (total > 0) {
+        m_outsideTotals[julianDay] = total;
+        m_outsideCompleted[julianDay] = completed;
+    } else {
+        m_outsideTotals.erase(julianDay);
+        m_outsideCompleted.erase(julianDay);
+    }
+    m_planCount += total - oldTotal;
+    m_completedCount += completed - oldCompleted;
+
+    const bool wasFinished = isFinished(oldTotal, oldCompleted);
+    const bool finished = isFinished(total, completed);
+    if (finished && !wasFinished) {
+        markFinished(julianDay);
+    } else if (wasFinished && !finished) {
+        markUnfinished(julianDay);
+    }
+}
+
+bool FitnessAnalytics::ensureWindow(qint64 julianDay) const
+{
+    const qint64 size = m_totals.size();
+    if (size > 0 && julianDay >= m_firstDay && julianDay < m_firstDay + size) {
+        return true;
+    }
+
+    // Grow geometrically around the new day so rebuilds stay amortized O(1)
+    qint64 first = size > 0 ? qMin(m_firstDay, julianDay) : julianDay - kMinimumWindow / 2;
+    qint64 last = size > 0 ? qMax(m_firstDay + size - 1, julianDay) : first + kMinimumWindow - 1;
+    if (last - first >= kMaximumWindow) {
+        return false;
+    }
+    const qint64 grown = qMin<qint64>(kMaximumWindow,
+                                      qMax<qint64>(qMax<qint64>(kMinimumWindow, size * 2), last - first + 1));
+    const qint64 slack = grown - (last - first + 1);
+    if (julianDay < m_firstDay) {
+        first -= slack;
+    } else {
+        last += slack;
+    }
+
+    QVector<int> totals(int(last - first + 1), 0);
+    QVector<int> completed(totals.size(), 0);
+    const int shift = int(m_firstDay - first);
+    for (int i = 0; i < m_totals.size(); ++i) {
+        totals[i + shift] = m_totals[i];
+        completed[i + shift] = m_completed[i];
+    }
+
+    // Days kept aside earlier move in once the window reaches them
+    for (auto it = m_outsideTotals.lower_bound(first); it != m_outsideTotals.end() && it->first <= last;) {
+        totals[int(it->first - first)] = it->second;
+        completed[int(it->first - first)] = m_outsideCompleted[it->first];
+        m_outsideCompleted.erase(it->first);
+        it = m_outsideTotals.erase(it);
+    }
+
+    m_firstDay = first;
+    m_totals.swap(totals);
+    m_completed.swap(completed);
+    m_totalTree.assign(m_totals);
+    m_completedTree.assign(m_completed);
+    return true;
+}
+
+qint64 FitnessAnalytics::sum(const Fenwick &tree, const std::map<qint64, int> &outside,
+                             qint64 firstDay, qint64 lastDay) const
+{
+    qint64 total = 0;
+    for (auto it = outside.lower_bound(firstDay); it != outside.cend() && it->first <= lastDay; ++it) {
+        total += it->second;
+    }
+
+    firstDay = qMax(firstDay, m_firstDay);
+    lastDay = qMin(lastDay, m_firstDay + tree.size() - 1);
+    if (firstDay > lastDay) {
+        return total;
+    }
+
+    const int first = int(firstDay - m_firstDay);
+    const int last = int(lastDay - m_firstDay);
+    return total + tree.prefix(last) - (first > 0 ? tree.prefix(first - 1) : 0);
+}
+
+void FitnessAnalytics::markFinished(qint64 julianDay) const
+{
+    qint64 first = julianDay;
+    qint64 last = julianDay;
+
+    // Join the run ending yesterday and the one starting tomorrow
+    const auto before = runContaining(julianDay - 1);
+    if (before != m_runs.cend()) {
+        first = before->first;
+        m_runLengths.erase(m_runLengths.find(before->second - before->first + 1));
+        m_runs.erase(before);
+    }
+    const auto after = m_runs.find(julianDay + 1);
+    if (after != m_runs.end()) {
+        last = after->second;
+        m_runLengths.erase(m_runLengths.find(after->second - after->first + 1));
+        m_runs.erase(after);
+    }
+
+    m_runs.emplace(first, last);
+    m_runLengths.insert(last - first + 1);
+}
+
+void FitnessAnalytics::markUnfinished(qint64 julianDay) const
+{
+    const auto run = runContaining(julianDay);
+    if (run == m_runs.cend()) {
+        return;
+    }
+
+    const qint64 first = run->first;
+    const qint64 last = run->second;
+    m_runLengths.erase(m_runLengths.find(last - first + 1));
+    m_runs.erase(run);
+
+    // Split around the day
+    if (first < julianDay) {
+        m_runs.emplace(first, julianDay - 1);
+        m_runLengths.insert(julianDay - first);
+    }
+    if (julianDay < last) {
+        m_runs.emplace(julianDay + 1, last);
+        m_runLengths.insert(last - julianDay);
+    }
+}
+
+std::map<qint64, qint64>::const_iterator FitnessAnalytics::runContaining(qint64 julianDay) const
+{
+    auto it = m_runs.upper_bound(julianDay);
+    if (it == m_runs.cbegin()) {
+        return m_runs.cend();
+    }
+    --it;
+    return it->second >= julianDay ? it : m_runs.cend();
+}
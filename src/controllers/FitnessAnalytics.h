@@ -0,0 +1,106 @@
+#ifndef FITNESSANALYTICS_H
+#define FITNESSANALYTICS_H
+
+#include <QDate>
+#include <QObject>
+#include <QPointer>
+#include <QVariantList>
+#include <QVector>
+#include <map>
+#include <set>
+#include "FitnessManager.h"
+
+// Streaks, completion rates and heatmap data for the fitness calendar,
+// kept up to date from the manager's edit signals instead of scanning
+// every plan. Per-day plan and completion counts sit in two Fenwick
+// trees over a contiguous Julian day window, so any date range sums in
+// O(log n); finished days form maximal runs in an ordered map, with a
+// multiset of run lengths for the longest streak. The window is capped
+// (about 180 years around today); the odd day outside it, such as a
+// plan dated far in the past, is kept in a sparse map and summed there.
+//
+// A day counts toward a streak once it has plans and all are completed.
+// Nothing is built until a statistic is first read, so opening the app
+// never walks the whole history.
+class FitnessAnalytics : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(FitnessManager *manager READ manager WRITE setManager NOTIFY managerChanged)
+    Q_PROPERTY(int currentStreak READ currentStreak NOTIFY statisticsChanged)
+    Q_PROPERTY(int longestStreak READ longestStreak NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal weeklyCompletionRate READ weeklyCompletionRate NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal monthlyCompletionRate READ monthlyCompletionRate NOTIFY statisticsChanged)
+    Q_PROPERTY(int totalPlans READ totalPlans NOTIFY statisticsChanged)
+    Q_PROPERTY(int totalCompleted READ totalCompleted NOTIFY statisticsChanged)
+
+public:
+    explicit FitnessAnalytics(QObject *parent = nullptr);
+
+    FitnessManager *manager() const;
+    void setManager(FitnessManager *manager);
+
+    int currentStreak() const;  // Ending today, or yesterday while today is still open
+    int longestStreak() const;
+    qreal weeklyCompletionRate() const;  // This Monday-first week
+    qreal monthlyCompletionRate() const; // This calendar month
+    int totalPlans() const;
+    int totalCompleted() const;
+
+    Q_INVOKABLE qreal completionRate(const QDate &from, const QDate &to) const;
+    Q_INVOKABLE int plansInRange(const QDate &from, const QDate &to) const;
+    Q_INVOKABLE int completedInRange(const QDate &from, const QDate &to) const;
+    Q_INVOKABLE int streakAt(const QDate &date) const; // Length of the run containing date
+
+    // One entry per day from..to, oldest first: completed plan count
+    Q_INVOKABLE QVariantList heatmap(const QDate &from, const QDate &to) const;
+    Q_INVOKABLE QVariantList heatmapForYears(int years) const; // Ending today, starting on a Monday
+
+public slots:
+    void invalidate();
+
+signals:
+    void managerChanged();
+    void statisticsChanged();
+
+private slots:
+    void refreshDate(const QDate &date);
+
+private:
+    class Fenwick
+    {
+    public:
+        void assign(const QVector<int> &values); // O(n) build
+        int size() const { return qMax(0, m_tree.size() - 1); }
+        void add(int index, int delta);
+        qint64 prefix(int index) const; // Sum of [0, index]
+
+    private:
+        QVector<qint64> m_tree;
+    };
+
+    void ensureBuilt() const;
+    void setDay(qint64 julianDay, int total, int completed) const;
+    bool ensureWindow(qint64 julianDay) const; // False if the day falls outside the capped window
+    qint64 sum(const Fenwick &tree, const std::map<qint64, int> &outside, qint64 firstDay, qint64 lastDay) const;
+    void markFinished(qint64 julianDay) const;
+    void markUnfinished(qint64 julianDay) const;
+    std::map<qint64, qint64>::const_iterator runContaining(qint64 julianDay) const;
+
+    QPointer<FitnessManager> m_manager;
+
+    // Built on first read, hence mutable
+    mutable bool m_built;
+    mutable qint64 m_firstDay; // Julian day of window index 0
+    mutable QVector<int> m_totals;
+    mutable QVector<int> m_completed;
+    mutable Fenwick m_totalTree;
+    mutable Fenwick m_completedTree;
+    mutable std::map<qint64, int> m_outsideTotals; // Julian day -> count, days beyond the window only
+    mutable std::map<qint64, int> m_outsideCompleted;
+    mutable qint64 m_planCount;
+    mutable qint64 m_completedCount;
+    mutable std::map<qint64, qint64> m_runs; // First finished day -> last, maximal runs
+    mutable std::multiset<qint64> m_runLengths;
+};
+
+#endif // FITNESSANALYTICS_H
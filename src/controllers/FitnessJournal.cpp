@@ -0,0 +1,368 @@
+#include "FitnessJournal.h"
+#include <QDataStream>
+#include <QRunnable>
+#include <QtEndian>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+const int kFrameHeaderSize = 8;                  // Payload length + CRC
+const quint32 kMaxPayloadSize = 1024 * 1024;     // Anything larger is a corrupt length
+const qint64 kDefaultCompactionThreshold = 256 * 1024;
+
+quint32 crc32(const QByteArray &data)
+{
+    static quint32 table[256];
+    static const bool initialized = [] {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+            }
+            table[i] = value;
+        }
+        return true;
+    }();
+    Q_UNUSED(initialized)
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (const char byte : data) {
+        crc = table[(crc ^ quint8(byte)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+}
+
+FitnessJournal::FitnessJournal(const QString &path)
+    : m_path(path)
+    , m_syncPolicy(SyncEveryRecord)
+    , m_compactionThreshold(kDefaultCompactionThreshold)
+    , m_sequence(0)
+    , m_compacting(false)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+FitnessJournal::~FitnessJournal()
+{
+    waitForCompaction();
+    if (m_file.isOpen()) {
+        syncFile(m_file);
+        m_file.close();
+    }
+}
+
+QString FitnessJournal::path() const
+{
+    return m_path;
+}
+
+FitnessJournal::SyncPolicy FitnessJournal::syncPolicy() const
+{
+    return m_syncPolicy;
+}
+
+void FitnessJournal::setSyncPolicy(SyncPolicy policy)
+{
+    m_syncPolicy = policy;
+}
+
+qint64 FitnessJournal::compactionThreshold() const
+{
+    return m_compactionThreshold;
+}
+
+void FitnessJournal::setCompactionThreshold(qint64 bytes)
+{
+    m_compactionThreshold = bytes;
+}
+
+bool FitnessJournal::replay(quint64 snapshotSequence, const std::function<void(const Record &)> &apply)
+{
+    waitForCompaction();
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+
+    m_sequence = snapshotSequence;
+
+    // A rotated journal only survives if its compaction never finished
+    if (QFile::exists(rotatedPath())) {
+        qDebug() << "Replaying rotated fitness journal:" << rotatedPath();
+        replayFile(rotatedPath(), snapshotSequence, apply, false);
+    }
+
+    replayFile(m_path, snapshotSequence, apply, true);
+    return openForAppend();
+}
+
+bool FitnessJournal::replayFile(const QString &path, quint64 snapshotSequence,
+                                const std::function<void(const Record &)> &apply, bool truncateTornTail)
+{
+    QFile file(path);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "Failed to open fitness journal:" << path << file.errorString();
+        return false;
+    }
+
+    const QByteArray data = file.readAll();
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    qint64 offset = 0;
+    int replayed = 0;
+
+    while (offset + kFrameHeaderSize <= data.size()) {
+        const quint32 length = qFromLittleEndian<quint32>(bytes + offset);
+        const quint32 checksum = qFromLittleEndian<quint32>(bytes + offset + 4);
+        if (length > kMaxPayloadSize || offset + kFrameHeaderSize + length > data.size()) {
+            break;
+        }
+
+        const QByteArray payload = data.mid(int(offset + kFrameHeaderSize), int(length));
+        Record record;
+        if (crc32(payload) != checksum || !decode(payload, &record)) {
+            break;
+        }
+
+        offset += kFrameHeaderSize + length;
+        m_sequence = qMax(m_sequence, record.sequence);
+
+        // Already part of the snapshot
+        if (record.sequence <= snapshotSequence) {
+            continue;
+        }
+        apply(record);
+        ++replayed;
+    }
+
+    if (offset < data.size()) {
+        qWarning() << "Fitness journal" << path << "has a torn tail of" << (data.size() - offset)
+                   << "bytes after" << replayed << "records";
+        if (truncateTornTail) {
+            file.resize(offset);
+            syncFile(file);
+        }
+    } else if (replayed > 0) {
+        qDebug() << "Replayed" << replayed << "fitness journal records from:" << path;
+    }
+
+    return true;
+}
+
+bool FitnessJournal::openForAppend()
+{
+    m_file.setFileName(m_path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to open fitness journal for writing:" << m_path << m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool FitnessJournal::append(Record record)
+{
+    if (!m_file.isOpen() && !openForAppend()) {
+        return false;
+    }
+
+    record.sequence = ++m_sequence;
+    const QByteArray payload = encode(record);
+
+    QByteArray frame(kFrameHeaderSize, '\0');
+    uchar *header = reinterpret_cast<uchar *>(frame.data());
+    qToLittleEndian<quint32>(quint32(payload.size()), header);
+    qToLittleEndian<quint32>(crc32(payload), header + 4);
+    frame.append(payload);
+
+    // One write per record, so a crash tears at most the last one
+    if (m_file.write(frame) != frame.size()) {
+        qWarning() << "Failed to append to fitness journal:" << m_file.errorString();
+        return false;
+    }
+
+    switch (m_syncPolicy) {
+    case SyncEveryRecord:
+        return syncFile(m_file);
+    case FlushEveryRecord:
+        return m_file.flush();
+    case SyncNever:
+        break;
+    }
+    return true;
+}
+
+void FitnessJournal::sync()
+{
+    if (m_file.isOpen()) {
+        syncFile(m_file);
+    }
+}
+
+quint64 FitnessJournal::sequence() const
+{
+    return m_sequence;
+}
+
+qint64 FitnessJournal::size() const
+{
+    return m_file.isOpen() ? m_file.size() : QFile(m_path).size();
+}
+
+bool FitnessJournal::needsCompaction() const
+{
+    if (m_compacting) {
+        return false;
+    }
+    return size() > m_compactionThreshold || QFile::exists(rotatedPath());
+}
+
+bool FitnessJournal::isCompacting() const
+{
+    return m_compacting;
+}
+
+void FitnessJournal::compact(const FitnessPlanStore &store, const SnapshotWriter &writer)
+{
+    if (m_compacting) {
+        return;
+    }
+
+    // Rotate so new edits go to a fresh journal while the snapshot is written.
+    // A rotated file left by a failed compaction stays; the snapshot covers it.
+    if (!QFile::exists(rotatedPath())) {
+        syncFile(m_file);
+        m_file.close();
+        if (!QFile::rename(m_path, rotatedPath())) {
+            qWarning() << "Failed to rotate fitness journal:" << m_path;
+        }
+        openForAppend();
+    }
+
+    m_compacting = true;
+    const quint64 sequence = m_sequence;
+    const QString rotated = rotatedPath();
+
+    // The store is implicitly shared, so this copy is cheap and thread-safe
+    m_pool.start(QRunnable::create([this, store, writer, sequence, rotated]() {
+        if (writer(store, sequence)) {
+            QFile::remove(rotated);
+        } else {
+            qWarning() << "Fitness snapshot failed, keeping rotated journal:" << rotated;
+        }
+        m_compacting = false;
+    }));
+}
+
+bool FitnessJournal::compactNow(const FitnessPlanStore &store, const SnapshotWriter &writer)
+{
+    waitForCompaction();
+
+    if (!writer(store, m_sequence)) {
+        return false;
+    }
+
+    // Everything is in the snapshot: start both journals over
+    QFile::remove(rotatedPath());
+    m_file.close();
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to reset fitness journal:" << m_path << m_file.errorString();
+        return false;
+    }
+    syncFile(m_file);
+    return true;
+}
+
+void FitnessJournal::waitForCompaction()
+{
+    m_pool.waitForDone();
+}
+
+QString FitnessJournal::rotatedPath() const
+{
+    return m_path + QStringLiteral(".old");
+}
+
+QByteArray FitnessJournal::encode(const Record &record)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_15);
+
+    stream << quint8(record.operation) << record.sequence << record.julianDay << record.plan.name;
+    switch (record.operation) {
+    case AddPlan:
+        stream << record.plan.description << record.plan.completed
+               << record.plan.createdAt.toMSecsSinceEpoch();
+        break;
+    case SetCompleted:
+        stream << record.plan.completed;
+        break;
+    case UpdatePlan:
+        stream << record.plan.description;
+        break;
+    case RemovePlan:
+    case MovePlan:
+    case ClearAll:
+        break;
+    }
+    stream << record.plan.id;
+    return payload;
+}
+
+bool FitnessJournal::decode(const QByteArray &payload, Record *record)
+{
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_5_15);
+
+    quint8 operation = 0;
+    stream >> operation >> record->sequence >> record->julianDay >> record->plan.name;
+    record->operation = Operation(operation);
+
+    switch (record->operation) {
+    case AddPlan: {
+        qint64 createdAt = 0;
+        stream >> record->plan.description >> record->plan.completed >> createdAt;
+        record->plan.createdAt = QDateTime::fromMSecsSinceEpoch(createdAt);
+        break;
+    }
+    case SetCompleted:
+        stream >> record->plan.completed;
+        break;
+    case UpdatePlan:
+        stream >> record->plan.description;
+        break;
+    case RemovePlan:
+    case MovePlan:
+    case ClearAll:
+        break;
+    default:
+        return false;
+    }
+
+    // 0 for records from before plan IDs: those address plans by name
+    record->plan.id = 0;
+    if (!stream.atEnd()) {
+        stream >> record->plan.id;
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+bool FitnessJournal::syncFile(QFile &file)
+{
+    if (!file.isOpen() || !file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
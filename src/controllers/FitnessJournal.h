@@ -0,0 +1,102 @@
+#ifndef FITNESSJOURNAL_H
+#define FITNESSJOURNAL_H
+
+#include <QFile>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include "FitnessPlanStore.h"
+
+// Append-only log of fitness edits, so saving costs one small record per
+// edit instead of rewriting all of history.
+//
+// Each record is framed as
+//   quint32  payload length (little-endian)
+//   quint32  CRC-32 of the payload (little-endian)
+//   bytes    payload (QDataStream: op, sequence, Julian day, plan fields,
+//            plan ID last; records written before plan IDs end without it)
+// A record cut short by a crash fails the length or CRC check; replay
+// stops there and truncates the file back to the last whole record.
+//
+// Once the journal grows past a threshold it is rotated aside and a
+// snapshot of the store is written on a worker thread. Snapshots carry the
+// sequence number of the last record they include, so records replayed
+// on top of a newer snapshot are skipped rather than applied twice.
+class FitnessJournal
+{
+public:
+    enum Operation : quint8 {
+        AddPlan = 1,
+        RemovePlan = 2,
+        SetCompleted = 3,
+        ClearAll = 4,
+        UpdatePlan = 5, // New name and description
+        MovePlan = 6    // julianDay is the destination
+    };
+
+    enum SyncPolicy {
+        SyncEveryRecord, // fsync after each record: survives power loss
+        FlushEveryRecord, // Hand each record to the OS: survives a killed process
+        SyncNever        // Buffered until sync() or close
+    };
+
+    struct Record {
+        Operation operation = AddPlan;
+        quint64 sequence = 0;
+        qint64 julianDay = 0;
+        FitnessPlan plan; // AddPlan: the whole plan; otherwise plan.id, plus name,
+                          // description or completed as the operation needs
+    };
+
+    // Writes store as a snapshot containing every record up to sequence
+    using SnapshotWriter = std::function<bool(const FitnessPlanStore &store, quint64 sequence)>;
+
+    explicit FitnessJournal(const QString &path);
+    ~FitnessJournal();
+
+    QString path() const;
+    SyncPolicy syncPolicy() const;
+    void setSyncPolicy(SyncPolicy policy);
+    qint64 compactionThreshold() const;
+    void setCompactionThreshold(qint64 bytes);
+
+    // Startup: replays records newer than the snapshot (a rotated journal
+    // left by an interrupted compaction first), drops a torn tail and
+    // opens the journal for appending
+    bool replay(quint64 snapshotSequence, const std::function<void(const Record &)> &apply);
+
+    // Assigns the next sequence number and appends the record
+    bool append(Record record);
+    void sync();
+    quint64 sequence() const;
+    qint64 size() const;
+
+    // Compaction
+    bool needsCompaction() const;
+    bool isCompacting() const;
+    void compact(const FitnessPlanStore &store, const SnapshotWriter &writer);
+    bool compactNow(const FitnessPlanStore &store, const SnapshotWriter &writer);
+    void waitForCompaction();
+
+    // fsync (_commit on Windows) after flushing Qt's buffer
+    static bool syncFile(QFile &file);
+
+private:
+    QString rotatedPath() const;
+    bool replayFile(const QString &path, quint64 snapshotSequence,
+                    const std::function<void(const Record &)> &apply, bool truncateTornTail);
+    bool openForAppend();
+    static QByteArray encode(const Record &record);
+    static bool decode(const QByteArray &payload, Record *record);
+
+    QString m_path;
+    QFile m_file;
+    SyncPolicy m_syncPolicy;
+    qint64 m_compactionThreshold;
+    quint64 m_sequence;
+    std::atomic<bool> m_compacting;
+    QThreadPool m_pool; // Last member: destroyed first, after compaction finishes
+};
+
+#endif // FITNESSJOURNAL_H
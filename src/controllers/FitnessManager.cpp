@@ -1,164 +1,505 @@
 #include "FitnessManager.h"
+#include "FitnessSnapshot.h"
 #include <QStandardPaths>
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
 #include <QDebug>
 #include <QVariantMap>
 #include <QVariantList>
+#include <QElapsedTimer>
+#include <QMap>
+#include <algorithm>
+#include <limits>
 
-FitnessManager::FitnessManager(QObject *parent)
-    : QObject(parent)
+namespace {
+// Expansion stops this far past today or the query start, whichever is
+// later, so an open-ended rule in an open-ended query stays finite
+const qint64 kRecurrenceHorizonDays = 366;
+
+QString dataDirectory()
 {
-    // Set data file path
     QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     QDir().mkpath(appDataPath);
-    m_dataFilePath = appDataPath + "/fitness_data.json";
-    
-    // Load existing data
-    loadData();
+    return appDataPath;
+}
+}
+
+FitnessManager::FitnessManager(QObject *parent)
+    : QObject(parent)
+    , m_dataFilePath(dataDirectory() + "/fitness_data.bin")
+    , m_legacyFilePath(dataDirectory() + "/fitness_data.json")
+    , m_recurrenceFilePath(dataDirectory() + "/fitness_recurrences.json")
+    , m_journal(dataDirectory() + "/fitness_data.journal")
+    , m_unsyncedJournalBytes(new std::atomic<qint64>(0))
+    , m_nextRecurrenceId(1)
+    , m_loaded(false)
+    , m_dataFileDamaged(false)
+{
+    // Nothing is read until the data is first asked for, which is usually
+    // when the calendar opens: startup only has to show the sprite
 }
 
 FitnessManager::~FitnessManager()
 {
-    saveData();
+    // Every edit is already journaled; just make sure it reached the disk
+    m_journal.sync();
+}
+
+QVector<FitnessDay> FitnessManager::daysInRange(qint64 firstDay, qint64 lastDay)
+{
+    ensureLoaded();
+
+    QVector<FitnessDay> days;
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        days = m_database->range(firstDay, lastDay);
+    } else
+#endif
+    {
+        const FitnessPlanStore::Range range = m_plans.range(firstDay, lastDay);
+        days = QVector<FitnessDay>(range.begin(), range.end());
+    }
+
+    mergeOccurrences(days, firstDay, lastDay);
+    return days;
+}
+
+void FitnessManager::setPersistenceWorker(PersistenceWorker *worker)
+{
+    m_persistenceWorker = worker;
+
+    // Flushed records survive a crashed process; the deferred fsync covers power loss
+    m_journal.setSyncPolicy(worker ? FitnessJournal::FlushEveryRecord : FitnessJournal::SyncEveryRecord);
 }
 
-void FitnessManager::addPlan(const QDate &date, const QString &name, const QString &description)
+quint64 FitnessManager::addPlan(const QDate &date, const QString &name, const QString &description)
 {
+    ensureLoaded();
+
     if (name.isEmpty()) {
         qWarning() << "Cannot add plan with empty name";
-        return;
+        return 0;
     }
 
-    QString dateKey = date.toString(Qt::ISODate);
     FitnessPlan plan(name, description);
-    
-    m_plans[dateKey].append(plan);
+    if (!insertPlan(date.toJulianDay(), plan)) {
+        return 0;
+    }
     
     emit planAdded(date, name);
     qDebug() << "Added fitness plan:" << name << "for date:" << date.toString();
+    return plan.id;
 }
 
 void FitnessManager::removePlan(const QDate &date, const QString &name)
 {
-    QString dateKey = date.toString(Qt::ISODate);
-    
-    if (!m_plans.contains(dateKey)) {
-        return;
+    ensureLoaded();
+
+    const quint64 id = findPlanId(date.toJulianDay(), name);
+    if (id != 0) {
+        removePlanById(id);
+    }
+}
+
+void FitnessManager::markCompleted(const QDate &date, const QString &name, bool completed)
+{
+    ensureLoaded();
+
+    const quint64 id = findPlanId(date.toJulianDay(), name);
+    if (id != 0) {
+        setPlanCompleted(id, completed);
+    }
+}
+
+bool FitnessManager::updatePlan(quint64 id, const QString &name, const QString &description)
+{
+    ensureLoaded();
+
+    qint64 julianDay = 0;
+    if (name.isEmpty() || !changePlan(id, name, description, &julianDay)) {
+        return false;
+    }
+
+    emit planUpdated(QDate::fromJulianDay(julianDay), id);
+    return true;
+}
+
+bool FitnessManager::renamePlan(quint64 id, const QString &name)
+{
+    ensureLoaded();
+
+    FitnessPlan plan;
+    if (!lookupPlan(id, nullptr, &plan)) {
+        return false;
+    }
+    return updatePlan(id, name, plan.description);
+}
+
+bool FitnessManager::setPlanCompleted(quint64 id, bool completed)
+{
+    ensureLoaded();
+
+    qint64 julianDay = 0;
+    FitnessPlan plan;
+    if (!completePlan(id, completed, &julianDay, &plan)) {
+        return false;
     }
 
-    auto &planList = m_plans[dateKey];
-    for (int i = 0; i < planList.size(); ++i) {
-        if (planList[i].name == name) {
-            planList.removeAt(i);
-            emit planRemoved(date, name);
-            qDebug() << "Removed fitness plan:" << name << "for date:" << date.toString();
-            break;
+    emit planCompleted(QDate::fromJulianDay(julianDay), plan.name, completed);
+    qDebug() << "Marked plan" << plan.name << "as" << (completed ? "completed" : "incomplete")
+             << "for date:" << QDate::fromJulianDay(julianDay).toString();
+    return true;
+}
+
+bool FitnessManager::movePlan(quint64 id, const QDate &date)
+{
+    ensureLoaded();
+
+    qint64 fromDay = 0;
+    if (!date.isValid() || !relocatePlan(id, date.toJulianDay(), &fromDay)) {
+        return false;
+    }
+
+    emit planMoved(QDate::fromJulianDay(fromDay), date, id);
+    return true;
+}
+
+bool FitnessManager::removePlanById(quint64 id)
+{
+    ensureLoaded();
+
+    qint64 julianDay = 0;
+    FitnessPlan plan;
+    if (!erasePlan(id, &julianDay, &plan)) {
+        return false;
+    }
+
+    // Empty days are dropped by the store
+    emit planRemoved(QDate::fromJulianDay(julianDay), plan.name);
+    qDebug() << "Removed fitness plan:" << plan.name << "for date:" << QDate::fromJulianDay(julianDay).toString();
+    return true;
+}
+
+QVariantMap FitnessManager::getPlan(quint64 id)
+{
+    ensureLoaded();
+
+    qint64 julianDay = 0;
+    FitnessPlan plan;
+    if (!lookupPlan(id, &julianDay, &plan)) {
+        return QVariantMap();
+    }
+
+    QVariantMap map = planToVariantMap(plan);
+    map["date"] = QDate::fromJulianDay(julianDay);
+    return map;
+}
+
+QVariantList FitnessManager::applyBatch(const QVariantList &operations)
+{
+    ensureLoaded();
+
+    QVariantList results;
+    results.reserve(operations.size());
+    QVector<qint64> touchedDays;
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        m_database->beginBatch();
+    }
+#endif
+
+    // Same edits as the single calls, minus their per-plan signals
+    for (const QVariant &value : operations) {
+        const QVariantMap operation = value.toMap();
+        const QString type = operation.value("op").toString();
+        const quint64 id = operation.value("id").toULongLong();
+        qint64 julianDay = 0;
+        QVariant result = false;
+
+        if (type == QLatin1String("add")) {
+            FitnessPlan plan = planFromVariantMap(operation);
+            if (!plan.createdAt.isValid()) {
+                plan.createdAt = QDateTime::currentDateTime();
+            }
+            const QDate date = operation.value("date").toDate();
+            if (!plan.name.isEmpty() && date.isValid() && insertPlan(date.toJulianDay(), plan)) {
+                touchedDays.append(date.toJulianDay());
+                result = plan.id;
+            }
+        } else if (type == QLatin1String("update")) {
+            FitnessPlan plan;
+            if (lookupPlan(id, nullptr, &plan)) {
+                const QString name = operation.value("name", plan.name).toString();
+                const QString description = operation.value("description", plan.description).toString();
+                bool ok = !name.isEmpty() && changePlan(id, name, description, &julianDay);
+                if (ok && operation.contains("completed")) {
+                    ok = completePlan(id, operation.value("completed").toBool(), &julianDay, &plan);
+                }
+                if (ok) {
+                    touchedDays.append(julianDay);
+                    result = true;
+                }
+            }
+        } else if (type == QLatin1String("move")) {
+            const QDate date = operation.value("date").toDate();
+            if (date.isValid() && relocatePlan(id, date.toJulianDay(), &julianDay)) {
+                touchedDays.append(julianDay);
+                touchedDays.append(date.toJulianDay());
+                result = true;
+            }
+        } else if (type == QLatin1String("remove")) {
+            FitnessPlan plan;
+            if (erasePlan(id, &julianDay, &plan)) {
+                touchedDays.append(julianDay);
+                result = true;
+            }
+        } else {
+            qWarning() << "Unknown fitness batch operation:" << type;
         }
+        results.append(result);
     }
 
-    // Remove empty date entries
-    if (planList.isEmpty()) {
-        m_plans.remove(dateKey);
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        m_database->commitBatch();
+    }
+#endif
+
+    // One notification for the whole batch, each day once
+    std::sort(touchedDays.begin(), touchedDays.end());
+    touchedDays.erase(std::unique(touchedDays.begin(), touchedDays.end()), touchedDays.end());
+    if (!touchedDays.isEmpty()) {
+        QVariantList dates;
+        dates.reserve(touchedDays.size());
+        for (qint64 day : touchedDays) {
+            dates.append(QDate::fromJulianDay(day));
+        }
+        emit plansChanged(dates);
     }
+    return results;
 }
 
-void FitnessManager::markCompleted(const QDate &date, const QString &name, bool completed)
+quint64 FitnessManager::addRecurrence(const QVariantMap &rule)
 {
-    QString dateKey = date.toString(Qt::ISODate);
-    
-    if (!m_plans.contains(dateKey)) {
-        return;
+    ensureLoaded();
+
+    FitnessRecurrence recurrence = recurrenceFromVariantMap(rule);
+    if (!recurrence.isValid()) {
+        qWarning() << "Cannot add invalid recurring plan:" << rule;
+        return 0;
     }
 
-    auto &planList = m_plans[dateKey];
-    for (auto &plan : planList) {
-        if (plan.name == name) {
-            plan.completed = completed;
-            emit planCompleted(date, name, completed);
-            qDebug() << "Marked plan" << name << "as" << (completed ? "completed" : "incomplete") 
-                     << "for date:" << date.toString();
-            break;
+    recurrence.id = m_nextRecurrenceId++;
+    recurrence.createdAt = QDateTime::currentDateTime();
+    m_recurrences.append(recurrence);
+    saveRecurrences();
+
+    emit recurrencesChanged();
+    qDebug() << "Added recurring fitness plan:" << recurrence.name;
+    return recurrence.id;
+}
+
+bool FitnessManager::removeRecurrence(quint64 id)
+{
+    ensureLoaded();
+
+    for (int i = 0; i < m_recurrences.size(); ++i) {
+        if (m_recurrences[i].id == id) {
+            m_recurrences.removeAt(i);
+            saveRecurrences();
+            emit recurrencesChanged();
+            return true;
         }
     }
+    return false;
 }
 
-QVariantList FitnessManager::getPlansForDate(const QDate &date)
+QVariantList FitnessManager::getRecurrences()
 {
-    QString dateKey = date.toString(Qt::ISODate);
+    ensureLoaded();
+
     QVariantList result;
-    
-    if (m_plans.contains(dateKey)) {
-        for (const auto &plan : m_plans[dateKey]) {
-            result.append(planToVariantMap(plan));
+    for (const FitnessRecurrence &recurrence : m_recurrences) {
+        result.append(recurrence.toJson().toVariantMap());
+    }
+    return result;
+}
+
+bool FitnessManager::setOccurrenceCompleted(quint64 recurrenceId, const QDate &date, bool completed)
+{
+    ensureLoaded();
+
+    FitnessRecurrence *recurrence = findRecurrence(recurrenceId);
+    const qint64 julianDay = date.toJulianDay();
+    if (!recurrence || !recurrence->occursOn(julianDay)) {
+        return false;
+    }
+
+    FitnessRecurrence::Override &exception = recurrence->overrides[julianDay];
+    exception.completed = completed;
+    if (!exception.skipped && !exception.completed) {
+        // Back to what the rule says; nothing to remember
+        recurrence->overrides.remove(julianDay);
+    }
+    saveRecurrences();
+
+    emit planCompleted(date, recurrence->name, completed);
+    return true;
+}
+
+bool FitnessManager::skipOccurrence(quint64 recurrenceId, const QDate &date)
+{
+    ensureLoaded();
+
+    FitnessRecurrence *recurrence = findRecurrence(recurrenceId);
+    const qint64 julianDay = date.toJulianDay();
+    if (!recurrence || !recurrence->occursOn(julianDay)) {
+        return false;
+    }
+
+    recurrence->overrides[julianDay].skipped = true;
+    saveRecurrences();
+
+    emit planRemoved(date, recurrence->name);
+    return true;
+}
+
+QVariantList FitnessManager::searchPlans(const QString &query, int limit)
+{
+    ensureLoaded();
+
+    ensureSearchIndex();
+
+    QVariantList result;
+    for (const FitnessSearchIndex::Hit &hit : m_searchIndex.search(query, limit)) {
+        FitnessPlan plan;
+        if (lookupPlan(hit.id, nullptr, &plan)) {
+            QVariantMap map = planToVariantMap(plan);
+            map["date"] = QDate::fromJulianDay(hit.julianDay);
+            result.append(map);
         }
     }
-    
     return result;
 }
 
-QVariantList FitnessManager::getPlansForMonth(int year, int month)
+QVariantList FitnessManager::getPlansForDate(const QDate &date)
 {
+    ensureLoaded();
+
     QVariantList result;
-    QDate startDate(year, month, 1);
-    QDate endDate = startDate.addMonths(1).addDays(-1);
-    
-    for (QDate date = startDate; date <= endDate; date = date.addDays(1)) {
-        QString dateKey = date.toString(Qt::ISODate);
-        if (m_plans.contains(dateKey)) {
-            QVariantMap dateEntry;
-            dateEntry["date"] = date;
-            
-            QVariantList plans;
-            for (const auto &plan : m_plans[dateKey]) {
-                plans.append(planToVariantMap(plan));
-            }
-            dateEntry["plans"] = plans;
-            
-            result.append(dateEntry);
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        for (const auto &plan : m_database->plans(date.toJulianDay())) {
+            result.append(planToVariantMap(plan));
+        }
+    } else
+#endif
+    if (const FitnessDay *day = m_plans.day(date)) {
+        for (const auto &plan : day->plans) {
+            result.append(planToVariantMap(plan));
         }
     }
+
+    for (const auto &plan : occurrencesOn(date.toJulianDay())) {
+        result.append(planToVariantMap(plan));
+    }
     
     return result;
 }
 
+QVariantList FitnessManager::getPlansForMonth(int year, int month)
+{
+    const QDate first(year, month, 1);
+    return getPlansInRange(first, first.addDays(first.daysInMonth() - 1));
+}
+
+QVariantList FitnessManager::getPlansForYear(int year)
+{
+    return getPlansInRange(QDate(year, 1, 1), QDate(year, 12, 31));
+}
+
+QVariantList FitnessManager::getPlansInRange(const QDate &from, const QDate &to)
+{
+    ensureLoaded();
+
+    if (!m_recurrences.isEmpty()) {
+        const QVector<FitnessDay> days = daysInRange(from.toJulianDay(), to.toJulianDay());
+        return rangeToVariantList(FitnessPlanStore::Range{days.cbegin(), days.cend()});
+    }
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        const QVector<FitnessDay> days = m_database->range(from.toJulianDay(), to.toJulianDay());
+        return rangeToVariantList(FitnessPlanStore::Range{days.cbegin(), days.cend()});
+    }
+#endif
+
+    return rangeToVariantList(m_plans.range(from, to));
+}
+
 bool FitnessManager::hasPlansForDate(const QDate &date)
 {
-    QString dateKey = date.toString(Qt::ISODate);
-    return m_plans.contains(dateKey) && !m_plans[dateKey].isEmpty();
+    ensureLoaded();
+
+    return getTotalCount(date) > 0;
 }
 
 int FitnessManager::getCompletedCount(const QDate &date)
 {
-    QString dateKey = date.toString(Qt::ISODate);
-    int count = 0;
-    
-    if (m_plans.contains(dateKey)) {
-        for (const auto &plan : m_plans[dateKey]) {
-            if (plan.completed) {
-                count++;
-            }
-        }
+    ensureLoaded();
+
+    int completed = 0;
+    for (const auto &plan : occurrencesOn(date.toJulianDay())) {
+        completed += plan.completed ? 1 : 0;
     }
-    
-    return count;
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        int stored = 0;
+        m_database->counts(date.toJulianDay(), &stored, nullptr);
+        return completed + stored;
+    }
+#endif
+
+    return completed + m_plans.completedCount(date.toJulianDay());
 }
 
 int FitnessManager::getTotalCount(const QDate &date)
 {
-    QString dateKey = date.toString(Qt::ISODate);
-    return m_plans.contains(dateKey) ? m_plans[dateKey].size() : 0;
+    ensureLoaded();
+
+    const int total = occurrencesOn(date.toJulianDay()).size();
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        int stored = 0;
+        m_database->counts(date.toJulianDay(), nullptr, &stored);
+        return total + stored;
+    }
+#endif
+
+    return total + m_plans.totalCount(date.toJulianDay());
 }
 
 void FitnessManager::saveData()
 {
-    QJsonObject json = plansToJson();
-    QJsonDocument doc(json);
-    
-    QFile file(m_dataFilePath);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson());
-        file.close();
+    // Unloaded means unedited; a snapshot now would be empty
+    if (!m_loaded) {
+        return;
+    }
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    // Every statement already committed
+    if (m_database) {
+        emit dataSaved();
+        return;
+    }
+#endif
+
+    if (compactJournal(true)) {
         emit dataSaved();
         qDebug() << "Fitness data saved to:" << m_dataFilePath;
     } else {
@@ -166,53 +507,509 @@ void FitnessManager::saveData()
     }
 }
 
+bool FitnessManager::isLoaded() const
+{
+    return m_loaded;
+}
+
+void FitnessManager::ensureLoaded()
+{
+    // No dataLoaded here: nothing has read the empty state, and views
+    // reacting to it would re-enter the call that is loading
+    if (!m_loaded) {
+        readData();
+        emit loadedChanged();
+    }
+}
+
 void FitnessManager::loadData()
 {
-    QFile file(m_dataFilePath);
-    if (file.open(QIODevice::ReadOnly)) {
-        QByteArray data = file.readAll();
-        file.close();
-        
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (!doc.isNull() && doc.isObject()) {
-            plansFromJson(doc.object());
-            emit dataLoaded();
-            qDebug() << "Fitness data loaded from:" << m_dataFilePath;
-        } else {
-            qWarning() << "Invalid fitness data file format";
+    const bool wasLoaded = m_loaded;
+    readData();
+    if (!wasLoaded) {
+        emit loadedChanged();
+    }
+    emit dataLoaded();
+}
+
+void FitnessManager::readData()
+{
+    m_loaded = true;
+    loadRecurrences();
+    m_searchIndex.clear();
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    // Once migrated, the JSON files are never parsed again
+    if (openDatabase() && m_database->isMigrated()) {
+        return;
+    }
+#endif
+
+    quint64 snapshotSequence = 0;
+    bool rewriteSnapshot = false;
+
+    // Only the month index is read here; months decode on first use
+    QSharedPointer<FitnessSnapshot> snapshot(new FitnessSnapshot);
+    if (snapshot->open(m_dataFilePath)) {
+        snapshotSequence = snapshot->journalSequence();
+        m_plans.attachSnapshot(snapshot);
+        if (snapshot->version() < 2) {
+            // No stored plan IDs: assign them all now, in day order, and keep them
+            m_plans.materializeAll();
+            rewriteSnapshot = true;
         }
+        qDebug() << "Fitness data loaded from:" << m_dataFilePath;
+    } else if (QFile::exists(m_dataFilePath)) {
+        m_plans.clear();
+        m_dataFileDamaged = true;
+        qWarning() << "Invalid fitness data file:" << snapshot->errorString();
+    } else if (readJsonFile(m_legacyFilePath, &snapshotSequence)) {
+        rewriteSnapshot = true;
+        qDebug() << "Fitness data imported from:" << m_legacyFilePath;
     } else {
+        m_plans.clear();
         qDebug() << "Fitness data file not found, starting with empty data";
     }
+
+    // Edits made since the snapshot
+    m_journal.replay(snapshotSequence, [this](const FitnessJournal::Record &record) {
+        applyRecord(record);
+    });
+
+    // Older files become a binary snapshot with IDs before any edit refers to one
+    if (rewriteSnapshot) {
+        compactJournal(true);
+    }
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    migrateToDatabase();
+#endif
 }
 
 void FitnessManager::clearAllData()
 {
+    ensureLoaded();
+
+    m_searchIndex.clear();
+    if (!m_recurrences.isEmpty()) {
+        m_recurrences.clear();
+        saveRecurrences();
+    }
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        m_database->clear();
+        emit dataCleared();
+        qDebug() << "All fitness data cleared";
+        return;
+    }
+#endif
+
     m_plans.clear();
-    saveData();
+    journal(FitnessJournal::ClearAll, 0, FitnessPlan());
+    emit dataCleared();
     qDebug() << "All fitness data cleared";
 }
 
+bool FitnessManager::exportJson(const QString &path)
+{
+    ensureLoaded();
+
+    FitnessPlanStore exported;
+    const FitnessPlanStore *store = &m_plans;
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        exported.assign(m_database->range(std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max()));
+        store = &exported;
+    }
+#endif
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to export fitness data to:" << path << file.errorString();
+        return false;
+    }
+
+    QJsonObject json = plansToJson(*store, 0);
+    json["recurrences"] = recurrencesToJson();
+    file.write(QJsonDocument(json).toJson());
+    if (!file.commit()) {
+        qWarning() << "Failed to export fitness data to:" << path << file.errorString();
+        return false;
+    }
+    qDebug() << "Fitness data exported to:" << path;
+    return true;
+}
+
+bool FitnessManager::importJson(const QString &path)
+{
+    ensureLoaded();
+
+    if (!readJsonFile(path, nullptr)) {
+        return false;
+    }
+    m_searchIndex.clear();
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        // One transaction: one commit instead of one per plan, and a
+        // failed import leaves the previous plans in place
+        bool imported = m_database->beginBatch() && m_database->clear();
+        for (auto day = m_plans.begin(); imported && day != m_plans.end(); ++day) {
+            for (const FitnessPlan &plan : day->plans) {
+                if (!m_database->addPlan(day->julianDay, plan)) {
+                    imported = false;
+                    break;
+                }
+            }
+        }
+        imported = imported && m_database->commitBatch();
+        if (!imported) {
+            m_database->rollbackBatch();
+            qWarning() << "Failed to import fitness data into the database:" << path;
+        }
+        m_plans.clear();
+        emit dataLoaded();
+        return imported;
+    }
+#endif
+
+    // The imported store replaces everything the journal holds
+    compactJournal(true);
+    emit dataLoaded();
+    return true;
+}
+
+bool FitnessManager::readJsonFile(const QString &path, quint64 *journalSequence)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (doc.isNull() || !doc.isObject()) {
+        qWarning() << "Invalid fitness data file format:" << path;
+        return false;
+    }
+
+    const quint64 sequence = plansFromJson(doc.object());
+    if (doc.object().contains("recurrences")) {
+        recurrencesFromJson(doc.object()["recurrences"].toArray());
+        saveRecurrences();
+    }
+    if (journalSequence) {
+        *journalSequence = sequence;
+    }
+    return true;
+}
+
+quint64 FitnessManager::findPlanId(qint64 julianDay, const QString &name)
+{
+    // The first plan with that name, as before plans had IDs
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        for (const FitnessPlan &plan : m_database->plans(julianDay)) {
+            if (plan.name == name) {
+                return plan.id;
+            }
+        }
+        return 0;
+    }
+#endif
+
+    if (const FitnessDay *day = m_plans.day(julianDay)) {
+        for (const FitnessPlan &plan : day->plans) {
+            if (plan.name == name) {
+                return plan.id;
+            }
+        }
+    }
+    return 0;
+}
+
+bool FitnessManager::lookupPlan(quint64 id, qint64 *julianDay, FitnessPlan *plan)
+{
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        qint64 day = 0;
+        if (!m_database->dayOf(id, &day)) {
+            return false;
+        }
+        for (const FitnessPlan &candidate : m_database->plans(day)) {
+            if (candidate.id == id) {
+                if (julianDay) {
+                    *julianDay = day;
+                }
+                *plan = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+#endif
+
+    const FitnessPlan *found = m_plans.findPlan(id, julianDay);
+    if (!found) {
+        return false;
+    }
+    *plan = *found;
+    return true;
+}
+
+bool FitnessManager::insertPlan(qint64 julianDay, FitnessPlan &plan)
+{
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        plan.id = m_database->addPlan(julianDay, plan);
+        if (plan.id == 0) {
+            return false;
+        }
+    } else
+#endif
+    {
+        plan.id = m_plans.addPlan(julianDay, plan);
+        journal(FitnessJournal::AddPlan, julianDay, plan);
+    }
+
+    m_searchIndex.insert(plan.id, julianDay, plan.name, plan.description);
+    return true;
+}
+
+bool FitnessManager::changePlan(quint64 id, const QString &name, const QString &description, qint64 *julianDay)
+{
+    FitnessPlan plan;
+    if (!lookupPlan(id, julianDay, &plan)) {
+        return false;
+    }
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        if (!m_database->updatePlan(id, name, description)) {
+            return false;
+        }
+    } else
+#endif
+    {
+        m_plans.updatePlan(id, name, description);
+        plan.name = name;
+        plan.description = description;
+        journal(FitnessJournal::UpdatePlan, *julianDay, plan);
+    }
+
+    m_searchIndex.insert(id, *julianDay, name, description);
+    return true;
+}
+
+bool FitnessManager::completePlan(quint64 id, bool completed, qint64 *julianDay, FitnessPlan *plan)
+{
+    if (!lookupPlan(id, julianDay, plan)) {
+        return false;
+    }
+    plan->completed = completed;
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        return m_database->setCompletedById(id, completed);
+    }
+#endif
+
+    m_plans.setCompletedById(id, completed);
+    journal(FitnessJournal::SetCompleted, *julianDay, *plan);
+    return true;
+}
+
+bool FitnessManager::relocatePlan(quint64 id, qint64 julianDay, qint64 *fromDay)
+{
+    FitnessPlan plan;
+    if (!lookupPlan(id, fromDay, &plan)) {
+        return false;
+    }
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        if (!m_database->movePlan(id, julianDay)) {
+            return false;
+        }
+    } else
+#endif
+    {
+        // Keeps the ID, createdAt and completion
+        m_plans.movePlan(id, julianDay);
+        journal(FitnessJournal::MovePlan, julianDay, plan);
+    }
+
+    m_searchIndex.move(id, julianDay);
+    return true;
+}
+
+bool FitnessManager::erasePlan(quint64 id, qint64 *julianDay, FitnessPlan *plan)
+{
+    if (!lookupPlan(id, julianDay, plan)) {
+        return false;
+    }
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        if (!m_database->removePlanById(id)) {
+            return false;
+        }
+    } else
+#endif
+    {
+        m_plans.removePlanById(id);
+        journal(FitnessJournal::RemovePlan, *julianDay, *plan);
+    }
+
+    m_searchIndex.remove(id);
+    return true;
+}
+
+void FitnessManager::applyRecord(const FitnessJournal::Record &record)
+{
+    // Records from before plan IDs carry id 0 and address plans by name
+    const quint64 id = record.plan.id;
+    switch (record.operation) {
+    case FitnessJournal::AddPlan:
+        m_plans.addPlan(record.julianDay, record.plan);
+        break;
+    case FitnessJournal::RemovePlan:
+        if (id != 0) {
+            m_plans.removePlanById(id);
+        } else {
+            m_plans.removePlan(record.julianDay, record.plan.name);
+        }
+        break;
+    case FitnessJournal::SetCompleted:
+        if (id != 0) {
+            m_plans.setCompletedById(id, record.plan.completed);
+        } else {
+            m_plans.setCompleted(record.julianDay, record.plan.name, record.plan.completed);
+        }
+        break;
+    case FitnessJournal::UpdatePlan:
+        m_plans.updatePlan(id, record.plan.name, record.plan.description);
+        break;
+    case FitnessJournal::MovePlan:
+        m_plans.movePlan(id, record.julianDay);
+        break;
+    case FitnessJournal::ClearAll:
+        m_plans.clear();
+        break;
+    }
+}
+
+void FitnessManager::journal(FitnessJournal::Operation operation, qint64 julianDay, const FitnessPlan &plan)
+{
+    FitnessJournal::Record record;
+    record.operation = operation;
+    record.julianDay = julianDay;
+    record.plan = plan;
+
+    const qint64 sizeBefore = m_journal.size();
+    if (!m_journal.append(record)) {
+        qWarning() << "Failed to journal fitness edit for date:" << QDate::fromJulianDay(julianDay).toString();
+    } else if (m_persistenceWorker) {
+        scheduleJournalSync(m_journal.size() - sizeBefore);
+    }
+
+    // Fold history into a snapshot off the GUI thread once the journal grows
+    if (m_journal.needsCompaction()) {
+        compactJournal(false);
+    }
+}
+
+void FitnessManager::scheduleJournalSync(qint64 bytes)
+{
+    m_unsyncedJournalBytes->fetch_add(bytes);
+
+    // Coalesced by path: twenty quick edits share one fsync. Syncing
+    // through a second handle flushes the file, not just that handle.
+    const QString path = m_journal.path();
+    const QSharedPointer<std::atomic<qint64>> unsynced = m_unsyncedJournalBytes;
+    m_persistenceWorker->schedule(path, [path, unsynced]() -> qint64 {
+        const qint64 bytes = unsynced->exchange(0);
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append) || !FitnessJournal::syncFile(file)) {
+            qWarning() << "Failed to sync fitness journal:" << path;
+            return -1;
+        }
+        return bytes;
+    });
+}
+
+bool FitnessManager::compactJournal(bool wait)
+{
+    // The new snapshot replaces the file the store may still map, which
+    // Windows refuses; decoding the remaining months releases the mapping
+    m_plans.materializeAll();
+
+    // What could not be read is still in the old file; never write over it
+    if (m_plans.takeSnapshotDamaged()) {
+        m_dataFileDamaged = true;
+    }
+    if (m_dataFileDamaged && !preserveDamagedDataFile()) {
+        return false;
+    }
+
+    const QString path = m_dataFilePath;
+    auto writer = [path](const FitnessPlanStore &plans, quint64 sequence) {
+        return writeSnapshot(path, plans, sequence);
+    };
+    if (wait) {
+        return m_journal.compactNow(m_plans, writer);
+    }
+    m_journal.compact(m_plans, writer);
+    return true;
+}
+
+bool FitnessManager::preserveDamagedDataFile()
+{
+    m_dataFileDamaged = false;
+    if (!QFile::exists(m_dataFilePath)) {
+        return true;
+    }
+
+    const QString backupPath = QStringLiteral("%1.damaged-%2")
+        .arg(m_dataFilePath, QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss")));
+    if (!QFile::rename(m_dataFilePath, backupPath)) {
+        m_dataFileDamaged = true;
+        qWarning() << "Keeping damaged fitness data file, not compacting over it:" << m_dataFilePath;
+        return false;
+    }
+
+    qWarning() << "Damaged fitness data file kept as:" << backupPath
+               << "- plans that could not be read are missing until it is restored";
+    return true;
+}
+
+bool FitnessManager::writeSnapshot(const QString &path, const FitnessPlanStore &store, quint64 journalSequence)
+{
+    return FitnessSnapshot::write(path, store, journalSequence);
+}
+
 QString FitnessManager::getDataFilePath() const
 {
     return m_dataFilePath;
 }
 
-QJsonObject FitnessManager::plansToJson() const
+QJsonObject FitnessManager::plansToJson(const FitnessPlanStore &store, quint64 journalSequence)
 {
     QJsonObject json;
     json["version"] = "1.0";
+    json["journalSequence"] = QString::number(journalSequence); // Exceeds a double's exact range
     
     QJsonObject fitness;
     QJsonArray plansArray;
     
-    for (auto it = m_plans.begin(); it != m_plans.end(); ++it) {
+    for (const FitnessDay &day : store) {
         QJsonObject dateEntry;
-        dateEntry["date"] = it.key();
+        dateEntry["date"] = day.date().toString(Qt::ISODate);
         
         QJsonArray plans;
-        for (const auto &plan : it.value()) {
+        for (const auto &plan : day.plans) {
             QJsonObject planObj;
+            planObj["id"] = QString::number(plan.id); // Exceeds a double's exact range
             planObj["name"] = plan.name;
             planObj["description"] = plan.description;
             planObj["completed"] = plan.completed;
@@ -230,9 +1027,9 @@ QJsonObject FitnessManager::plansToJson() const
     return json;
 }
 
-void FitnessManager::plansFromJson(const QJsonObject &json)
+quint64 FitnessManager::plansFromJson(const QJsonObject &json)
 {
-    m_plans.clear();
+    QVector<FitnessDay> days;
     
     if (json.contains("fitness") && json["fitness"].isObject()) {
         QJsonObject fitness = json["fitness"].toObject();
@@ -243,38 +1040,50 @@ void FitnessManager::plansFromJson(const QJsonObject &json)
             for (const auto &value : plansArray) {
                 if (value.isObject()) {
                     QJsonObject dateEntry = value.toObject();
-                    QString dateKey = dateEntry["date"].toString();
+                    const QDate date = QDate::fromString(dateEntry["date"].toString(), Qt::ISODate);
+                    if (!date.isValid()) {
+                        qWarning() << "Skipping fitness entry with invalid date:" << dateEntry["date"].toString();
+                        continue;
+                    }
                     
                     if (dateEntry.contains("plans") && dateEntry["plans"].isArray()) {
                         QJsonArray plans = dateEntry["plans"].toArray();
-                        QList<FitnessPlan> planList;
+                        FitnessDay day(date.toJulianDay());
                         
                         for (const auto &planValue : plans) {
                             if (planValue.isObject()) {
                                 QJsonObject planObj = planValue.toObject();
                                 FitnessPlan plan;
+                                plan.id = planObj["id"].toString().toULongLong(); // 0 when absent: assigned on load
                                 plan.name = planObj["name"].toString();
                                 plan.description = planObj["description"].toString();
                                 plan.completed = planObj["completed"].toBool();
                                 plan.createdAt = QDateTime::fromString(planObj["createdAt"].toString(), Qt::ISODate);
                                 
-                                planList.append(plan);
+                                day.plans.append(plan);
                             }
                         }
                         
-                        if (!planList.isEmpty()) {
-                            m_plans[dateKey] = planList;
+                        if (!day.plans.isEmpty()) {
+                            days.append(day);
                         }
                     }
                 }
             }
         }
     }
+
+    // One sort for the whole file instead of an insert per day
+    m_plans.assign(days);
+
+    return json["journalSequence"].toString().toULongLong();
 }
 
 QVariantMap FitnessManager::planToVariantMap(const FitnessPlan &plan) const
 {
     QVariantMap map;
+    map["id"] = plan.id;
+    map["recurrenceId"] = plan.recurrenceId;
     map["name"] = plan.name;
     map["description"] = plan.description;
     map["completed"] = plan.completed;
@@ -290,4 +1099,247 @@ FitnessPlan FitnessManager::planFromVariantMap(const QVariantMap &map) const
     plan.completed = map["completed"].toBool();
     plan.createdAt = map["createdAt"].toDateTime();
     return plan;
-}
\ No newline at end of file
+}
+
+QVariantList FitnessManager::rangeToVariantList(const FitnessPlanStore::Range &range) const
+{
+    QVariantList result;
+    result.reserve(range.size());
+
+    // Only days that have plans are visited
+    for (const FitnessDay &day : range) {
+        QVariantMap dateEntry;
+        dateEntry["date"] = day.date();
+        dateEntry["completedCount"] = day.completedCount;
+        dateEntry["totalCount"] = day.totalCount();
+
+        QVariantList plans;
+        for (const auto &plan : day.plans) {
+            plans.append(planToVariantMap(plan));
+        }
+        dateEntry["plans"] = plans;
+
+        result.append(dateEntry);
+    }
+
+    return result;
+}
+
+#ifdef DESKTOPELF_SQLITE_BACKEND
+bool FitnessManager::openDatabase()
+{
+    if (m_database) {
+        return true;
+    }
+
+    m_database.reset(new FitnessSqlStore(dataDirectory() + "/fitness_data.sqlite"));
+    if (!m_database->open()) {
+        qWarning() << "Fitness database unavailable, keeping the JSON store";
+        m_database.reset();
+        return false;
+    }
+    return true;
+}
+
+void FitnessManager::migrateToDatabase()
+{
+    if (!m_database) {
+        return;
+    }
+
+    // One-shot: the JSON snapshot and journal just loaded become the
+    // database's first rows, then stay on disk untouched as a backup
+    if (!m_database->migrateFrom(m_plans)) {
+        qWarning() << "Fitness migration failed, keeping the JSON store";
+        m_database.reset();
+        return;
+    }
+
+    m_plans.clear();
+    qDebug() << "Fitness data served from:" << m_database->databasePath();
+}
+#endif
+
+void FitnessManager::ensureSearchIndex()
+{
+    if (m_searchIndex.isBuilt()) {
+        return;
+    }
+    m_searchIndex.markBuilt();
+
+    // The one full walk, on the first search rather than at startup
+    QElapsedTimer timer;
+    timer.start();
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    if (m_database) {
+        for (const FitnessDay &day : m_database->range(std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max())) {
+            for (const FitnessPlan &plan : day.plans) {
+                m_searchIndex.insert(plan.id, day.julianDay, plan.name, plan.description);
+            }
+        }
+    } else
+#endif
+    for (const FitnessDay &day : m_plans) {
+        for (const FitnessPlan &plan : day.plans) {
+            m_searchIndex.insert(plan.id, day.julianDay, plan.name, plan.description);
+        }
+    }
+    qDebug() << "Indexed" << m_searchIndex.planCount() << "fitness plans for search in" << timer.elapsed() << "ms";
+}
+
+FitnessRecurrence *FitnessManager::findRecurrence(quint64 id)
+{
+    for (FitnessRecurrence &recurrence : m_recurrences) {
+        if (recurrence.id == id) {
+            return &recurrence;
+        }
+    }
+    return nullptr;
+}
+
+FitnessPlan FitnessManager::occurrencePlan(const FitnessRecurrence &recurrence, qint64 julianDay)
+{
+    FitnessPlan plan(recurrence.name, recurrence.description);
+    plan.recurrenceId = recurrence.id;
+    plan.createdAt = recurrence.createdAt;
+    plan.completed = recurrence.overrides.value(julianDay).completed;
+    return plan;
+}
+
+QList<FitnessPlan> FitnessManager::occurrencesOn(qint64 julianDay) const
+{
+    QList<FitnessPlan> plans;
+    for (const FitnessRecurrence &recurrence : m_recurrences) {
+        if (recurrence.occursOn(julianDay) && !recurrence.overrides.value(julianDay).skipped) {
+            plans.append(occurrencePlan(recurrence, julianDay));
+        }
+    }
+    return plans;
+}
+
+void FitnessManager::mergeOccurrences(QVector<FitnessDay> &days, qint64 firstDay, qint64 lastDay) const
+{
+    if (m_recurrences.isEmpty()) {
+        return;
+    }
+
+    const qint64 today = QDate::currentDate().toJulianDay();
+    QMap<qint64, QList<FitnessPlan>> expanded;
+    for (const FitnessRecurrence &recurrence : m_recurrences) {
+        const qint64 first = qMax(firstDay, recurrence.startDay);
+        const qint64 last = qMin(lastDay, qMax(first, today) + kRecurrenceHorizonDays);
+        for (qint64 day : recurrence.occurrences(first, last)) {
+            if (!recurrence.overrides.value(day).skipped) {
+                expanded[day].append(occurrencePlan(recurrence, day));
+            }
+        }
+    }
+    if (expanded.isEmpty()) {
+        return;
+    }
+
+    // Both sides are sorted by day: one merge, occurrences after stored plans
+    QVector<FitnessDay> merged;
+    merged.reserve(days.size() + expanded.size());
+    auto stored = days.cbegin();
+    for (auto it = expanded.cbegin(); it != expanded.cend(); ++it) {
+        while (stored != days.cend() && stored->julianDay < it.key()) {
+            merged.append(*stored++);
+        }
+        FitnessDay day(it.key());
+        if (stored != days.cend() && stored->julianDay == it.key()) {
+            day = *stored++;
+        }
+        for (const FitnessPlan &plan : it.value()) {
+            day.plans.append(plan);
+            day.completedCount += plan.completed ? 1 : 0;
+        }
+        merged.append(day);
+    }
+    while (stored != days.cend()) {
+        merged.append(*stored++);
+    }
+    days.swap(merged);
+}
+
+FitnessRecurrence FitnessManager::recurrenceFromVariantMap(const QVariantMap &map)
+{
+    // Dates may arrive as QDate, a JS Date (QDateTime) or an ISO string
+    QVariantMap normalized = map;
+    for (const char *key : { "start", "until" }) {
+        const QVariant value = map.value(key);
+        if (value.canConvert<QDate>() && value.toDate().isValid()) {
+            normalized[key] = value.toDate().toString(Qt::ISODate);
+        }
+    }
+    if (!normalized.contains("start")) {
+        normalized["start"] = QDate::currentDate().toString(Qt::ISODate);
+    }
+    return FitnessRecurrence::fromJson(QJsonObject::fromVariantMap(normalized));
+}
+
+QJsonArray FitnessManager::recurrencesToJson() const
+{
+    QJsonArray rules;
+    for (const FitnessRecurrence &recurrence : m_recurrences) {
+        rules.append(recurrence.toJson());
+    }
+    return rules;
+}
+
+void FitnessManager::recurrencesFromJson(const QJsonArray &rules)
+{
+    m_recurrences.clear();
+    for (const auto &value : rules) {
+        FitnessRecurrence recurrence = FitnessRecurrence::fromJson(value.toObject());
+        if (!recurrence.isValid()) {
+            qWarning() << "Skipping invalid recurring fitness plan:" << recurrence.name;
+            continue;
+        }
+        if (recurrence.id == 0 || findRecurrence(recurrence.id)) {
+            recurrence.id = m_nextRecurrenceId++;
+        }
+        m_nextRecurrenceId = qMax(m_nextRecurrenceId, recurrence.id + 1);
+        m_recurrences.append(recurrence);
+    }
+}
+
+void FitnessManager::loadRecurrences()
+{
+    QFile file(m_recurrenceFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_recurrences.clear();
+        return;
+    }
+
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) {
+        qWarning() << "Invalid recurring fitness plan file:" << m_recurrenceFilePath;
+        m_recurrences.clear();
+        return;
+    }
+
+    m_nextRecurrenceId = qMax<quint64>(1, doc.object()["nextId"].toString().toULongLong());
+    recurrencesFromJson(doc.object()["recurrences"].toArray());
+}
+
+void FitnessManager::saveRecurrences()
+{
+    // Rules and their exceptions are small; the whole file is rewritten
+    QJsonObject json;
+    json["version"] = "1.0";
+    json["nextId"] = QString::number(m_nextRecurrenceId);
+    json["recurrences"] = recurrencesToJson();
+
+    const QString path = m_recurrenceFilePath;
+    if (m_persistenceWorker) {
+        m_persistenceWorker->schedule(path, [path, json]() {
+            return PersistenceWorker::writeFile(path, QJsonDocument(json).toJson());
+        });
+        return;
+    }
+
+    if (PersistenceWorker::writeFile(path, QJsonDocument(json).toJson()) < 0) {
+        qWarning() << "Failed to save recurring fitness plans to:" << path;
+    }
+}
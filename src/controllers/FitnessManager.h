@@ -6,59 +6,165 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <QPointer>
+#include <QSharedPointer>
+#include <atomic>
+#include "FitnessJournal.h"
+#include "FitnessPlanStore.h"
+#include "FitnessRecurrence.h"
+#include "FitnessSearchIndex.h"
+#include "PersistenceWorker.h"
 
-struct FitnessPlan {
-    QString name;
-    QString description;
-    bool completed;
-    QDateTime createdAt;
-
-    FitnessPlan() : completed(false), createdAt(QDateTime::currentDateTime()) {}
-    FitnessPlan(const QString &n, const QString &desc) 
-        : name(n), description(desc), completed(false), createdAt(QDateTime::currentDateTime()) {}
-};
+#ifdef DESKTOPELF_SQLITE_BACKEND
+#include <QScopedPointer>
+#include "FitnessSqlStore.h"
+#endif
 
 class FitnessManager : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(bool loaded READ isLoaded NOTIFY loadedChanged)
 
 public:
     explicit FitnessManager(QObject *parent = nullptr);
     ~FitnessManager();
 
+    // Days with plans in an inclusive Julian day range, for C++ views
+    // that would rather not go through QVariant. Recurring occurrences
+    // are expanded into it, up to a year past today or firstDay.
+    QVector<FitnessDay> daysInRange(qint64 firstDay, qint64 lastDay);
+
+    // With a worker, journal records are only flushed to the OS on the
+    // GUI thread and the fsync for a burst of edits runs once, behind it
+    void setPersistenceWorker(PersistenceWorker *worker);
+
+    // Data is loaded on first use, not on construction
+    bool isLoaded() const;
+
 public slots:
     // Plan management
-    Q_INVOKABLE void addPlan(const QDate &date, const QString &name, const QString &description = "");
+    Q_INVOKABLE quint64 addPlan(const QDate &date, const QString &name, const QString &description = ""); // Returns the plan ID, 0 on failure
     Q_INVOKABLE void removePlan(const QDate &date, const QString &name);
     Q_INVOKABLE void markCompleted(const QDate &date, const QString &name, bool completed);
+
+    // By plan ID: a hash lookup instead of a name scan, and duplicate
+    // names on one day stay distinct
+    Q_INVOKABLE bool updatePlan(quint64 id, const QString &name, const QString &description);
+    Q_INVOKABLE bool renamePlan(quint64 id, const QString &name);
+    Q_INVOKABLE bool setPlanCompleted(quint64 id, bool completed);
+    Q_INVOKABLE bool movePlan(quint64 id, const QDate &date);
+    Q_INVOKABLE bool removePlanById(quint64 id);
+    Q_INVOKABLE QVariantMap getPlan(quint64 id); // Empty if unknown; includes "date"
+
+    // Maps with "op" of add, update, move or remove plus their arguments
+    // ("id", "date", "name", "description", "completed"). One SQLite
+    // transaction and one plansChanged instead of a signal per edit.
+    // Returns per operation the new ID for adds, otherwise success.
+    Q_INVOKABLE QVariantList applyBatch(const QVariantList &operations);
+
+    // Recurring plans, stored once and expanded only for the days being
+    // read. The map takes name, description, frequency ("daily",
+    // "weekly" or "monthly"), interval, weekdays (1 = Monday), start,
+    // until and count. Occurrences carry their rule's recurrenceId.
+    Q_INVOKABLE quint64 addRecurrence(const QVariantMap &rule); // Returns the rule ID, 0 if invalid
+    Q_INVOKABLE bool removeRecurrence(quint64 id);
+    Q_INVOKABLE QVariantList getRecurrences();
+    Q_INVOKABLE bool setOccurrenceCompleted(quint64 recurrenceId, const QDate &date, bool completed);
+    Q_INVOKABLE bool skipOccurrence(quint64 recurrenceId, const QDate &date);
     Q_INVOKABLE QVariantList getPlansForDate(const QDate &date);
+
+    // Plans whose name or description holds every word of the query,
+    // words matching by prefix; newest first, each with its "date".
+    // Recurring rules are not searched.
+    Q_INVOKABLE QVariantList searchPlans(const QString &query, int limit = 100);
     Q_INVOKABLE QVariantList getPlansForMonth(int year, int month);
+    Q_INVOKABLE QVariantList getPlansForYear(int year);
+    Q_INVOKABLE QVariantList getPlansInRange(const QDate &from, const QDate &to);
     Q_INVOKABLE bool hasPlansForDate(const QDate &date);
     Q_INVOKABLE int getCompletedCount(const QDate &date);
     Q_INVOKABLE int getTotalCount(const QDate &date);
 
-    // Data management
+    // Data management; edits are journaled as they happen, saveData()
+    // folds the journal into a full snapshot
     Q_INVOKABLE void saveData();
     Q_INVOKABLE void loadData();
+    Q_INVOKABLE void ensureLoaded(); // Loads once; every data call does this itself
     Q_INVOKABLE void clearAllData();
 
+    // JSON stays the exchange format; the store itself is binary
+    Q_INVOKABLE bool exportJson(const QString &path);
+    Q_INVOKABLE bool importJson(const QString &path);
+
 signals:
     void planAdded(const QDate &date, const QString &name);
     void planRemoved(const QDate &date, const QString &name);
     void planCompleted(const QDate &date, const QString &name, bool completed);
-    void dataLoaded();
+    void planUpdated(const QDate &date, quint64 id);
+    void planMoved(const QDate &from, const QDate &to, quint64 id);
+    void plansChanged(const QVariantList &dates); // After applyBatch, each touched day once
+    void recurrencesChanged(); // A rule was added or removed: any day may differ
+    void dataLoaded();    // loadData() or importJson() replaced the data
+    void loadedChanged(); // The first load, however it was triggered
+    void dataCleared();
     void dataSaved();
 
 private:
     QString getDataFilePath() const;
-    QJsonObject plansToJson() const;
-    void plansFromJson(const QJsonObject &json);
+    void readData(); // loadData() without the signals
+    static QJsonObject plansToJson(const FitnessPlanStore &store, quint64 journalSequence);
+    quint64 plansFromJson(const QJsonObject &json); // Returns the snapshot's journal sequence
+    bool readJsonFile(const QString &path, quint64 *journalSequence);
+    bool compactJournal(bool wait);
+    bool preserveDamagedDataFile();
+    static bool writeSnapshot(const QString &path, const FitnessPlanStore &store, quint64 journalSequence);
+    quint64 findPlanId(qint64 julianDay, const QString &name);
+    bool lookupPlan(quint64 id, qint64 *julianDay, FitnessPlan *plan);
+
+    // Edit either backend and journal it, without signals
+    bool insertPlan(qint64 julianDay, FitnessPlan &plan); // Sets plan.id
+    bool changePlan(quint64 id, const QString &name, const QString &description, qint64 *julianDay);
+    bool completePlan(quint64 id, bool completed, qint64 *julianDay, FitnessPlan *plan);
+    bool relocatePlan(quint64 id, qint64 julianDay, qint64 *fromDay);
+    bool erasePlan(quint64 id, qint64 *julianDay, FitnessPlan *plan);
+
+    void ensureSearchIndex();
+    FitnessRecurrence *findRecurrence(quint64 id);
+    static FitnessPlan occurrencePlan(const FitnessRecurrence &recurrence, qint64 julianDay);
+    QList<FitnessPlan> occurrencesOn(qint64 julianDay) const; // Skipped ones left out
+    void mergeOccurrences(QVector<FitnessDay> &days, qint64 firstDay, qint64 lastDay) const;
+    static FitnessRecurrence recurrenceFromVariantMap(const QVariantMap &map);
+    QJsonArray recurrencesToJson() const;
+    void recurrencesFromJson(const QJsonArray &rules);
+    void loadRecurrences();
+    void saveRecurrences();
+
+    void applyRecord(const FitnessJournal::Record &record);
+    void journal(FitnessJournal::Operation operation, qint64 julianDay, const FitnessPlan &plan);
+    void scheduleJournalSync(qint64 bytes);
     QVariantMap planToVariantMap(const FitnessPlan &plan) const;
     FitnessPlan planFromVariantMap(const QVariantMap &map) const;
+    QVariantList rangeToVariantList(const FitnessPlanStore::Range &range) const;
+
+    // Data storage: Julian day -> list of plans, sorted by day
+    FitnessPlanStore m_plans;
+    QString m_dataFilePath;   // Binary snapshot
+    QString m_legacyFilePath; // JSON snapshot written by older versions
+    QString m_recurrenceFilePath;
+    FitnessJournal m_journal;
+    QPointer<PersistenceWorker> m_persistenceWorker;
+    QSharedPointer<std::atomic<qint64>> m_unsyncedJournalBytes; // Shared with the queued sync job
+    QVector<FitnessRecurrence> m_recurrences; // Few rules; searched linearly
+    quint64 m_nextRecurrenceId;
+    FitnessSearchIndex m_searchIndex; // Built on the first search
+    bool m_loaded;
+    bool m_dataFileDamaged; // Unreadable snapshot on disk: moved aside before the next one is written
 
-    // Data storage: date string -> list of plans
-    QMap<QString, QList<FitnessPlan>> m_plans;
-    QString m_dataFilePath;
+#ifdef DESKTOPELF_SQLITE_BACKEND
+    // When open, plans live in SQLite and m_plans only stages the migration
+    QScopedPointer<FitnessSqlStore> m_database;
+    bool openDatabase();
+    void migrateToDatabase();
+#endif
 };
 
 #endif // FITNESSMANAGER_H
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "FitnessMonthModel.h"
+
+FitnessDayModel::FitnessDayModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int FitnessDayModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_plans.size();
+}
+
+QVariant FitnessDayModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_plans.size()) {
+        return QVariant();
+    }
+
+    const FitnessPlan &plan = m_plans.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return plan.name;
+    case DescriptionRole:
+        return plan.description;
+    case CompletedRole:
+        return plan.completed;
+    case CreatedAtRole:
+        return plan.createdAt;
+    case IdRole:
+        return plan.id;
+    case RecurrenceRole:
+        return plan.recurrenceId;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> FitnessDayModel::roleNames() const
+{
+    return {
+        { NameRole, "name" },
+        { DescriptionRole, "description" },
+        { CompletedRole, "completed" },
+        { CreatedAtRole, "createdAt" },
+        { IdRole, "planId" },
+        { RecurrenceRole, "recurrenceId" }
+    };
+}
+
+void FitnessDayModel::setPlans(const QList<FitnessPlan> &plans)
+{
+    const int oldCount = m_plans.size();
+    const int newCount = plans.size();
+
+    int prefix = 0;
+    while (prefix < oldCount && prefix < newCount && samePlan(m_plans[prefix], plans[prefix])) {
+        ++prefix;
+    }
+
+    if (oldCount == newCount) {
+        // Toggles and same-length edits: change only the rows that differ
+        for (int i = prefix; i < newCount; ++i) {
+            if (!samePlan(m_plans[i], plans[i])) {
+                m_plans[i] = plans[i];
+                emit dataChanged(index(i), index(i));
+            }
+        }
+        return;
+    }
+
+    if (newCount == oldCount + 1 && prefix == oldCount) {
+        // Plans are appended to their day
+        beginInsertRows(QModelIndex(), oldCount, oldCount);
+        m_plans.append(plans.last());
+        endInsertRows();
+        emit countChanged();
+        return;
+    }
+
+    if (newCount == oldCount - 1) {
+        int suffix = prefix;
+        while (suffix < newCount && samePlan(m_plans[suffix + 1], plans[suffix])) {
+            ++suffix;
+        }
+        if (suffix == newCount) {
+            beginRemoveRows(QModelIndex(), prefix, prefix);
+            m_plans.removeAt(prefix);
+            endRemoveRows();
+            emit countChanged();
+            return;
+        }
+    }
+
+    beginResetModel();
+    m_plans = plans;
+    endResetModel();
+    emit countChanged();
+}
+
+bool FitnessDayModel::samePlan(const FitnessPlan &a, const FitnessPlan &b)
+{
+    return a.id == b.id && a.recurrenceId == b.recurrenceId && a.completed == b.completed && a.name == b.name
+        && a.description == b.description && a.createdAt == b.createdAt;
+}
+
+FitnessMonthModel::FitnessMonthModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_firstDay(0)
+    , m_today(0)
+    , m_cells(kCellCount)
+{
+    m_dayModels.reserve(kCellCount);
+    for (int i = 0; i < kCellCount; ++i) {
+        m_dayModels.append(new FitnessDayModel(this));
+    }
+
+    const QDate today = QDate::currentDate();
+    showMonth(today.year(), today.month());
+}
+
+int FitnessMonthModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : kCellCount;
+}
+
+QVariant FitnessMonthModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= kCellCount) {
+        return QVariant();
+    }
+
+    const int row = index.row();
+    const QDate date = QDate::fromJulianDay(m_firstDay + row);
+    switch (role) {
+    case DateRole:
+        // Local midnight, so QML sees the same calendar day in any time zone
+        return date.startOfDay();
+    case Qt::DisplayRole:
+    case DayRole:
+        return date.day();
+    case InMonthRole:
+        return date.month() == m_month.month();
+    case TodayRole:
+        return m_firstDay + row == m_today;
+    case TotalRole:
+        return m_cells[row].total;
+    case CompletedRole:
+        return m_cells[row].completed;
+    case PlansRole:
+        return QVariant::fromValue<QObject *>(m_dayModels[row]);
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> FitnessMonthModel::roleNames() const
+{
+    return {
+        { DateRole, "date" },
+        { DayRole, "day" },
+        { InMonthRole, "inMonth" },
+        { TodayRole, "isToday" },
+        { TotalRole, "total" },
+        { CompletedRole, "completed" },
+        { PlansRole, "plans" }
+    };
+}
+
+FitnessManager *FitnessMonthModel::manager() const
+{
+    return m_manager;
+}
+
+void FitnessMonthModel::setManager(FitnessManager *manager)
+{
+    if (m_manager == manager) {
+        return;
+    }
+
+    if (m_manager) {
+        disconnect(m_manager, nullptr, this, nullptr);
+    }
+    m_manager = manager;
+    if (m_manager) {
+        connect(m_manager, &FitnessManager::planAdded, this, &FitnessMonthModel::refreshDate);
+        connect(m_manager, &FitnessManager::planRemoved, this, &FitnessMonthModel::refreshDate);
+        connect(m_manager, &FitnessManager::planCompleted, this, &FitnessMonthModel::refreshDate);
+        connect(m_manager, &FitnessManager::planUpdated, this, &FitnessMonthModel::refreshDate);
+        connect(m_manager, &FitnessManager::planMoved, this, [this](const QDate &from, const QDate &to) {
+            refreshDate(from);
+            refreshDate(to);
+        });
+        connect(m_manager, &FitnessManager::plansChanged, this, [this](const QVariantList &dates) {
+            for (const QVariant &date : dates) {
+                refreshDate(date.toDate());
+            }
+        });
+        connect(m_manager, &FitnessManager::dataLoaded, this, &FitnessMonthModel::reload);
+        connect(m_manager, &FitnessManager::dataCleared, this, &FitnessMonthModel::reload);
+        connect(m_manager, &FitnessManager::recurrencesChanged, this, &FitnessMonthModel::reload);
+    }
+
+    reload();
+    emit managerChanged();
+}
+
+int FitnessMonthModel::year() const
+{
+    return m_month.year();
+}
+
+int FitnessMonthModel::month() const
+{
+    return m_month.month();
+}
+
+void FitnessMonthModel::showMonth(int year, int month)
+{
+    const QDate first(year, month, 1);
+    if (!first.isValid() || first == m_month) {
+        return;
+    }
+
+    m_month = first;
+    m_firstDay = first.toJulianDay() - (first.dayOfWeek() - 1);
+    reload();
+    emit monthChanged();
+}
+
+void FitnessMonthModel::showToday()
+{
+    const QDate today = QDate::currentDate();
+    showMonth(today.year(), today.month());
+}
+
+void FitnessMonthModel::nextMonth()
+{
+    const QDate next = m_month.addMonths(1);
+    showMonth(next.year(), next.month());
+}
+
+void FitnessMonthModel::previousMonth()
+{
+    const QDate previous = m_month.addMonths(-1);
+    showMonth(previous.year(), previous.month());
+}
+
+void FitnessMonthModel::reload()
+{
+    m_today = QDate::currentDate().toJulianDay();
+
+    QVector<FitnessDay> days;
+    if (m_manager) {
+        days = m_manager->daysInRange(m_firstDay, m_firstDay + kCellCount - 1);
+    }
+
+    // Days come back sorted, so one walk lines them up with the cells
+    auto day = days.cbegin();
+    for (int row = 0; row < kCellCount; ++row) {
+        if (day != days.cend() && day->julianDay == m_firstDay + row) {
+            m_dayModels[row]->setPlans(day->plans);
+            m_cells[row].total = day->totalCount();
+            m_cells[row].completed = day->completedCount;
+            ++day;
+        } else {
+            m_dayModels[row]->setPlans(QList<FitnessPlan>());
+            m_cells[row] = Cell();
+        }
+    }
+
+    // Cells stay in place; delegates rebind their roles without being recreated
+    emit dataChanged(index(0), index(kCellCount - 1));
+}
+
+void FitnessMonthModel::refreshDate(const QDate &date)
+{
+    const qint64 row = date.toJulianDay() - m_firstDay;
+    if (!m_manager || row < 0 || row >= kCellCount) {
+        return;
+    }
+
+    const QVector<FitnessDay> days = m_manager->daysInRange(date.toJulianDay(), date.toJulianDay());
+    if (days.isEmpty()) {
+        refreshCell(int(row), QList<FitnessPlan>(), 0);
+    } else {
+        refreshCell(int(row), days.first().plans, days.first().completedCount);
+    }
+}
+
+void FitnessMonthModel::refreshCell(int row, const QList<FitnessPlan> &plans, int completed)
+{
+    m_dayModels[row]->setPlans(plans);
+
+    Cell &cell = m_cells[row];
+    if (cell.total == plans.size() && cell.completed == completed) {
+        return;
+    }
+    cell.total = plans.size();
+    cell.completed = completed;
+    emit dataChanged(index(row), index(row), { TotalRole, CompletedRole });
+}
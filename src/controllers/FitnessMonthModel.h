@@ -0,0 +1,110 @@
+#ifndef FITNESSMONTHMODEL_H
+#define FITNESSMONTHMODEL_H
+
+#include <QAbstractListModel>
+#include <QDate>
+#include <QPointer>
+#include <QVector>
+#include "FitnessManager.h"
+
+// Plans of one calendar cell. The month model owns one per cell and
+// reuses them across months, so a cell's list view is never rebuilt;
+// updates insert, remove or change only the rows that differ.
+class FitnessDayModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    enum Role {
+        NameRole = Qt::UserRole + 1,
+        DescriptionRole,
+        CompletedRole,
+        CreatedAtRole,
+        IdRole,
+        RecurrenceRole
+    };
+
+    explicit FitnessDayModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    void setPlans(const QList<FitnessPlan> &plans);
+
+signals:
+    void countChanged();
+
+private:
+    static bool samePlan(const FitnessPlan &a, const FitnessPlan &b);
+
+    QList<FitnessPlan> m_plans;
+};
+
+// The 42-cell (six weeks, Monday first) grid of one calendar month.
+// Each month is filled from a single range query; afterwards an edit
+// signalled by the manager refreshes just the cell it touched, and
+// switching months updates the cells in place rather than resetting.
+class FitnessMonthModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(FitnessManager *manager READ manager WRITE setManager NOTIFY managerChanged)
+    Q_PROPERTY(int year READ year NOTIFY monthChanged)
+    Q_PROPERTY(int month READ month NOTIFY monthChanged)
+
+public:
+    enum Role {
+        DateRole = Qt::UserRole + 1,
+        DayRole,
+        InMonthRole,
+        TodayRole,
+        TotalRole,
+        CompletedRole,
+        PlansRole
+    };
+
+    static const int kCellCount = 42;
+
+    explicit FitnessMonthModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    FitnessManager *manager() const;
+    void setManager(FitnessManager *manager);
+    int year() const;
+    int month() const;
+
+public slots:
+    void showMonth(int year, int month);
+    void showToday();
+    void nextMonth();
+    void previousMonth();
+    void reload();
+
+signals:
+    void managerChanged();
+    void monthChanged();
+
+private slots:
+    void refreshDate(const QDate &date);
+
+private:
+    struct Cell {
+        int total = 0;
+        int completed = 0;
+    };
+
+    void refreshCell(int row, const QList<FitnessPlan> &plans, int completed);
+
+    QPointer<FitnessManager> m_manager;
+    QDate m_month;     // First day of the shown month
+    qint64 m_firstDay; // Julian day of the top-left cell
+    qint64 m_today;
+    QVector<Cell> m_cells;
+    QVector<FitnessDayModel *> m_dayModels; // Children, one per cell
+};
+
+#endif // FITNESSMONTHMODEL_H
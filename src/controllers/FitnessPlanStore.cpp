@@ -0,0 +1,495 @@
+#include "FitnessPlanStore.h"
+#include "FitnessSnapshot.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace {
+bool dayBefore(const FitnessDay &day, qint64 julianDay)
+{
+    return day.julianDay < julianDay;
+}
+
+bool dayAfter(qint64 julianDay, const FitnessDay &day)
+{
+    return julianDay < day.julianDay;
+}
+}
+
+bool FitnessPlanStore::isEmpty() const
+{
+    return m_days.isEmpty() && m_pendingMonths.isEmpty();
+}
+
+int FitnessPlanStore::dayCount() const
+{
+    return m_days.size() + m_pendingDayCount;
+}
+
+int FitnessPlanStore::planCount() const
+{
+    return m_planCount + m_pendingPlanCount;
+}
+
+FitnessPlanStore::const_iterator FitnessPlanStore::begin() const
+{
+    // Walking everything needs everything
+    materializeAll();
+    return m_days.cbegin();
+}
+
+FitnessPlanStore::const_iterator FitnessPlanStore::end() const
+{
+    materializeAll();
+    return m_days.cend();
+}
+
+const FitnessDay *FitnessPlanStore::day(qint64 julianDay) const
+{
+    ensureMonths(julianDay, julianDay);
+    const auto it = std::lower_bound(m_days.cbegin(), m_days.cend(), julianDay, dayBefore);
+    if (it == m_days.cend() || it->julianDay != julianDay) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+FitnessPlanStore::Range FitnessPlanStore::range(qint64 firstDay, qint64 lastDay) const
+{
+    ensureMonths(firstDay, lastDay);
+
+    Range result;
+    result.first = std::lower_bound(m_days.cbegin(), m_days.cend(), firstDay, dayBefore);
+    result.last = std::upper_bound(result.first, m_days.cend(), lastDay, dayAfter);
+    return result;
+}
+
+FitnessPlanStore::Range FitnessPlanStore::range(const QDate &first, const QDate &last) const
+{
+    return range(first.toJulianDay(), last.toJulianDay());
+}
+
+FitnessPlanStore::Range FitnessPlanStore::month(int year, int month) const
+{
+    // An invalid date's Julian day is the minimum qint64; the end would wrap
+    const QDate first(year, month, 1);
+    if (!first.isValid()) {
+        return Range{ m_days.cend(), m_days.cend() };
+    }
+    return range(first.toJulianDay(), first.toJulianDay() + first.daysInMonth() - 1);
+}
+
+FitnessPlanStore::Range FitnessPlanStore::year(int year) const
+{
+    const QDate first(year, 1, 1);
+    if (!first.isValid()) {
+        return Range{ m_days.cend(), m_days.cend() };
+    }
+    return range(first, QDate(year, 12, 31));
+}
+
+int FitnessPlanStore::completedCount(qint64 julianDay) const
+{
+    const FitnessDay *entry = day(julianDay);
+    return entry ? entry->completedCount : 0;
+}
+
+int FitnessPlanStore::totalCount(qint64 julianDay) const
+{
+    const FitnessDay *entry = day(julianDay);
+    return entry ? entry->totalCount() : 0;
+}
+
+quint64 FitnessPlanStore::addPlan(qint64 julianDay, const FitnessPlan &plan)
+{
+    ensureMonths(julianDay, julianDay);
+
+    // Snapshot months need no check: IDs issued after a snapshot start at its nextId
+    QList<FitnessPlan> added;
+    added.append(plan);
+    adoptPlans(added, julianDay);
+
+    auto it = find(julianDay);
+    if (it == m_days.end()) {
+        // Plans are mostly added for today or later, so this is usually an append
+        it = std::lower_bound(m_days.begin(), m_days.end(), julianDay, dayBefore);
+        it = m_days.insert(it, FitnessDay(julianDay));
+    }
+
+    it->plans.append(added.first());
+    if (plan.completed) {
+        ++it->completedCount;
+    }
+    ++m_planCount;
+    return added.first().id;
+}
+
+bool FitnessPlanStore::removePlan(qint64 julianDay, const QString &name)
+{
+    ensureMonths(julianDay, julianDay);
+    auto it = find(julianDay);
+    if (it == m_days.end()) {
+        return false;
+    }
+
+    for (int i = 0; i < it->plans.size(); ++i) {
+        if (it->plans[i].name == name) {
+            removeAt(it, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FitnessPlanStore::setCompleted(qint64 julianDay, const QString &name, bool completed)
+{
+    ensureMonths(julianDay, julianDay);
+    auto it = find(julianDay);
+    if (it == m_days.end()) {
+        return false;
+    }
+
+    for (FitnessPlan &plan : it->plans) {
+        if (plan.name == name) {
+            if (plan.completed != completed) {
+                plan.completed = completed;
+                it->completedCount += completed ? 1 : -1;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void FitnessPlanStore::setDay(qint64 julianDay, const QList<FitnessPlan> &plans)
+{
+    ensureMonths(julianDay, julianDay);
+    auto it = find(julianDay);
+    if (it != m_days.end()) {
+        m_planCount -= it->plans.size();
+        for (const FitnessPlan &plan : it->plans) {
+            m_index.remove(plan.id);
+        }
+        if (plans.isEmpty()) {
+            m_days.erase(it);
+            return;
+        }
+    } else {
+        if (plans.isEmpty()) {
+            return;
+        }
+        it = std::lower_bound(m_days.begin(), m_days.end(), julianDay, dayBefore);
+        it = m_days.insert(it, FitnessDay(julianDay));
+    }
+
+    QList<FitnessPlan> adopted = plans;
+    adoptPlans(adopted, julianDay);
+    it->plans = adopted;
+    it->completedCount = countCompleted(adopted);
+    m_planCount += adopted.size();
+}
+
+void FitnessPlanStore::clear()
+{
+    // m_nextId survives: IDs are never handed out twice
+    m_days.clear();
+    m_planCount = 0;
+    m_index.clear();
+    m_snapshot.reset();
+    m_pendingMonths.clear();
+    m_pendingDayCount = 0;
+    m_pendingPlanCount = 0;
+}
+
+void FitnessPlanStore::assign(QVector<FitnessDay> days)
+{
+    clear();
+
+    std::stable_sort(days.begin(), days.end(), [](const FitnessDay &a, const FitnessDay &b) {
+        return a.julianDay < b.julianDay;
+    });
+
+    m_days.clear();
+    m_days.reserve(days.size());
+    m_planCount = 0;
+
+    for (FitnessDay &entry : days) {
+        if (entry.plans.isEmpty()) {
+            continue;
+        }
+        if (!m_days.isEmpty() && m_days.last().julianDay == entry.julianDay) {
+            m_days.last().plans.append(entry.plans);
+        } else {
+            m_days.append(entry);
+        }
+    }
+
+    for (FitnessDay &entry : m_days) {
+        adoptPlans(entry.plans, entry.julianDay);
+        entry.completedCount = countCompleted(entry.plans);
+        m_planCount += entry.plans.size();
+    }
+}
+
+const FitnessPlan *FitnessPlanStore::findPlan(quint64 id, qint64 *julianDay) const
+{
+    int planIndex = 0;
+    const auto it = locate(id, &planIndex);
+    if (it == m_days.end()) {
+        return nullptr;
+    }
+    if (julianDay) {
+        *julianDay = it->julianDay;
+    }
+    return &it->plans.at(planIndex);
+}
+
+bool FitnessPlanStore::updatePlan(quint64 id, const QString &name, const QString &description)
+{
+    int planIndex = 0;
+    const auto it = locate(id, &planIndex);
+    if (it == m_days.end()) {
+        return false;
+    }
+
+    // Everything else, createdAt and completion included, stays
+    FitnessPlan &plan = it->plans[planIndex];
+    plan.name = name;
+    plan.description = description;
+    return true;
+}
+
+bool FitnessPlanStore::setCompletedById(quint64 id, bool completed)
+{
+    int planIndex = 0;
+    const auto it = locate(id, &planIndex);
+    if (it == m_days.end()) {
+        return false;
+    }
+
+    FitnessPlan &plan = it->plans[planIndex];
+    if (plan.completed != completed) {
+        plan.completed = completed;
+        it->completedCount += completed ? 1 : -1;
+    }
+    return true;
+}
+
+bool FitnessPlanStore::movePlan(quint64 id, qint64 julianDay)
+{
+    int planIndex = 0;
+    const auto it = locate(id, &planIndex);
+    if (it == m_days.end()) {
+        return false;
+    }
+    if (it->julianDay == julianDay) {
+        return true;
+    }
+
+    const FitnessPlan plan = it->plans.at(planIndex);
+    removeAt(it, planIndex);
+    addPlan(julianDay, plan);
+    return true;
+}
+
+bool FitnessPlanStore::removePlanById(quint64 id)
+{
+    int planIndex = 0;
+    const auto it = locate(id, &planIndex);
+    if (it == m_days.end()) {
+        return false;
+    }
+
+    removeAt(it, planIndex);
+    return true;
+}
+
+quint64 FitnessPlanStore::nextId() const
+{
+    return m_nextId;
+}
+
+void FitnessPlanStore::attachSnapshot(const QSharedPointer<FitnessSnapshot> &snapshot)
+{
+    clear();
+    if (!snapshot) {
+        return;
+    }
+
+    // Only the index is read here; no plan is decoded
+    const QVector<FitnessSnapshot::Month> months = snapshot->months();
+    m_pendingMonths.reserve(months.size());
+    for (int i = 0; i < months.size(); ++i) {
+        PendingMonth pending = { months[i].key, i, months[i].dayCount, months[i].planCount };
+        m_pendingMonths.append(pending);
+        m_pendingDayCount += pending.dayCount;
+        m_pendingPlanCount += pending.planCount;
+    }
+    std::sort(m_pendingMonths.begin(), m_pendingMonths.end(), [](const PendingMonth &a, const PendingMonth &b) {
+        return a.key < b.key;
+    });
+
+    m_nextId = qMax(m_nextId, snapshot->nextId());
+    m_snapshot = snapshot;
+    if (m_pendingMonths.isEmpty()) {
+        m_snapshot.reset();
+    }
+}
+
+void FitnessPlanStore::materializeAll() const
+{
+    while (!m_pendingMonths.isEmpty()) {
+        materialize(m_pendingMonths.size() - 1);
+    }
+}
+
+int FitnessPlanStore::pendingMonthCount() const
+{
+    return m_pendingMonths.size();
+}
+
+bool FitnessPlanStore::takeSnapshotDamaged()
+{
+    const bool damaged = m_snapshotDamaged;
+    m_snapshotDamaged = false;
+    return damaged;
+}
+
+void FitnessPlanStore::ensureMonths(qint64 firstDay, qint64 lastDay) const
+{
+    if (m_pendingMonths.isEmpty() || firstDay > lastDay) {
+        return;
+    }
+
+    // Bounds past QDate's range (an "everything" query) clamp to the ends
+    auto keyOf = [](qint64 julianDay) {
+        if (!QDate::fromJulianDay(julianDay).isValid()) {
+            return julianDay < 0 ? std::numeric_limits<int>::min() : std::numeric_limits<int>::max();
+        }
+        return FitnessSnapshot::monthKey(julianDay);
+    };
+    const int firstKey = keyOf(firstDay);
+    const int lastKey = keyOf(lastDay);
+    auto keyBefore = [](const PendingMonth &month, int key) { return month.key < key; };
+
+    // Back to front keeps earlier indices valid while entries are removed
+    const int first = int(std::lower_bound(m_pendingMonths.cbegin(), m_pendingMonths.cend(), firstKey, keyBefore)
+                          - m_pendingMonths.cbegin());
+    int last = first;
+    while (last < m_pendingMonths.size() && m_pendingMonths[last].key <= lastKey) {
+        ++last;
+    }
+    for (int i = last - 1; i >= first; --i) {
+        materialize(i);
+    }
+}
+
+void FitnessPlanStore::materialize(int pendingIndex) const
+{
+    const PendingMonth pending = m_pendingMonths.takeAt(pendingIndex);
+    m_pendingDayCount -= pending.dayCount;
+    m_pendingPlanCount -= pending.planCount;
+
+    bool ok = false;
+    QVector<FitnessDay> days = m_snapshot->readMonth(m_snapshot->months().at(pending.index), &ok);
+    if (!ok) {
+        // The month's plans are missing from memory, not from the file
+        m_snapshotDamaged = true;
+    }
+    if (m_pendingMonths.isEmpty()) {
+        m_snapshot.reset(); // Unmaps the file
+    }
+    if (days.isEmpty()) {
+        return;
+    }
+    for (FitnessDay &day : days) {
+        adoptPlans(day.plans, day.julianDay);
+    }
+
+    // A pending month has no materialized days, so the block drops in whole
+    QVector<FitnessDay> merged;
+    merged.reserve(m_days.size() + days.size());
+    const auto position = std::lower_bound(m_days.cbegin(), m_days.cend(), days.first().julianDay, dayBefore);
+    std::copy(m_days.cbegin(), position, std::back_inserter(merged));
+    std::copy(days.cbegin(), days.cend(), std::back_inserter(merged));
+    std::copy(position, m_days.cend(), std::back_inserter(merged));
+    m_days.swap(merged);
+
+    for (const FitnessDay &day : days) {
+        m_planCount += day.plans.size();
+    }
+}
+
+QVector<FitnessDay>::iterator FitnessPlanStore::locate(quint64 id, int *planIndex) const
+{
+    auto entry = m_index.constFind(id);
+    if (entry == m_index.cend() && !m_pendingMonths.isEmpty()) {
+        // An ID handed out earlier is always materialized; this only
+        // happens for IDs from outside, such as a journal or an import
+        materializeAll();
+        entry = m_index.constFind(id);
+    }
+    if (entry == m_index.cend()) {
+        return m_days.end();
+    }
+
+    const auto it = std::lower_bound(m_days.begin(), m_days.end(), entry.value(), dayBefore);
+    if (it == m_days.end() || it->julianDay != entry.value()) {
+        return m_days.end();
+    }
+    for (int i = 0; i < it->plans.size(); ++i) {
+        if (it->plans[i].id == id) {
+            *planIndex = i;
+            return it;
+        }
+    }
+    return m_days.end();
+}
+
+void FitnessPlanStore::removeAt(QVector<FitnessDay>::iterator day, int planIndex)
+{
+    const FitnessPlan &plan = day->plans.at(planIndex);
+    if (plan.completed) {
+        --day->completedCount;
+    }
+    m_index.remove(plan.id);
+    day->plans.removeAt(planIndex);
+    --m_planCount;
+
+    if (day->plans.isEmpty()) {
+        m_days.erase(day);
+    }
+}
+
+void FitnessPlanStore::adoptPlans(QList<FitnessPlan> &plans, qint64 julianDay) const
+{
+    for (FitnessPlan &plan : plans) {
+        // Missing (older files) or already taken IDs get a fresh one
+        if (plan.id == 0 || m_index.contains(plan.id)) {
+            plan.id = m_nextId++;
+        } else {
+            m_nextId = qMax(m_nextId, plan.id + 1);
+        }
+        m_index.insert(plan.id, julianDay);
+    }
+}
+
+QVector<FitnessDay>::iterator FitnessPlanStore::find(qint64 julianDay)
+{
+    const auto it = std::lower_bound(m_days.begin(), m_days.end(), julianDay, dayBefore);
+    if (it == m_days.end() || it->julianDay != julianDay) {
+        return m_days.end();
+    }
+    return it;
+}
+
+int FitnessPlanStore::countCompleted(const QList<FitnessPlan> &plans)
+{
+    int count = 0;
+    for (const FitnessPlan &plan : plans) {
+        if (plan.completed) {
+            ++count;
+        }
+    }
+    return count;
+}
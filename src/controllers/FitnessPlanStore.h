@@ -0,0 +1,139 @@
+#ifndef FITNESSPLANSTORE_H
+#define FITNESSPLANSTORE_H
+
+#include <QDate>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+class FitnessSnapshot;
+
+struct FitnessPlan {
+    quint64 id; // Assigned by FitnessPlanStore; 0 until stored
+    quint64 recurrenceId; // Rule an expanded occurrence comes from; never stored
+    QString name;
+    QString description;
+    bool completed;
+    QDateTime createdAt;
+
+    FitnessPlan() : id(0), recurrenceId(0), completed(false), createdAt(QDateTime::currentDateTime()) {}
+    FitnessPlan(const QString &n, const QString &desc) 
+        : id(0), recurrenceId(0), name(n), description(desc), completed(false), createdAt(QDateTime::currentDateTime()) {}
+};
+
+// All plans of one calendar day, with its counts kept up to date so a
+// calendar cell never has to walk the list
+struct FitnessDay {
+    qint64 julianDay;
+    QList<FitnessPlan> plans;
+    int completedCount;
+
+    FitnessDay() : julianDay(0), completedCount(0) {}
+    explicit FitnessDay(qint64 day) : julianDay(day), completedCount(0) {}
+
+    QDate date() const { return QDate::fromJulianDay(julianDay); }
+    int totalCount() const { return plans.size(); }
+};
+
+// Fitness plans keyed by Julian day number in one sorted, contiguous
+// vector. Lookups are binary searches and any date range (a month, a
+// year, years of history) is a pair of bounds plus a linear walk over
+// the days that actually have plans; nothing formats a date string.
+//
+// A store can sit on top of a binary snapshot: months stay encoded in
+// the mapped file until a lookup, range or edit first touches them.
+// Materializing happens inside const lookups, so a store is used from
+// one thread at a time, and a Range is valid until the next call.
+//
+// Every stored plan has a 64-bit ID, unique in the store and never
+// reused. A hash maps each ID to its day, so edits by ID skip both the
+// date and the name; two plans may share a name on one day.
+class FitnessPlanStore
+{
+public:
+    using const_iterator = QVector<FitnessDay>::const_iterator;
+
+    struct Range {
+        const_iterator first;
+        const_iterator last;
+
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return last; }
+        bool isEmpty() const { return first == last; }
+        int size() const { return int(last - first); }
+    };
+
+    bool isEmpty() const;
+    int dayCount() const;
+    int planCount() const;
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    // Lookup
+    const FitnessDay *day(qint64 julianDay) const;
+    const FitnessDay *day(const QDate &date) const { return day(date.toJulianDay()); }
+    Range range(qint64 firstDay, qint64 lastDay) const; // Inclusive bounds
+    Range range(const QDate &first, const QDate &last) const;
+    Range month(int year, int month) const;
+    Range year(int year) const;
+    int completedCount(qint64 julianDay) const;
+    int totalCount(qint64 julianDay) const;
+
+    // Mutation; empty days are dropped so every stored day has plans.
+    // addPlan keeps plan.id if it is set and free, otherwise assigns one.
+    quint64 addPlan(qint64 julianDay, const FitnessPlan &plan);
+    bool removePlan(qint64 julianDay, const QString &name); // First plan with that name
+    bool setCompleted(qint64 julianDay, const QString &name, bool completed);
+    void setDay(qint64 julianDay, const QList<FitnessPlan> &plans);
+    void clear();
+
+    // By plan ID
+    const FitnessPlan *findPlan(quint64 id, qint64 *julianDay = nullptr) const;
+    bool updatePlan(quint64 id, const QString &name, const QString &description);
+    bool setCompletedById(quint64 id, bool completed);
+    bool movePlan(quint64 id, qint64 julianDay);
+    bool removePlanById(quint64 id);
+    quint64 nextId() const;
+
+    // Bulk load: sorts once and merges days that appear more than once
+    void assign(QVector<FitnessDay> days);
+
+    // Lazy load: replaces the contents with the snapshot's, decoded per month on demand
+    void attachSnapshot(const QSharedPointer<FitnessSnapshot> &snapshot);
+    void materializeAll() const; // Decodes the rest and releases the snapshot file
+    int pendingMonthCount() const;
+    bool takeSnapshotDamaged(); // A month failed to decode since the last call
+
+private:
+    struct PendingMonth {
+        int key;   // year * 12 + month - 1
+        int index; // Into the snapshot's month index
+        int dayCount;
+        int planCount;
+    };
+
+    QVector<FitnessDay>::iterator find(qint64 julianDay);
+    QVector<FitnessDay>::iterator locate(quint64 id, int *planIndex) const;
+    void removeAt(QVector<FitnessDay>::iterator day, int planIndex);
+    void adoptPlans(QList<FitnessPlan> &plans, qint64 julianDay) const;
+    void ensureMonths(qint64 firstDay, qint64 lastDay) const;
+    void materialize(int pendingIndex) const;
+    static int countCompleted(const QList<FitnessPlan> &plans);
+
+    mutable QVector<FitnessDay> m_days; // Sorted by julianDay, no duplicates, no empty days
+    mutable int m_planCount = 0;        // Materialized plans only
+    mutable QHash<quint64, qint64> m_index; // Plan ID -> Julian day, materialized plans only
+    mutable quint64 m_nextId = 1;
+
+    // Months still encoded in the snapshot, sorted by key
+    mutable QSharedPointer<FitnessSnapshot> m_snapshot;
+    mutable QVector<PendingMonth> m_pendingMonths;
+    mutable int m_pendingDayCount = 0;
+    mutable int m_pendingPlanCount = 0;
+    mutable bool m_snapshotDamaged = false; // Survives clear(): the file on disk is still damaged
+};
+
+#endif // FITNESSPLANSTORE_H
@@ -0,0 +1,212 @@
+#include "FitnessRecurrence.h"
+#include <QJsonArray>
+#include <algorithm>
+
+namespace {
+const char *const kFrequencyNames[] = { "daily", "weekly", "monthly" };
+const int kAllWeekdays = 0x7f;
+
+int weekdayBit(const QDate &date)
+{
+    return 1 << (date.dayOfWeek() - 1);
+}
+}
+
+bool FitnessRecurrence::isValid() const
+{
+    return !name.isEmpty()
+        && interval >= 1
+        && QDate::fromJulianDay(startDay).isValid()
+        && (untilDay == 0 || untilDay >= startDay)
+        && count >= 0
+        && (weekdays & ~kAllWeekdays) == 0;
+}
+
+QVector<qint64> FitnessRecurrence::occurrences(qint64 firstDay, qint64 lastDay) const
+{
+    QVector<qint64> days;
+    firstDay = qMax(firstDay, startDay);
+    if (untilDay != 0) {
+        lastDay = qMin(lastDay, untilDay);
+    }
+    if (firstDay > lastDay) {
+        return days;
+    }
+
+    // Only a counted rule needs to know how many came before the range
+    qint64 index = count > 0 ? countBefore(firstDay) : 0;
+    for (qint64 day = firstDay; day <= lastDay; ++day) {
+        if (count > 0 && index >= count) {
+            break;
+        }
+        if (matches(day)) {
+            days.append(day);
+            ++index;
+        }
+    }
+    return days;
+}
+
+bool FitnessRecurrence::occursOn(qint64 julianDay) const
+{
+    return !occurrences(julianDay, julianDay).isEmpty();
+}
+
+QJsonObject FitnessRecurrence::toJson() const
+{
+    QJsonObject json;
+    json["id"] = QString::number(id); // Exceeds a double's exact range
+    json["name"] = name;
+    json["description"] = description;
+    json["createdAt"] = createdAt.toString(Qt::ISODate);
+    json["frequency"] = kFrequencyNames[frequency];
+    json["interval"] = interval;
+    json["start"] = QDate::fromJulianDay(startDay).toString(Qt::ISODate);
+    if (untilDay != 0) {
+        json["until"] = QDate::fromJulianDay(untilDay).toString(Qt::ISODate);
+    }
+    if (count > 0) {
+        json["count"] = count;
+    }
+
+    // Qt's numbering, Monday = 1
+    QJsonArray days;
+    for (int i = 0; i < 7; ++i) {
+        if (weekdays & (1 << i)) {
+            days.append(i + 1);
+        }
+    }
+    json["weekdays"] = days;
+
+    // Sorted, so saving the same rules twice gives the same file
+    QVector<qint64> overrideDays = overrides.keys().toVector();
+    std::sort(overrideDays.begin(), overrideDays.end());
+    QJsonArray exceptions;
+    for (qint64 day : overrideDays) {
+        const Override &entry = overrides[day];
+        QJsonObject exception;
+        exception["date"] = QDate::fromJulianDay(day).toString(Qt::ISODate);
+        exception["skipped"] = entry.skipped;
+        exception["completed"] = entry.completed;
+        exceptions.append(exception);
+    }
+    json["overrides"] = exceptions;
+
+    return json;
+}
+
+FitnessRecurrence FitnessRecurrence::fromJson(const QJsonObject &json)
+{
+    FitnessRecurrence rule;
+    rule.id = json["id"].toString().toULongLong();
+    rule.name = json["name"].toString();
+    rule.description = json["description"].toString();
+    rule.createdAt = QDateTime::fromString(json["createdAt"].toString(), Qt::ISODate);
+    rule.interval = json["interval"].toInt(1);
+    rule.count = json["count"].toInt();
+
+    const QString frequency = json["frequency"].toString();
+    for (int i = 0; i < 3; ++i) {
+        if (frequency == QLatin1String(kFrequencyNames[i])) {
+            rule.frequency = Frequency(i);
+        }
+    }
+
+    const QDate start = QDate::fromString(json["start"].toString(), Qt::ISODate);
+    const QDate until = QDate::fromString(json["until"].toString(), Qt::ISODate);
+    rule.startDay = start.isValid() ? start.toJulianDay() : 0;
+    rule.untilDay = until.isValid() ? until.toJulianDay() : 0;
+
+    for (const auto &value : json["weekdays"].toArray()) {
+        const int day = value.toInt();
+        if (day >= 1 && day <= 7) {
+            rule.weekdays |= 1 << (day - 1);
+        }
+    }
+
+    for (const auto &value : json["overrides"].toArray()) {
+        const QJsonObject exception = value.toObject();
+        const QDate date = QDate::fromString(exception["date"].toString(), Qt::ISODate);
+        if (date.isValid()) {
+            Override entry;
+            entry.skipped = exception["skipped"].toBool();
+            entry.completed = exception["completed"].toBool();
+            rule.overrides.insert(date.toJulianDay(), entry);
+        }
+    }
+
+    return rule;
+}
+
+bool FitnessRecurrence::matches(qint64 julianDay) const
+{
+    if (julianDay < startDay) {
+        return false;
+    }
+
+    const QDate date = QDate::fromJulianDay(julianDay);
+    const QDate start = QDate::fromJulianDay(startDay);
+    switch (frequency) {
+    case Daily:
+        return (julianDay - startDay) % interval == 0
+            && ((weekdays ? weekdays : kAllWeekdays) & weekdayBit(date));
+    case Weekly: {
+        const qint64 firstMonday = startDay - (start.dayOfWeek() - 1);
+        return ((julianDay - firstMonday) / 7) % interval == 0
+            && ((weekdays ? weekdays : weekdayBit(start)) & weekdayBit(date));
+    }
+    case Monthly: {
+        const int months = (date.year() - start.year()) * 12 + date.month() - start.month();
+        if (months % interval != 0) {
+            return false;
+        }
+        return weekdays ? (weekdays & weekdayBit(date)) != 0 : date.day() == start.day();
+    }
+    }
+    return false;
+}
+
+int FitnessRecurrence::countIn(qint64 firstDay, qint64 endDay) const
+{
+    int matched = 0;
+    for (qint64 day = firstDay; day < endDay; ++day) {
+        if (matches(day)) {
+            ++matched;
+        }
+    }
+    return matched;
+}
+
+qint64 FitnessRecurrence::countBefore(qint64 julianDay) const
+{
+    if (julianDay <= startDay) {
+        return 0;
+    }
+
+    const QDate start = QDate::fromJulianDay(startDay);
+    if (frequency == Monthly) {
+        // Months are uneven; walk only the ones the rule lands in
+        const QDate end = QDate::fromJulianDay(julianDay);
+        qint64 matched = 0;
+        for (QDate month(start.year(), start.month(), 1); month <= end; month = month.addMonths(interval)) {
+            matched += countIn(qMax(startDay, month.toJulianDay()),
+                               qMin(julianDay, month.addMonths(1).toJulianDay()));
+        }
+        return matched;
+    }
+
+    // Daily and weekly patterns repeat every interval weeks: count one
+    // period and multiply instead of walking the whole history
+    const qint64 period = 7 * qint64(interval);
+    const qint64 firstPeriod = frequency == Daily ? startDay : startDay - (start.dayOfWeek() - 1);
+    const qint64 secondPeriod = firstPeriod + period;
+    if (julianDay <= secondPeriod) {
+        return countIn(startDay, julianDay);
+    }
+
+    const qint64 periods = (julianDay - secondPeriod) / period;
+    const qint64 tail = secondPeriod + periods * period;
+    return countIn(startDay, secondPeriod)
+        + periods * countIn(secondPeriod, secondPeriod + period)
+        + countIn(tail, julianDay);
+}
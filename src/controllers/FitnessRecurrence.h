@@ -0,0 +1,64 @@
+#ifndef FITNESSRECURRENCE_H
+#define FITNESSRECURRENCE_H
+
+#include <QDate>
+#include <QDateTime>
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+// A repeating fitness plan, stored once as a rule and expanded into
+// dated occurrences only for the range a view asks about. Only the
+// occurrences that differ from the rule (completed or skipped) are kept,
+// so memory grows with rules and exceptions, never with the calendar
+// span they cover.
+//
+// The pattern follows the iCalendar subset people actually use: every
+// interval days, weeks (Monday first) or months from the start day,
+// optionally limited to some weekdays, ending after count occurrences
+// and/or on an until day. Without weekdays, a weekly rule repeats on the
+// start's weekday and a monthly rule on the start's day of the month,
+// skipping months that lack it.
+struct FitnessRecurrence {
+    enum Frequency {
+        Daily,
+        Weekly,
+        Monthly
+    };
+
+    struct Override {
+        bool skipped = false;
+        bool completed = false;
+    };
+
+    quint64 id = 0; // Assigned by FitnessManager
+    QString name;
+    QString description;
+    QDateTime createdAt;
+    Frequency frequency = Weekly;
+    int interval = 1;
+    int weekdays = 0;   // Bit 0 is Monday .. bit 6 Sunday
+    qint64 startDay = 0;
+    qint64 untilDay = 0; // Inclusive; 0 for none
+    int count = 0;       // 0 for unlimited
+    QHash<qint64, Override> overrides; // Julian day -> exception
+
+    bool isValid() const;
+    bool isOpenEnded() const { return untilDay == 0 && count == 0; }
+
+    // Occurrence days in [firstDay, lastDay], oldest first; skipped
+    // ones included, overrides are the caller's to apply
+    QVector<qint64> occurrences(qint64 firstDay, qint64 lastDay) const;
+    bool occursOn(qint64 julianDay) const;
+
+    QJsonObject toJson() const;
+    static FitnessRecurrence fromJson(const QJsonObject &json);
+
+private:
+    bool matches(qint64 julianDay) const; // Pattern only: no count or until
+    int countIn(qint64 firstDay, qint64 endDay) const; // Matches in [firstDay, endDay)
+    qint64 countBefore(qint64 julianDay) const;
+};
+
+#endif // FITNESSRECURRENCE_H
@@ -0,0 +1,245 @@
+#include "FitnessReminder.h"
+#include "Scheduler.h"
+#include <QDebug>
+
+FitnessReminder::FitnessReminder(QObject *parent)
+    : QObject(parent)
+    , m_enabled(false)
+    , m_due(false)
+    , m_suspended(false)
+    , m_dailyGoal(3)
+    , m_reminderTime(20, 0)
+    , m_dailyJob(0)
+    , m_snoozeJob(0)
+{
+    // reminderTime is local: recompute the day's deadline after a clock or zone change
+    connect(Scheduler::instance(), &Scheduler::clockChanged, this, [this]() {
+        if (m_dailyJob) {
+            scheduleDaily();
+        }
+    });
+}
+
+FitnessReminder::~FitnessReminder()
+{
+    Scheduler::instance()->cancel(m_dailyJob);
+    Scheduler::instance()->cancel(m_snoozeJob);
+}
+
+FitnessManager *FitnessReminder::manager() const
+{
+    return m_manager;
+}
+
+void FitnessReminder::setManager(FitnessManager *manager)
+{
+    if (m_manager != manager) {
+        m_manager = manager;
+        emit managerChanged();
+    }
+}
+
+bool FitnessReminder::isEnabled() const
+{
+    return m_enabled;
+}
+
+void FitnessReminder::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) {
+        return;
+    }
+
+    m_enabled = enabled;
+    emit enabledChanged();
+
+    if (enabled) {
+        scheduleDaily();
+    } else {
+        Scheduler::instance()->cancel(m_dailyJob);
+        Scheduler::instance()->cancel(m_snoozeJob);
+        m_dailyJob = 0;
+        m_snoozeJob = 0;
+        m_nextDaily = QDateTime();
+        m_snoozeUntil = QDateTime();
+        emit nextReminderChanged();
+        setDue(false);
+    }
+}
+
+int FitnessReminder::dailyGoal() const
+{
+    return m_dailyGoal;
+}
+
+void FitnessReminder::setDailyGoal(int goal)
+{
+    goal = qMax(1, goal);
+    if (m_dailyGoal != goal) {
+        m_dailyGoal = goal;
+        emit dailyGoalChanged();
+    }
+}
+
+QTime FitnessReminder::reminderTime() const
+{
+    return m_reminderTime;
+}
+
+void FitnessReminder::setReminderTime(const QTime &time)
+{
+    if (!time.isValid() || m_reminderTime == time) {
+        return;
+    }
+
+    m_reminderTime = time;
+    emit reminderTimeChanged();
+    if (m_enabled) {
+        scheduleDaily();
+    }
+}
+
+QDateTime FitnessReminder::nextReminder() const
+{
+    return m_snoozeUntil.isValid() ? m_snoozeUntil : m_nextDaily;
+}
+
+bool FitnessReminder::isSnoozed() const
+{
+    return m_snoozeUntil.isValid();
+}
+
+bool FitnessReminder::isDue() const
+{
+    return m_due;
+}
+
+bool FitnessReminder::isSuspended() const
+{
+    return m_suspended;
+}
+
+void FitnessReminder::setSuspended(bool suspended)
+{
+    if (m_suspended == suspended) {
+        return;
+    }
+
+    m_suspended = suspended;
+    emit suspendedChanged();
+
+    // Hidden: no job stays armed, so nothing wakes the process
+    if (suspended) {
+        Scheduler::instance()->cancel(m_dailyJob);
+        Scheduler::instance()->cancel(m_snoozeJob);
+        m_dailyJob = 0;
+        m_snoozeJob = 0;
+        return;
+    }
+
+    if (!m_enabled) {
+        return;
+    }
+
+    // One catch-up check for whatever came due while hidden
+    const QDateTime now = QDateTime::currentDateTime();
+    const bool missed = (m_nextDaily.isValid() && m_nextDaily <= now)
+                        || (m_snoozeUntil.isValid() && m_snoozeUntil <= now);
+    if (m_snoozeUntil.isValid() && m_snoozeUntil > now) {
+        armSnooze();
+    } else {
+        m_snoozeUntil = QDateTime();
+    }
+    scheduleDaily();
+    if (missed) {
+        checkGoal();
+    }
+}
+
+void FitnessReminder::snooze(int minutes)
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    m_snoozeUntil = QDateTime::currentDateTime().addSecs(qMax(1, minutes) * 60);
+    armSnooze();
+    emit nextReminderChanged();
+    setDue(false);
+    qDebug() << "Fitness reminder snoozed until:" << m_snoozeUntil.toString();
+}
+
+void FitnessReminder::dismiss()
+{
+    setDue(false);
+    Scheduler::instance()->cancel(m_snoozeJob);
+    m_snoozeJob = 0;
+    if (m_snoozeUntil.isValid()) {
+        m_snoozeUntil = QDateTime();
+        emit nextReminderChanged();
+    }
+}
+
+void FitnessReminder::armSnooze()
+{
+    // While suspended the time is only remembered; resume arms it
+    if (m_suspended) {
+        return;
+    }
+
+    Scheduler *scheduler = Scheduler::instance();
+    if (!scheduler->reschedule(m_snoozeJob, m_snoozeUntil)) {
+        m_snoozeJob = scheduler->schedule(m_snoozeUntil, this, [this]() {
+            m_snoozeJob = 0;
+            m_snoozeUntil = QDateTime();
+            emit nextReminderChanged();
+            checkGoal();
+        }, "fitnessReminder.snooze");
+    }
+}
+
+void FitnessReminder::scheduleDaily()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    QDateTime next(now.date(), m_reminderTime);
+    if (next <= now) {
+        next = QDateTime(now.date().addDays(1), m_reminderTime);
+    }
+    m_nextDaily = next;
+    if (m_suspended) {
+        emit nextReminderChanged();
+        return;
+    }
+
+    Scheduler *scheduler = Scheduler::instance();
+    if (!scheduler->reschedule(m_dailyJob, next)) {
+        m_dailyJob = scheduler->schedule(next, this, [this]() {
+            m_dailyJob = 0;
+            checkGoal();
+            scheduleDaily();
+        }, "fitnessReminder.daily");
+    }
+    emit nextReminderChanged();
+}
+
+void FitnessReminder::checkGoal()
+{
+    if (!m_enabled || !m_manager) {
+        return;
+    }
+
+    const int completed = m_manager->getCompletedCount(QDate::currentDate());
+    setDue(completed < m_dailyGoal);
+    if (m_due) {
+        qDebug() << "Fitness reminder:" << completed << "of" << m_dailyGoal << "plans completed today";
+        emit reminderDue(completed, m_dailyGoal);
+    }
+}
+
+void FitnessReminder::setDue(bool due)
+{
+    if (m_due != due) {
+        m_due = due;
+        emit dueChanged();
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef FITNESSREMINDER_H
+#define FITNESSREMINDER_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QPointer>
+#include <QTime>
+#include "FitnessManager.h"
+
+// Daily nudge toward the fitness goal (config fitness.reminderEnabled and
+// fitness.dailyGoal). One Scheduler job waits for reminderTime; when it
+// fires and fewer than dailyGoal of today's plans are completed,
+// reminderDue is emitted and the next day's job is scheduled. The
+// reminder stays due (the context menu offers 稍后提醒) until snooze()
+// adds a one-off job that checks again, or dismiss() drops it. Nothing
+// polls in between, and while suspended (sprite hidden) no job is armed
+// at all; a reminder whose time passed meanwhile is checked on resume.
+class FitnessReminder : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(FitnessManager *manager READ manager WRITE setManager NOTIFY managerChanged)
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(int dailyGoal READ dailyGoal WRITE setDailyGoal NOTIFY dailyGoalChanged)
+    Q_PROPERTY(QTime reminderTime READ reminderTime WRITE setReminderTime NOTIFY reminderTimeChanged)
+    Q_PROPERTY(QDateTime nextReminder READ nextReminder NOTIFY nextReminderChanged)
+    Q_PROPERTY(bool snoozed READ isSnoozed NOTIFY nextReminderChanged)
+    Q_PROPERTY(bool due READ isDue NOTIFY dueChanged)
+    Q_PROPERTY(bool suspended READ isSuspended WRITE setSuspended NOTIFY suspendedChanged)
+
+public:
+    explicit FitnessReminder(QObject *parent = nullptr);
+    ~FitnessReminder();
+
+    FitnessManager *manager() const;
+    void setManager(FitnessManager *manager);
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    int dailyGoal() const;
+    void setDailyGoal(int goal);
+
+    QTime reminderTime() const; // Local time, 20:00 by default
+    void setReminderTime(const QTime &time);
+
+    QDateTime nextReminder() const; // The snooze if one is pending
+    bool isSnoozed() const;
+    bool isDue() const; // Fired and not yet snoozed or dismissed
+
+    bool isSuspended() const;
+    void setSuspended(bool suspended);
+
+    Q_INVOKABLE void snooze(int minutes = 10);
+    Q_INVOKABLE void dismiss(); // Drops the due reminder and a pending snooze
+
+signals:
+    void managerChanged();
+    void enabledChanged();
+    void dailyGoalChanged();
+    void reminderTimeChanged();
+    void nextReminderChanged();
+    void dueChanged();
+    void suspendedChanged();
+    void reminderDue(int completed, int goal);
+
+private:
+    void scheduleDaily();
+    void armSnooze();
+    void checkGoal();
+    void setDue(bool due);
+
+    QPointer<FitnessManager> m_manager;
+    bool m_enabled;
+    bool m_due;
+    bool m_suspended;
+    int m_dailyGoal;
+    QTime m_reminderTime;
+    QDateTime m_nextDaily;
+    QDateTime m_snoozeUntil;
+    quint64 m_dailyJob;  // Scheduler job IDs, 0 when not scheduled
+    quint64 m_snoozeJob;
+};
+
+#endif // FITNESSREMINDER_H
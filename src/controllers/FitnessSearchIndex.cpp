@@ -0,0 +1,204 @@
+#include "FitnessSearchIndex.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+bool isCjk(uint c)
+{
+    return (c >= 0x3040 && c <= 0x30ff)     // Hiragana, Katakana
+        || (c >= 0x3400 && c <= 0x4dbf)     // CJK extension A
+        || (c >= 0x4e00 && c <= 0x9fff)     // CJK unified ideographs
+        || (c >= 0xac00 && c <= 0xd7af)     // Hangul syllables
+        || (c >= 0xf900 && c <= 0xfaff)     // Compatibility ideographs
+        || (c >= 0x20000 && c <= 0x2fa1f);  // Extensions B and later
+}
+
+void flushWord(QVector<uint> &word, QStringList &tokens)
+{
+    if (!word.isEmpty()) {
+        tokens.append(QString::fromUcs4(word.constData(), word.size()));
+        word.clear();
+    }
+}
+
+void flushCjk(QVector<uint> &run, QStringList &tokens)
+{
+    for (int i = 0; i + 1 < run.size(); ++i) {
+        tokens.append(QString::fromUcs4(run.constData() + i, 2));
+    }
+    if (!run.isEmpty()) {
+        tokens.append(QString::fromUcs4(run.constData() + run.size() - 1, 1));
+    }
+    run.clear();
+}
+
+void insertSorted(QVector<quint64> &ids, quint64 id)
+{
+    const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+    if (it == ids.end() || *it != id) {
+        ids.insert(it, id);
+    }
+}
+}
+
+QStringList FitnessSearchIndex::tokenize(const QString &text)
+{
+    QStringList tokens;
+    QVector<uint> word;
+    QVector<uint> run;
+
+    for (uint c : text.toCaseFolded().toUcs4()) {
+        if (isCjk(c)) {
+            flushWord(word, tokens);
+            run.append(c);
+        } else if (QChar::isLetterOrNumber(c)) {
+            flushCjk(run, tokens);
+            word.append(c);
+        } else {
+            flushWord(word, tokens);
+            flushCjk(run, tokens);
+        }
+    }
+    flushWord(word, tokens);
+    flushCjk(run, tokens);
+
+    tokens.removeDuplicates();
+    return tokens;
+}
+
+void FitnessSearchIndex::clear()
+{
+    m_built = false;
+    m_postings.clear();
+    m_plans.clear();
+}
+
+void FitnessSearchIndex::insert(quint64 id, qint64 julianDay, const QString &name, const QString &description)
+{
+    if (!m_built) {
+        return;
+    }
+
+    auto existing = m_plans.find(id);
+    if (existing != m_plans.end()) {
+        unlink(id, *existing);
+        m_plans.erase(existing);
+    }
+
+    QStringList tokens = tokenize(name);
+    tokens += tokenize(description);
+    tokens.removeDuplicates();
+
+    Entry entry;
+    entry.julianDay = julianDay;
+    entry.terms.reserve(tokens.size());
+    for (const QString &token : tokens) {
+        auto posting = m_postings.emplace(token, QVector<quint64>()).first;
+        insertSorted(posting->second, id);
+        entry.terms.append(posting->first);
+    }
+    m_plans.insert(id, entry);
+}
+
+void FitnessSearchIndex::move(quint64 id, qint64 julianDay)
+{
+    auto it = m_plans.find(id);
+    if (it != m_plans.end()) {
+        it->julianDay = julianDay;
+    }
+}
+
+void FitnessSearchIndex::remove(quint64 id)
+{
+    auto it = m_plans.find(id);
+    if (it != m_plans.end()) {
+        unlink(id, *it);
+        m_plans.erase(it);
+    }
+}
+
+QVector<FitnessSearchIndex::Hit> FitnessSearchIndex::search(const QString &query, int limit) const
+{
+    QVector<Hit> hits;
+    const QStringList tokens = tokenize(query);
+    if (tokens.isEmpty() || limit <= 0) {
+        return hits;
+    }
+
+    QVector<QVector<quint64>> lists;
+    lists.reserve(tokens.size());
+    for (const QString &token : tokens) {
+        lists.append(matchPrefix(token));
+        if (lists.last().isEmpty()) {
+            return hits;
+        }
+    }
+
+    // Smallest list first keeps every intersection at most that size
+    std::sort(lists.begin(), lists.end(), [](const QVector<quint64> &a, const QVector<quint64> &b) {
+        return a.size() < b.size();
+    });
+    QVector<quint64> ids = lists.first();
+    for (int i = 1; i < lists.size() && !ids.isEmpty(); ++i) {
+        QVector<quint64> common;
+        std::set_intersection(ids.cbegin(), ids.cend(), lists[i].cbegin(), lists[i].cend(),
+                              std::back_inserter(common));
+        ids.swap(common);
+    }
+
+    hits.reserve(ids.size());
+    for (quint64 id : ids) {
+        hits.append(Hit{ id, m_plans.value(id).julianDay });
+    }
+
+    const auto newerFirst = [](const Hit &a, const Hit &b) {
+        return a.julianDay != b.julianDay ? a.julianDay > b.julianDay : a.id > b.id;
+    };
+    if (hits.size() > limit) {
+        std::partial_sort(hits.begin(), hits.begin() + limit, hits.end(), newerFirst);
+        hits.resize(limit);
+    } else {
+        std::sort(hits.begin(), hits.end(), newerFirst);
+    }
+    return hits;
+}
+
+void FitnessSearchIndex::unlink(quint64 id, const Entry &entry)
+{
+    for (const QString &term : entry.terms) {
+        auto posting = m_postings.find(term);
+        if (posting == m_postings.end()) {
+            continue;
+        }
+        QVector<quint64> &ids = posting->second;
+        const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if (it != ids.end() && *it == id) {
+            ids.erase(it);
+        }
+        if (ids.isEmpty()) {
+            m_postings.erase(posting);
+        }
+    }
+}
+
+QVector<quint64> FitnessSearchIndex::matchPrefix(const QString &prefix) const
+{
+    auto it = m_postings.lower_bound(prefix);
+    if (it == m_postings.end() || !it->first.startsWith(prefix)) {
+        return QVector<quint64>();
+    }
+
+    // A whole word query usually hits one term; no merge needed then
+    auto next = std::next(it);
+    if (next == m_postings.end() || !next->first.startsWith(prefix)) {
+        return it->second;
+    }
+
+    QVector<quint64> ids;
+    for (; it != m_postings.end() && it->first.startsWith(prefix); ++it) {
+        ids += it->second;
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
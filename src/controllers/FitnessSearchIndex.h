@@ -0,0 +1,61 @@
+#ifndef FITNESSSEARCHINDEX_H
+#define FITNESSSEARCHINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <map>
+
+// Inverted index over plan names and descriptions. Latin text splits
+// into case-folded words; Chinese, Japanese and Korean runs, which have
+// no spaces, split into overlapping character bigrams plus the run's
+// last character, so any one- or two-character query still lands on a
+// term. Terms sit in an ordered map, so a query token matches every
+// term it is a prefix of ("dead" finds "deadlift") with one lower_bound.
+//
+// Each term's posting list is a sorted vector of plan IDs, and each plan
+// remembers its terms and day, so add, rename, move and remove touch
+// only that plan's entries. Multi-token queries intersect the lists,
+// smallest first.
+//
+// Edits before build() are ignored: the manager builds from the full
+// store on the first search and keeps the index current from then on.
+class FitnessSearchIndex
+{
+public:
+    struct Hit {
+        quint64 id;
+        qint64 julianDay;
+    };
+
+    static QStringList tokenize(const QString &text);
+
+    bool isBuilt() const { return m_built; }
+    void markBuilt() { m_built = true; }
+    void clear(); // Empty and unbuilt
+    int planCount() const { return m_plans.size(); }
+
+    // Inserting an indexed ID replaces its entries, so it also renames
+    void insert(quint64 id, qint64 julianDay, const QString &name, const QString &description);
+    void move(quint64 id, qint64 julianDay);
+    void remove(quint64 id);
+
+    // Plans matching every query token, newest day first, at most limit
+    QVector<Hit> search(const QString &query, int limit) const;
+
+private:
+    struct Entry {
+        qint64 julianDay;
+        QVector<QString> terms; // Shares the map's key strings
+    };
+
+    void unlink(quint64 id, const Entry &entry);
+    QVector<quint64> matchPrefix(const QString &prefix) const;
+
+    bool m_built = false;
+    std::map<QString, QVector<quint64>> m_postings; // Term -> sorted plan IDs
+    QHash<quint64, Entry> m_plans;
+};
+
+#endif // FITNESSSEARCHINDEX_H
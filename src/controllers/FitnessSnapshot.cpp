@@ -0,0 +1,292 @@
+#include "FitnessSnapshot.h"
+#include <QSaveFile>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+const char kMagic[4] = { 'E', 'L', 'F', 'P' };
+const quint16 kVersion = 2;
+const int kHeaderSizeV1 = 20;    // magic + version + reserved + sequence + month count
+const int kHeaderSize = 28;      // ... + next plan ID before the month count
+const int kMonthRecordSize = 24; // key, day count, plan count, offset, length
+const int kDayHeaderSize = 12;   // Julian day, plan count
+const int kMinPlanSizeV1 = 17;   // completed, createdAt, two empty strings
+const int kMinPlanSize = 25;     // ... + plan ID
+
+void appendString(QByteArray &out, const QString &value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    uchar length[4];
+    qToLittleEndian<quint32>(quint32(utf8.size()), length);
+    out.append(reinterpret_cast<const char *>(length), 4);
+    out.append(utf8);
+}
+
+template <typename T>
+void appendValue(QByteArray &out, T value)
+{
+    uchar bytes[sizeof(T)];
+    qToLittleEndian<T>(value, bytes);
+    out.append(reinterpret_cast<const char *>(bytes), sizeof(T));
+}
+
+// Bounds-checked reader over one month block
+class BlockReader
+{
+public:
+    BlockReader(const uchar *data, qint64 size) : m_data(data), m_size(size), m_offset(0), m_ok(true) {}
+
+    bool ok() const { return m_ok; }
+
+    template <typename T>
+    T read()
+    {
+        if (!m_ok || m_offset + qint64(sizeof(T)) > m_size) {
+            m_ok = false;
+            return T();
+        }
+        const T value = qFromLittleEndian<T>(m_data + m_offset);
+        m_offset += sizeof(T);
+        return value;
+    }
+
+    QString readString()
+    {
+        const quint32 length = read<quint32>();
+        if (!m_ok || m_offset + qint64(length) > m_size) {
+            m_ok = false;
+            return QString();
+        }
+        const QString value = QString::fromUtf8(reinterpret_cast<const char *>(m_data + m_offset), int(length));
+        m_offset += length;
+        return value;
+    }
+
+private:
+    const uchar *m_data;
+    qint64 m_size;
+    qint64 m_offset;
+    bool m_ok;
+};
+}
+
+FitnessSnapshot::FitnessSnapshot()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_version(0)
+    , m_journalSequence(0)
+    , m_nextId(1)
+{
+}
+
+FitnessSnapshot::~FitnessSnapshot()
+{
+    if (m_data && m_buffer.isEmpty()) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+    }
+}
+
+bool FitnessSnapshot::open(const QString &path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        m_buffer = m_file.readAll();
+        m_data = reinterpret_cast<const uchar *>(m_buffer.constData());
+        m_size = m_buffer.size();
+    }
+
+    return parse();
+}
+
+bool FitnessSnapshot::parse()
+{
+    if (m_size < kHeaderSizeV1 || memcmp(m_data, kMagic, sizeof(kMagic)) != 0) {
+        m_errorString = QStringLiteral("Not a fitness snapshot");
+        return false;
+    }
+
+    // Version 1 has no plan IDs; the store assigns them while loading
+    m_version = qFromLittleEndian<quint16>(m_data + 4);
+    const int headerSize = m_version == 1 ? kHeaderSizeV1 : kHeaderSize;
+    if ((m_version != 1 && m_version != kVersion) || m_size < headerSize) {
+        m_errorString = QStringLiteral("Unsupported fitness snapshot version %1").arg(m_version);
+        return false;
+    }
+
+    m_journalSequence = qFromLittleEndian<quint64>(m_data + 8);
+    m_nextId = m_version == 1 ? 1 : qMax<quint64>(1, qFromLittleEndian<quint64>(m_data + 16));
+    const quint32 monthCount = qFromLittleEndian<quint32>(m_data + headerSize - 4);
+    if (headerSize + qint64(monthCount) * kMonthRecordSize > m_size) {
+        m_errorString = QStringLiteral("Truncated fitness snapshot index");
+        return false;
+    }
+
+    m_months.clear();
+    m_months.reserve(int(monthCount));
+    const int minPlanSize = m_version == 1 ? kMinPlanSizeV1 : kMinPlanSize;
+    const uchar *record = m_data + headerSize;
+    for (quint32 i = 0; i < monthCount; ++i, record += kMonthRecordSize) {
+        const quint32 dayCount = qFromLittleEndian<quint32>(record + 4);
+        const quint32 planCount = qFromLittleEndian<quint32>(record + 8);
+        Month month;
+        month.key = qFromLittleEndian<qint32>(record);
+        month.offset = qint64(qFromLittleEndian<quint64>(record + 12));
+        month.length = qFromLittleEndian<quint32>(record + 20);
+        if (month.offset < 0 || month.offset + month.length > m_size) {
+            m_errorString = QStringLiteral("Truncated fitness snapshot month block");
+            m_months.clear();
+            return false;
+        }
+
+        // Counts the block cannot hold would have readMonth reserve garbage
+        if (qint64(dayCount) * kDayHeaderSize + qint64(planCount) * minPlanSize > month.length) {
+            m_errorString = QStringLiteral("Fitness snapshot month %1 claims more than its block holds").arg(month.key);
+            m_months.clear();
+            return false;
+        }
+        month.dayCount = int(dayCount);
+        month.planCount = int(planCount);
+        m_months.append(month);
+    }
+
+    return true;
+}
+
+int FitnessSnapshot::version() const
+{
+    return m_version;
+}
+
+quint64 FitnessSnapshot::journalSequence() const
+{
+    return m_journalSequence;
+}
+
+quint64 FitnessSnapshot::nextId() const
+{
+    return m_nextId;
+}
+
+QVector<FitnessSnapshot::Month> FitnessSnapshot::months() const
+{
+    return m_months;
+}
+
+QVector<FitnessDay> FitnessSnapshot::readMonth(const Month &month, bool *ok) const
+{
+    QVector<FitnessDay> days;
+    if (ok) {
+        *ok = false;
+    }
+    if (month.dayCount < 0 || qint64(month.dayCount) * kDayHeaderSize > month.length) {
+        qWarning() << "Corrupt fitness snapshot month" << month.key << "in" << m_file.fileName();
+        return days;
+    }
+    days.reserve(month.dayCount);
+
+    BlockReader reader(m_data + month.offset, month.length);
+    for (int d = 0; d < month.dayCount && reader.ok(); ++d) {
+        FitnessDay day(reader.read<qint64>());
+        const quint32 planCount = reader.read<quint32>();
+        for (quint32 p = 0; p < planCount && reader.ok(); ++p) {
+            FitnessPlan plan;
+            if (m_version >= 2) {
+                plan.id = reader.read<quint64>();
+            }
+            plan.completed = reader.read<quint8>() != 0;
+            plan.createdAt = QDateTime::fromMSecsSinceEpoch(reader.read<qint64>());
+            plan.name = reader.readString();
+            plan.description = reader.readString();
+            if (plan.completed) {
+                ++day.completedCount;
+            }
+            day.plans.append(plan);
+        }
+        days.append(day);
+    }
+
+    if (!reader.ok()) {
+        qWarning() << "Corrupt fitness snapshot month" << month.key << "in" << m_file.fileName();
+        return QVector<FitnessDay>();
+    }
+    if (ok) {
+        *ok = true;
+    }
+    return days;
+}
+
+QString FitnessSnapshot::errorString() const
+{
+    return m_errorString;
+}
+
+bool FitnessSnapshot::write(const QString &path, const FitnessPlanStore &store, quint64 journalSequence)
+{
+    // Month blocks first, so the index can record their offsets
+    QVector<Month> months;
+    QByteArray blocks;
+    for (const FitnessDay &day : store) {
+        const int key = monthKey(day.julianDay);
+        if (months.isEmpty() || months.last().key != key) {
+            Month month = { key, 0, 0, blocks.size(), 0 };
+            months.append(month);
+        }
+
+        Month &month = months.last();
+        ++month.dayCount;
+        month.planCount += day.plans.size();
+
+        appendValue<qint64>(blocks, day.julianDay);
+        appendValue<quint32>(blocks, quint32(day.plans.size()));
+        for (const FitnessPlan &plan : day.plans) {
+            appendValue<quint64>(blocks, plan.id);
+            appendValue<quint8>(blocks, plan.completed ? 1 : 0);
+            appendValue<qint64>(blocks, plan.createdAt.toMSecsSinceEpoch());
+            appendString(blocks, plan.name);
+            appendString(blocks, plan.description);
+        }
+        month.length = blocks.size() - month.offset;
+    }
+
+    const qint64 blocksStart = kHeaderSize + qint64(months.size()) * kMonthRecordSize;
+
+    QByteArray header;
+    header.append(kMagic, sizeof(kMagic));
+    appendValue<quint16>(header, kVersion);
+    appendValue<quint16>(header, 0);
+    appendValue<quint64>(header, journalSequence);
+    appendValue<quint64>(header, store.nextId());
+    appendValue<quint32>(header, quint32(months.size()));
+    for (const Month &month : months) {
+        appendValue<qint32>(header, month.key);
+        appendValue<quint32>(header, quint32(month.dayCount));
+        appendValue<quint32>(header, quint32(month.planCount));
+        appendValue<quint64>(header, quint64(blocksStart + month.offset));
+        appendValue<quint32>(header, quint32(month.length));
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write fitness snapshot:" << path << file.errorString();
+        return false;
+    }
+    file.write(header);
+    file.write(blocks);
+    return file.commit();
+}
+
+int FitnessSnapshot::monthKey(qint64 julianDay)
+{
+    int year = 0;
+    int month = 0;
+    QDate::fromJulianDay(julianDay).getDate(&year, &month, nullptr);
+    return year * 12 + month - 1;
+}
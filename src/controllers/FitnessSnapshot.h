@@ -0,0 +1,70 @@
+#ifndef FITNESSSNAPSHOT_H
+#define FITNESSSNAPSHOT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "FitnessPlanStore.h"
+
+// Binary snapshot of the fitness store (fitness_data.bin), read through
+// a memory map. Opening parses only the header and the month index; a
+// month's plans are decoded when that month is first needed, so load
+// time does not grow with history.
+//
+// Layout, all integers little-endian:
+//   char[4]  magic "ELFP"
+//   quint16  version (2; 1 is still read)
+//   quint16  reserved
+//   quint64  journal sequence included in the snapshot
+//   quint64  next plan ID (absent in version 1)
+//   quint32  month count
+//   month count x { qint32 month key (year * 12 + month - 1);
+//                   quint32 day count; quint32 plan count;
+//                   quint64 block offset; quint32 block length }
+//   month blocks, each day count x
+//     { qint64 Julian day; quint32 plan count;
+//       plan count x { quint64 id (absent in version 1);
+//                      quint8 completed; qint64 createdAt (ms since epoch);
+//                      quint32 length + UTF-8 name;
+//                      quint32 length + UTF-8 description } }
+class FitnessSnapshot
+{
+public:
+    struct Month {
+        int key;
+        int dayCount;
+        int planCount;
+        qint64 offset;
+        qint64 length;
+    };
+
+    FitnessSnapshot();
+    ~FitnessSnapshot();
+
+    bool open(const QString &path);
+    int version() const;
+    quint64 journalSequence() const;
+    quint64 nextId() const; // Above every plan ID in the file
+    QVector<Month> months() const;
+    QVector<FitnessDay> readMonth(const Month &month, bool *ok = nullptr) const; // Empty and !*ok if corrupt
+    QString errorString() const;
+
+    static bool write(const QString &path, const FitnessPlanStore &store, quint64 journalSequence);
+    static int monthKey(qint64 julianDay);
+
+private:
+    bool parse();
+
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    QByteArray m_buffer; // Fallback when the file cannot be mapped
+    int m_version;
+    quint64 m_journalSequence;
+    quint64 m_nextId;
+    QVector<Month> m_months;
+    QString m_errorString;
+};
+
+#endif // FITNESSSNAPSHOT_H
@@ -0,0 +1,372 @@
+#include "FitnessSqlStore.h"
+#include <QSqlError>
+#include <QVariant>
+#include <QDebug>
+
+namespace {
+const int kSchemaVersion = 2;
+const char kMigratedKey[] = "migratedFromJson";
+const char kPlansColumns[] =
+    "(id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    " day INTEGER NOT NULL,"
+    " name TEXT NOT NULL,"
+    " description TEXT NOT NULL DEFAULT '',"
+    " completed INTEGER NOT NULL DEFAULT 0,"
+    " created_at INTEGER NOT NULL)";
+}
+
+FitnessSqlStore::FitnessSqlStore(const QString &databasePath)
+    : m_databasePath(databasePath)
+    , m_connectionName(QStringLiteral("fitness-%1").arg(quintptr(this)))
+{
+}
+
+FitnessSqlStore::~FitnessSqlStore()
+{
+    // Queries and the handle must go before the connection is removed
+    m_selectDay = QSqlQuery();
+    m_selectRange = QSqlQuery();
+    m_selectCounts = QSqlQuery();
+    m_insertPlan = QSqlQuery();
+    m_deletePlan = QSqlQuery();
+    m_updateCompleted = QSqlQuery();
+    m_selectPlanDay = QSqlQuery();
+    m_updatePlan = QSqlQuery();
+    m_updateCompletedById = QSqlQuery();
+    m_movePlan = QSqlQuery();
+    m_deleteById = QSqlQuery();
+    if (m_database.isOpen()) {
+        m_database.close();
+    }
+    m_database = QSqlDatabase();
+    QSqlDatabase::removeDatabase(m_connectionName);
+}
+
+bool FitnessSqlStore::open()
+{
+    m_database = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), m_connectionName);
+    m_database.setDatabaseName(m_databasePath);
+    if (!m_database.open()) {
+        qWarning() << "Failed to open fitness database:" << m_databasePath << m_database.lastError().text();
+        return false;
+    }
+
+    // WAL keeps readers off the writer's lock; NORMAL sync is durable in WAL mode
+    exec(QStringLiteral("PRAGMA journal_mode=WAL"));
+    exec(QStringLiteral("PRAGMA synchronous=NORMAL"));
+
+    if (schemaVersion() == 1 && !upgradePlansTable()) {
+        return false;
+    }
+
+    const bool schemaReady =
+        exec(QStringLiteral("CREATE TABLE IF NOT EXISTS plans ") + QLatin1String(kPlansColumns))
+        && exec(QStringLiteral("CREATE INDEX IF NOT EXISTS plans_day ON plans(day)"))
+        && exec(QStringLiteral("CREATE INDEX IF NOT EXISTS plans_day_completed ON plans(day, completed)"))
+        && exec(QStringLiteral("CREATE TABLE IF NOT EXISTS meta (key TEXT PRIMARY KEY, value TEXT)"))
+        && exec(QStringLiteral("PRAGMA user_version=%1").arg(kSchemaVersion));
+    if (!schemaReady) {
+        return false;
+    }
+
+    // Plans of a day keep their insertion order, which the row id records
+    return prepare(m_selectDay, QStringLiteral(
+                       "SELECT id, name, description, completed, created_at FROM plans"
+                       " WHERE day = ? ORDER BY id"))
+        && prepare(m_selectRange, QStringLiteral(
+                       "SELECT day, id, name, description, completed, created_at FROM plans"
+                       " WHERE day BETWEEN ? AND ? ORDER BY day, id"))
+        && prepare(m_selectCounts, QStringLiteral(
+                       "SELECT COUNT(*), COALESCE(SUM(completed), 0) FROM plans WHERE day = ?"))
+        && prepare(m_insertPlan, QStringLiteral(
+                       "INSERT INTO plans (id, day, name, description, completed, created_at)"
+                       " VALUES (?, ?, ?, ?, ?, ?)"))
+        && prepare(m_deletePlan, QStringLiteral(
+                       "DELETE FROM plans WHERE id ="
+                       " (SELECT id FROM plans WHERE day = ? AND name = ? ORDER BY id LIMIT 1)"))
+        && prepare(m_updateCompleted, QStringLiteral(
+                       "UPDATE plans SET completed = ? WHERE id ="
+                       " (SELECT id FROM plans WHERE day = ? AND name = ? ORDER BY id LIMIT 1)"))
+        && prepare(m_selectPlanDay, QStringLiteral("SELECT day FROM plans WHERE id = ?"))
+        && prepare(m_updatePlan, QStringLiteral("UPDATE plans SET name = ?, description = ? WHERE id = ?"))
+        && prepare(m_updateCompletedById, QStringLiteral("UPDATE plans SET completed = ? WHERE id = ?"))
+        && prepare(m_movePlan, QStringLiteral("UPDATE plans SET day = ? WHERE id = ?"))
+        && prepare(m_deleteById, QStringLiteral("DELETE FROM plans WHERE id = ?"));
+}
+
+bool FitnessSqlStore::isOpen() const
+{
+    return m_database.isOpen();
+}
+
+QString FitnessSqlStore::databasePath() const
+{
+    return m_databasePath;
+}
+
+bool FitnessSqlStore::isMigrated() const
+{
+    QSqlQuery query(m_database);
+    query.prepare(QStringLiteral("SELECT value FROM meta WHERE key = ?"));
+    query.addBindValue(QString::fromLatin1(kMigratedKey));
+    return query.exec() && query.next();
+}
+
+bool FitnessSqlStore::migrateFrom(const FitnessPlanStore &plans)
+{
+    if (isMigrated()) {
+        return true;
+    }
+
+    // One transaction: a million inserts commit once, and an interrupted
+    // migration leaves nothing behind to be imported twice
+    if (!m_database.transaction()) {
+        qWarning() << "Failed to start fitness migration:" << m_database.lastError().text();
+        return false;
+    }
+
+    for (const FitnessDay &day : plans) {
+        for (const FitnessPlan &plan : day.plans) {
+            if (!addPlan(day.julianDay, plan)) {
+                m_database.rollback();
+                return false;
+            }
+        }
+    }
+
+    QSqlQuery mark(m_database);
+    mark.prepare(QStringLiteral("INSERT OR REPLACE INTO meta (key, value) VALUES (?, ?)"));
+    mark.addBindValue(QString::fromLatin1(kMigratedKey));
+    mark.addBindValue(QString::number(plans.planCount()));
+    if (!run(mark) || !m_database.commit()) {
+        m_database.rollback();
+        return false;
+    }
+
+    qDebug() << "Migrated" << plans.planCount() << "fitness plans into" << m_databasePath;
+    return true;
+}
+
+QList<FitnessPlan> FitnessSqlStore::plans(qint64 julianDay)
+{
+    QList<FitnessPlan> result;
+
+    m_selectDay.addBindValue(julianDay);
+    if (!run(m_selectDay)) {
+        m_selectDay.finish();
+        return result;
+    }
+    while (m_selectDay.next()) {
+        result.append(planFromQuery(m_selectDay, 0));
+    }
+    m_selectDay.finish();
+    return result;
+}
+
+QVector<FitnessDay> FitnessSqlStore::range(qint64 firstDay, qint64 lastDay)
+{
+    QVector<FitnessDay> result;
+
+    m_selectRange.addBindValue(firstDay);
+    m_selectRange.addBindValue(lastDay);
+    if (!run(m_selectRange)) {
+        m_selectRange.finish();
+        return result;
+    }
+
+    // Rows arrive grouped by day
+    while (m_selectRange.next()) {
+        const qint64 day = m_selectRange.value(0).toLongLong();
+        if (result.isEmpty() || result.last().julianDay != day) {
+            result.append(FitnessDay(day));
+        }
+
+        const FitnessPlan plan = planFromQuery(m_selectRange, 1);
+        FitnessDay &entry = result.last();
+        entry.plans.append(plan);
+        if (plan.completed) {
+            ++entry.completedCount;
+        }
+    }
+    m_selectRange.finish();
+    return result;
+}
+
+bool FitnessSqlStore::counts(qint64 julianDay, int *completed, int *total)
+{
+    // finish() on every path: an unfinished SELECT keeps its read snapshot open
+    m_selectCounts.addBindValue(julianDay);
+    const bool found = run(m_selectCounts) && m_selectCounts.next();
+    if (found && total) {
+        *total = m_selectCounts.value(0).toInt();
+    }
+    if (found && completed) {
+        *completed = m_selectCounts.value(1).toInt();
+    }
+    m_selectCounts.finish();
+    return found;
+}
+
+quint64 FitnessSqlStore::addPlan(qint64 julianDay, const FitnessPlan &plan)
+{
+    // NULL lets SQLite pick the next row id
+    m_insertPlan.addBindValue(plan.id ? QVariant(qint64(plan.id)) : QVariant(QVariant::LongLong));
+    m_insertPlan.addBindValue(julianDay);
+    m_insertPlan.addBindValue(plan.name);
+    m_insertPlan.addBindValue(plan.description);
+    m_insertPlan.addBindValue(plan.completed ? 1 : 0);
+    m_insertPlan.addBindValue(plan.createdAt.toMSecsSinceEpoch());
+    if (!run(m_insertPlan)) {
+        return 0;
+    }
+    return m_insertPlan.lastInsertId().toULongLong();
+}
+
+bool FitnessSqlStore::removePlan(qint64 julianDay, const QString &name)
+{
+    m_deletePlan.addBindValue(julianDay);
+    m_deletePlan.addBindValue(name);
+    return run(m_deletePlan) && m_deletePlan.numRowsAffected() > 0;
+}
+
+bool FitnessSqlStore::setCompleted(qint64 julianDay, const QString &name, bool completed)
+{
+    m_updateCompleted.addBindValue(completed ? 1 : 0);
+    m_updateCompleted.addBindValue(julianDay);
+    m_updateCompleted.addBindValue(name);
+    return run(m_updateCompleted) && m_updateCompleted.numRowsAffected() > 0;
+}
+
+bool FitnessSqlStore::clear()
+{
+    return exec(QStringLiteral("DELETE FROM plans"));
+}
+
+bool FitnessSqlStore::dayOf(quint64 id, qint64 *julianDay)
+{
+    m_selectPlanDay.addBindValue(qint64(id));
+    const bool found = run(m_selectPlanDay) && m_selectPlanDay.next();
+    if (found) {
+        *julianDay = m_selectPlanDay.value(0).toLongLong();
+    }
+    m_selectPlanDay.finish();
+    return found;
+}
+
+bool FitnessSqlStore::updatePlan(quint64 id, const QString &name, const QString &description)
+{
+    m_updatePlan.addBindValue(name);
+    m_updatePlan.addBindValue(description);
+    m_updatePlan.addBindValue(qint64(id));
+    return run(m_updatePlan) && m_updatePlan.numRowsAffected() > 0;
+}
+
+bool FitnessSqlStore::setCompletedById(quint64 id, bool completed)
+{
+    m_updateCompletedById.addBindValue(completed ? 1 : 0);
+    m_updateCompletedById.addBindValue(qint64(id));
+    return run(m_updateCompletedById) && m_updateCompletedById.numRowsAffected() > 0;
+}
+
+bool FitnessSqlStore::movePlan(quint64 id, qint64 julianDay)
+{
+    m_movePlan.addBindValue(julianDay);
+    m_movePlan.addBindValue(qint64(id));
+    return run(m_movePlan) && m_movePlan.numRowsAffected() > 0;
+}
+
+bool FitnessSqlStore::removePlanById(quint64 id)
+{
+    m_deleteById.addBindValue(qint64(id));
+    return run(m_deleteById) && m_deleteById.numRowsAffected() > 0;
+}
+
+bool FitnessSqlStore::beginBatch()
+{
+    return m_database.transaction();
+}
+
+bool FitnessSqlStore::commitBatch()
+{
+    if (!m_database.commit()) {
+        qWarning() << "Fitness batch commit failed:" << m_database.lastError().text();
+        m_database.rollback();
+        return false;
+    }
+    return true;
+}
+
+void FitnessSqlStore::rollbackBatch()
+{
+    m_database.rollback();
+}
+
+int FitnessSqlStore::schemaVersion()
+{
+    QSqlQuery query(m_database);
+    return query.exec(QStringLiteral("PRAGMA user_version")) && query.next() ? query.value(0).toInt() : 0;
+}
+
+// Version 1 declared a plain INTEGER PRIMARY KEY, under which SQLite may
+// reuse the largest ID after that plan is deleted. SQLite cannot add
+// AUTOINCREMENT in place, so the table is copied into a new one; the
+// copy seeds the sequence with the largest existing ID.
+bool FitnessSqlStore::upgradePlansTable()
+{
+    if (!m_database.transaction()) {
+        qWarning() << "Failed to start fitness schema upgrade:" << m_database.lastError().text();
+        return false;
+    }
+
+    const bool copied =
+        exec(QStringLiteral("CREATE TABLE plans_v2 ") + QLatin1String(kPlansColumns))
+        && exec(QStringLiteral("INSERT INTO plans_v2 (id, day, name, description, completed, created_at)"
+                               " SELECT id, day, name, description, completed, created_at FROM plans"))
+        && exec(QStringLiteral("DROP TABLE plans"))
+        && exec(QStringLiteral("ALTER TABLE plans_v2 RENAME TO plans"));
+    if (!copied || !m_database.commit()) {
+        m_database.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool FitnessSqlStore::exec(const QString &statement)
+{
+    QSqlQuery query(m_database);
+    if (!query.exec(statement)) {
+        qWarning() << "Fitness database statement failed:" << statement << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool FitnessSqlStore::prepare(QSqlQuery &query, const QString &statement)
+{
+    query = QSqlQuery(m_database);
+    if (!query.prepare(statement)) {
+        qWarning() << "Failed to prepare fitness query:" << statement << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool FitnessSqlStore::run(QSqlQuery &query)
+{
+    if (!query.exec()) {
+        qWarning() << "Fitness query failed:" << query.lastQuery() << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+FitnessPlan FitnessSqlStore::planFromQuery(const QSqlQuery &query, int firstColumn)
+{
+    FitnessPlan plan;
+    plan.id = query.value(firstColumn).toULongLong();
+    plan.name = query.value(firstColumn + 1).toString();
+    plan.description = query.value(firstColumn + 2).toString();
+    plan.completed = query.value(firstColumn + 3).toBool();
+    plan.createdAt = QDateTime::fromMSecsSinceEpoch(query.value(firstColumn + 4).toLongLong());
+    return plan;
+}
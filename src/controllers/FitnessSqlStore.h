@@ -0,0 +1,82 @@
+#ifndef FITNESSSQLSTORE_H
+#define FITNESSSQLSTORE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QVector>
+#include "FitnessPlanStore.h"
+
+// Fitness plans in an embedded SQLite database (Qt's bundled QSQLITE
+// driver), for histories too large to keep in memory. Only the rows a
+// query asks for are read: a month view touches one month of plans.
+//
+// Schema: one row per plan keyed by Julian day, indexed on (day) and
+// (day, completed). The row id is the plan ID; AUTOINCREMENT keeps the
+// ID of a deleted plan from being handed out again (schema version 2,
+// version 1 tables are rebuilt at open()). Every query the calendar
+// issues is a statement prepared once at open().
+class FitnessSqlStore
+{
+public:
+    explicit FitnessSqlStore(const QString &databasePath);
+    ~FitnessSqlStore();
+
+    bool open();
+    bool isOpen() const;
+    QString databasePath() const;
+
+    // One-shot import of an in-memory store; later calls are no-ops
+    bool isMigrated() const;
+    bool migrateFrom(const FitnessPlanStore &plans);
+
+    // Lookup
+    QList<FitnessPlan> plans(qint64 julianDay);
+    QVector<FitnessDay> range(qint64 firstDay, qint64 lastDay);
+    bool counts(qint64 julianDay, int *completed, int *total);
+
+    // Mutation; addPlan returns the plan ID, 0 on failure
+    quint64 addPlan(qint64 julianDay, const FitnessPlan &plan);
+    bool removePlan(qint64 julianDay, const QString &name);
+    bool setCompleted(qint64 julianDay, const QString &name, bool completed);
+    bool clear();
+
+    // By plan ID
+    bool dayOf(quint64 id, qint64 *julianDay);
+    bool updatePlan(quint64 id, const QString &name, const QString &description);
+    bool setCompletedById(quint64 id, bool completed);
+    bool movePlan(quint64 id, qint64 julianDay);
+    bool removePlanById(quint64 id);
+
+    // Groups mutations into one transaction
+    bool beginBatch();
+    bool commitBatch();
+    void rollbackBatch();
+
+private:
+    int schemaVersion();
+    bool upgradePlansTable();
+    bool exec(const QString &statement);
+    bool prepare(QSqlQuery &query, const QString &statement);
+    bool run(QSqlQuery &query);
+    static FitnessPlan planFromQuery(const QSqlQuery &query, int firstColumn);
+
+    QString m_databasePath;
+    QString m_connectionName;
+    QSqlDatabase m_database;
+
+    // Prepared once, re-bound per call
+    QSqlQuery m_selectDay;
+    QSqlQuery m_selectRange;
+    QSqlQuery m_selectCounts;
+    QSqlQuery m_insertPlan;
+    QSqlQuery m_deletePlan;
+    QSqlQuery m_updateCompleted;
+    QSqlQuery m_selectPlanDay;
+    QSqlQuery m_updatePlan;
+    QSqlQuery m_updateCompletedById;
+    QSqlQuery m_movePlan;
+    QSqlQuery m_deleteById;
+};
+
+#endif // FITNESSSQLSTORE_H
@@ -0,0 +1,258 @@
+#include "MotionEngine.h"
+#include <QLineF>
+#include <QRandomGenerator>
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+const qreal kStep = 1.0 / 120.0;     // Fixed integration step, seconds
+const int kMaxStepsPerAdvance = 30;  // Don't spiral after a long stall
+const int kSegmentsPerCurve = 32;
+
+QPointF cubicPoint(const QPointF &p0, const QPointF &p1, const QPointF &p2, const QPointF &p3, qreal t)
+{
+    const qreal u = 1.0 - t;
+    return u * u * u * p0 + 3 * u * u * t * p1 + 3 * u * t * t * p2 + t * t * t * p3;
+}
+
+QPointF perpendicular(const QPointF &direction)
+{
+    return QPointF(-direction.y(), direction.x());
+}
+
+qreal randomSigned()
+{
+    return QRandomGenerator::global()->generateDouble() * 2.0 - 1.0;
+}
+}
+
+MotionEngine::MotionEngine()
+    : m_maxSpeed(600.0)
+    , m_acceleration(1500.0)
+    , m_distance(0.0)
+    , m_previousDistance(0.0)
+    , m_speed(0.0)
+    , m_lastTime(0)
+    , m_accumulator(0.0)
+    , m_active(false)
+{
+}
+
+void MotionEngine::setMaxSpeed(qreal pixelsPerSecond)
+{
+    m_maxSpeed = qMax<qreal>(1.0, pixelsPerSecond);
+}
+
+void MotionEngine::setAcceleration(qreal pixelsPerSecondSquared)
+{
+    m_acceleration = qMax<qreal>(1.0, pixelsPerSecondSquared);
+}
+
+qreal MotionEngine::maxSpeed() const
+{
+    return m_maxSpeed;
+}
+
+qreal MotionEngine::acceleration() const
+{
+    return m_acceleration;
+}
+
+void MotionEngine::start(const QPointF &from, const QPointF &to, PathType path, qint64 now)
+{
+    buildPath(from, to, path);
+
+    m_distance = 0.0;
+    m_previousDistance = 0.0;
+    m_speed = 0.0;
+    m_lastTime = now;
+    m_accumulator = 0.0;
+    m_active = pathLength() > 0.0;
+}
+
+void MotionEngine::stop()
+{
+    m_active = false;
+    m_speed = 0.0;
+}
+
+void MotionEngine::shiftTime(qint64 offset)
+{
+    m_lastTime += offset;
+}
+
+bool MotionEngine::advance(qint64 now)
+{
+    if (!m_active) {
+        return false;
+    }
+
+    m_accumulator += (now - m_lastTime) / 1000.0;
+    m_lastTime = now;
+
+    int steps = 0;
+    while (m_accumulator >= kStep && m_active) {
+        if (++steps > kMaxStepsPerAdvance) {
+            m_accumulator = 0.0;
+            break;
+        }
+        m_previousDistance = m_distance;
+        step(kStep);
+        m_accumulator -= kStep;
+    }
+
+    return m_active;
+}
+
+bool MotionEngine::isActive() const
+{
+    return m_active;
+}
+
+QPointF MotionEngine::position() const
+{
+    if (m_points.isEmpty()) {
+        return QPointF();
+    }
+    if (!m_active) {
+        return pointAt(m_distance);
+    }
+
+    // Blend the last two fixed steps by the leftover frame time
+    const qreal alpha = qBound<qreal>(0.0, m_accumulator / kStep, 1.0);
+    return pointAt(m_previousDistance + (m_distance - m_previousDistance) * alpha);
+}
+
+QPointF MotionEngine::velocity() const
+{
+    if (m_points.size() < 2 || !m_active) {
+        return QPointF();
+    }
+
+    const QPointF ahead = pointAt(qMin(m_distance + 1.0, pathLength()));
+    const QPointF here = pointAt(m_distance);
+    const QLineF tangent(here, ahead);
+    if (tangent.length() <= 0.0) {
+        return QPointF();
+    }
+    return (ahead - here) / tangent.length() * m_speed;
+}
+
+qreal MotionEngine::pathLength() const
+{
+    return m_lengths.isEmpty() ? 0.0 : m_lengths.last();
+}
+
+qint64 MotionEngine::estimatedDuration() const
+{
+    // Trapezoidal profile; triangular when maxSpeed is never reached
+    const qreal length = pathLength();
+    const qreal rampDistance = m_maxSpeed * m_maxSpeed / m_acceleration;
+    qreal seconds;
+    if (length <= rampDistance) {
+        seconds = 2.0 * qSqrt(length / m_acceleration);
+    } else {
+        seconds = 2.0 * m_maxSpeed / m_acceleration + (length - rampDistance) / m_maxSpeed;
+    }
+    return qRound64(seconds * 1000.0);
+}
+
+void MotionEngine::buildPath(const QPointF &from, const QPointF &to, PathType path)
+{
+    m_points.clear();
+    m_lengths.clear();
+    m_points.append(from);
+
+    const QPointF delta = to - from;
+    const QPointF normal = perpendicular(delta);
+
+    switch (path) {
+    case Arc: {
+        // Circular-looking arc bulging a quarter of the distance to one side
+        const qreal side = QRandomGenerator::global()->bounded(2) ? 1.0 : -1.0;
+        const QPointF bulge = normal * 0.25 * side;
+        appendCubic(from, from + delta / 3.0 + bulge * 4.0 / 3.0,
+                    from + delta * 2.0 / 3.0 + bulge * 4.0 / 3.0, to);
+        break;
+    }
+    case Bezier:
+        appendCubic(from,
+                    from + delta * 0.3 + normal * 0.4 * randomSigned(),
+                    from + delta * 0.7 + normal * 0.4 * randomSigned(),
+                    to);
+        break;
+    case Wander: {
+        // Catmull-Rom through a few jittered waypoints
+        const int waypointCount = 3;
+        QVector<QPointF> waypoints;
+        waypoints << from;
+        for (int i = 1; i <= waypointCount; ++i) {
+            const qreal t = qreal(i) / (waypointCount + 1);
+            waypoints << from + delta * t + normal * 0.2 * randomSigned();
+        }
+        waypoints << to;
+
+        for (int i = 0; i + 1 < waypoints.size(); ++i) {
+            const QPointF p0 = waypoints[qMax(0, i - 1)];
+            const QPointF p1 = waypoints[i];
+            const QPointF p2 = waypoints[i + 1];
+            const QPointF p3 = waypoints[qMin(waypoints.size() - 1, i + 2)];
+            appendCubic(p1, p1 + (p2 - p0) / 6.0, p2 - (p3 - p1) / 6.0, p2);
+        }
+        break;
+    }
+    case Line:
+    default:
+        m_points.append(to);
+        break;
+    }
+
+    m_lengths.reserve(m_points.size());
+    qreal length = 0.0;
+    m_lengths.append(0.0);
+    for (int i = 1; i < m_points.size(); ++i) {
+        length += QLineF(m_points[i - 1], m_points[i]).length();
+        m_lengths.append(length);
+    }
+}
+
+void MotionEngine::appendCubic(const QPointF &p0, const QPointF &p1, const QPointF &p2, const QPointF &p3)
+{
+    for (int i = 1; i <= kSegmentsPerCurve; ++i) {
+        m_points.append(cubicPoint(p0, p1, p2, p3, qreal(i) / kSegmentsPerCurve));
+    }
+}
+
+void MotionEngine::step(qreal dt)
+{
+    const qreal remaining = pathLength() - m_distance;
+
+    // Accelerate towards maxSpeed, but never faster than we can brake from
+    const qreal brakingSpeed = qSqrt(2.0 * m_acceleration * remaining);
+    m_speed = qMin(qMin(m_speed + m_acceleration * dt, m_maxSpeed), brakingSpeed);
+
+    // Always make some progress so rounding can't stall the arrival
+    const qreal travelled = qMax(m_speed * dt, qMin(remaining, 0.5));
+    m_distance = qMin(m_distance + travelled, pathLength());
+
+    if (m_distance >= pathLength()) {
+        m_distance = pathLength();
+        m_previousDistance = m_distance;
+        m_active = false;
+        m_speed = 0.0;
+    }
+}
+
+QPointF MotionEngine::pointAt(qreal distance) const
+{
+    if (m_points.size() < 2) {
+        return m_points.isEmpty() ? QPointF() : m_points.first();
+    }
+
+    auto it = std::lower_bound(m_lengths.cbegin(), m_lengths.cend(), distance);
+    int index = qBound(1, int(it - m_lengths.cbegin()), m_points.size() - 1);
+
+    const qreal segmentLength = m_lengths[index] - m_lengths[index - 1];
+    const qreal t = segmentLength > 0.0 ? (distance - m_lengths[index - 1]) / segmentLength : 1.0;
+    return m_points[index - 1] + (m_points[index] - m_points[index - 1]) * qBound<qreal>(0.0, t, 1.0);
+}
@@ -0,0 +1,67 @@
+#ifndef MOTIONENGINE_H
+#define MOTIONENGINE_H
+
+#include <QPointF>
+#include <QVector>
+
+// Moves a point along a path with a fixed-timestep integrator.
+// Speed ramps up with a bounded acceleration, cruises at maxSpeed and
+// brakes so it arrives at rest, so move durations follow distance
+// instead of being constant. advance() is called once per displayed
+// frame and runs as many fixed steps as the frame time covers.
+class MotionEngine
+{
+public:
+    enum PathType {
+        Line = 0,
+        Arc = 1,
+        Bezier = 2,
+        Wander = 3
+    };
+
+    MotionEngine();
+
+    // Motion parameters, in pixels per second (squared)
+    void setMaxSpeed(qreal pixelsPerSecond);
+    void setAcceleration(qreal pixelsPerSecondSquared);
+    qreal maxSpeed() const;
+    qreal acceleration() const;
+
+    void start(const QPointF &from, const QPointF &to, PathType path, qint64 now);
+    void stop();
+
+    // Moves the engine onto another time base without a jump
+    void shiftTime(qint64 offset);
+
+    // Integrates up to now; returns false once the target is reached
+    bool advance(qint64 now);
+
+    bool isActive() const;
+    QPointF position() const;
+    QPointF velocity() const;
+    qreal pathLength() const;
+    qint64 estimatedDuration() const;
+
+private:
+    void buildPath(const QPointF &from, const QPointF &to, PathType path);
+    void appendCubic(const QPointF &p0, const QPointF &p1, const QPointF &p2, const QPointF &p3);
+    void step(qreal dt);
+    QPointF pointAt(qreal distance) const;
+
+    // Path flattened to a polyline with cumulative arc length
+    QVector<QPointF> m_points;
+    QVector<qreal> m_lengths;
+
+    qreal m_maxSpeed;
+    qreal m_acceleration;
+
+    // Integrator state: distance travelled along the path and speed
+    qreal m_distance;
+    qreal m_previousDistance;
+    qreal m_speed;
+    qint64 m_lastTime;
+    qreal m_accumulator;
+    bool m_active;
+};
+
+#endif // MOTIONENGINE_H
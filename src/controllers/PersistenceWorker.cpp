@@ -0,0 +1,187 @@
+#include "PersistenceWorker.h"
+#include <QSaveFile>
+#include <QVector>
+#include <QDebug>
+#include <limits>
+
+PersistenceWorker::PersistenceWorker(int debounceMs, int maxDelayMs, QObject *parent)
+    : QObject(parent)
+    , m_debounceMs(qMax(0, debounceMs))
+    , m_maxDelayMs(qMax(debounceMs, maxDelayMs))
+    , m_running(0)
+    , m_flushRequested(false)
+    , m_stopping(false)
+{
+    m_clock.start();
+    m_thread.reset(QThread::create([this]() { run(); }));
+    m_thread->setObjectName(QStringLiteral("PersistenceWorker"));
+    m_thread->start(QThread::LowPriority);
+}
+
+PersistenceWorker::~PersistenceWorker()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+    m_thread->wait();
+}
+
+int PersistenceWorker::debounceInterval() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_debounceMs;
+}
+
+void PersistenceWorker::setDebounceInterval(int ms)
+{
+    QMutexLocker locker(&m_mutex);
+    m_debounceMs = qMax(0, ms);
+    m_maxDelayMs = qMax(m_maxDelayMs, m_debounceMs);
+    m_wake.wakeAll();
+}
+
+void PersistenceWorker::schedule(const QString &key, const Job &job)
+{
+    QMutexLocker locker(&m_mutex);
+    const qint64 now = m_clock.elapsed();
+    ++m_stats.requests;
+
+    auto it = m_pending.find(key);
+    if (it == m_pending.end()) {
+        Entry entry;
+        entry.job = job;
+        entry.firstRequested = now;
+        entry.deadline = now + m_debounceMs;
+        m_pending.insert(key, entry);
+    } else {
+        // Newer snapshot wins; the quiet period restarts but stays bounded
+        it->job = job;
+        it->deadline = qMin(now + m_debounceMs, it->firstRequested + m_maxDelayMs);
+    }
+    m_wake.wakeAll();
+}
+
+void PersistenceWorker::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    m_flushRequested = true;
+    m_wake.wakeAll();
+    while (!m_pending.isEmpty() || m_running > 0) {
+        m_idle.wait(&m_mutex);
+    }
+    m_flushRequested = false;
+}
+
+bool PersistenceWorker::isIdle() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pending.isEmpty() && m_running == 0;
+}
+
+PersistenceWorker::Stats PersistenceWorker::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+QVariantMap PersistenceWorker::statistics() const
+{
+    const Stats current = stats();
+
+    QVariantMap result;
+    result["requests"] = current.requests;
+    result["writes"] = current.writes;
+    result["failures"] = current.failures;
+    result["bytesWritten"] = current.bytesWritten;
+    result["lastLatencyMs"] = current.lastLatencyMs;
+    result["maxLatencyMs"] = current.maxLatencyMs;
+    result["lastWriteMs"] = current.lastWriteMs;
+    result["maxWriteMs"] = current.maxWriteMs;
+    result["coalesceRatio"] = current.coalesceRatio();
+    return result;
+}
+
+qint64 PersistenceWorker::writeFile(const QString &path, const QByteArray &data)
+{
+    // Written aside and renamed into place, so a crash never leaves half a file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write:" << path << file.errorString();
+        return -1;
+    }
+
+    if (file.write(data) != data.size() || !file.commit()) {
+        qWarning() << "Failed to write:" << path << file.errorString();
+        return -1;
+    }
+    return data.size();
+}
+
+void PersistenceWorker::run()
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (;;) {
+        if (m_pending.isEmpty()) {
+            if (m_stopping) {
+                return;
+            }
+            m_wake.wait(&m_mutex);
+            continue;
+        }
+
+        // Stopping and flushing run everything; otherwise only what is due
+        const bool all = m_stopping || m_flushRequested;
+        const qint64 now = m_clock.elapsed();
+        qint64 nextDeadline = std::numeric_limits<qint64>::max();
+        QVector<QPair<QString, Entry>> due;
+        for (auto it = m_pending.begin(); it != m_pending.end();) {
+            if (all || it->deadline <= now) {
+                due.append(qMakePair(it.key(), it.value()));
+                it = m_pending.erase(it);
+            } else {
+                nextDeadline = qMin(nextDeadline, it->deadline);
+                ++it;
+            }
+        }
+
+        if (due.isEmpty()) {
+            m_wake.wait(&m_mutex, ulong(nextDeadline - now));
+            continue;
+        }
+
+        m_running = due.size();
+        locker.unlock();
+
+        for (const auto &item : due) {
+            QElapsedTimer writeTimer;
+            writeTimer.start();
+            const qint64 bytes = item.second.job();
+            const qint64 writeMs = writeTimer.elapsed();
+
+            locker.relock();
+            const qint64 latencyMs = m_clock.elapsed() - item.second.firstRequested;
+            ++m_stats.writes;
+            if (bytes < 0) {
+                ++m_stats.failures;
+            } else {
+                m_stats.bytesWritten += bytes;
+            }
+            m_stats.lastLatencyMs = latencyMs;
+            m_stats.maxLatencyMs = qMax(m_stats.maxLatencyMs, latencyMs);
+            m_stats.lastWriteMs = writeMs;
+            m_stats.maxWriteMs = qMax(m_stats.maxWriteMs, writeMs);
+            --m_running;
+            locker.unlock();
+
+            emit saved(item.first, bytes >= 0);
+        }
+
+        locker.relock();
+        if (m_pending.isEmpty()) {
+            m_idle.wakeAll();
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef PERSISTENCEWORKER_H
+#define PERSISTENCEWORKER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+#include <QThread>
+#include <QVariantMap>
+#include <QWaitCondition>
+#include <functional>
+
+// Write-behind saving on one dedicated thread. Callers hand over a job
+// that captures an immutable snapshot (a QJsonObject, a byte array, a
+// path to sync) under a key; scheduling the same key again inside the
+// debounce window replaces the pending job, so a burst of edits costs one
+// write. A job is never delayed past maxDelay from its first request.
+//
+// Files are replaced through QSaveFile: a crash mid-write leaves the
+// previous version in place, never a truncated one.
+class PersistenceWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Runs on the worker thread; returns bytes written, or -1 on failure
+    using Job = std::function<qint64()>;
+
+    struct Stats {
+        quint64 requests = 0;
+        quint64 writes = 0;
+        quint64 failures = 0;
+        qint64 bytesWritten = 0;
+        qint64 lastLatencyMs = 0; // First request to write finished
+        qint64 maxLatencyMs = 0;
+        qint64 lastWriteMs = 0;   // Time spent in the job itself
+        qint64 maxWriteMs = 0;
+
+        qreal coalesceRatio() const { return writes ? qreal(requests) / writes : 0.0; }
+    };
+
+    explicit PersistenceWorker(int debounceMs = 500, int maxDelayMs = 2000, QObject *parent = nullptr);
+    ~PersistenceWorker(); // Runs whatever is still pending
+
+    int debounceInterval() const;
+    void setDebounceInterval(int ms);
+
+    void schedule(const QString &key, const Job &job);
+    void flush(); // Runs every pending job now and waits for them
+    bool isIdle() const;
+
+    Stats stats() const;
+    Q_INVOKABLE QVariantMap statistics() const;
+
+    // Atomic replace of path with data; returns data.size(), or -1
+    static qint64 writeFile(const QString &path, const QByteArray &data);
+
+signals:
+    // Emitted from the worker thread; queued to receivers in other threads
+    void saved(const QString &key, bool ok);
+
+private:
+    struct Entry {
+        Job job;
+        qint64 firstRequested;
+        qint64 deadline;
+    };
+
+    void run();
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake; // Worker: new job, flush or stop
+    QWaitCondition m_idle; // Flushing callers: nothing pending or running
+    QHash<QString, Entry> m_pending;
+    QElapsedTimer m_clock;
+    int m_debounceMs;
+    int m_maxDelayMs;
+    int m_running;
+    bool m_flushRequested;
+    bool m_stopping;
+    Stats m_stats;
+    QScopedPointer<QThread> m_thread; // Last member: joined before the rest goes away
+};
+
+#endif // PERSISTENCEWORKER_H
@@ -0,0 +1,350 @@
+#include "Scheduler.h"
+#include "WakeupMonitor.h"
+#include <QCoreApplication>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QDebug>
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#ifdef Q_OS_LINUX
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+#endif
+
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#endif
+
+namespace {
+const qint64 kMaxIntervalMs = 24 * 3600 * 1000; // Far deadlines re-arm once a day
+const qint64 kClockJumpMs = 2000;               // Wall vs monotonic drift that counts as a jump
+const char kZoneFile[] = "/etc/localtime";
+}
+
+Scheduler *Scheduler::instance()
+{
+    static Scheduler scheduler;
+    return &scheduler;
+}
+
+Scheduler::Scheduler(QObject *parent)
+    : QObject(parent)
+    , m_nextId(1)
+    , m_armedDue(0)
+    , m_armedWall(0)
+    , m_armedOffset(0)
+    , m_wakeups(0)
+    , m_fired(0)
+    , m_clockChanges(0)
+    , m_clockChangePending(false)
+    , m_clockFd(-1)
+    , m_clockNotifier(nullptr)
+    , m_zoneWatcher(nullptr)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, [this]() {
+        WakeupMonitor::instance()->record("scheduler");
+        ++m_wakeups;
+        if (clockJumped()) {
+            clockWasChanged();
+        } else {
+            runDue();
+            arm();
+        }
+    });
+
+    watchClock();
+}
+
+Scheduler::~Scheduler()
+{
+    unwatchClock();
+}
+
+quint64 Scheduler::schedule(const QDateTime &deadline, QObject *context, const Callback &callback, const char *source)
+{
+    if (!deadline.isValid() || !callback) {
+        return 0;
+    }
+
+    const quint64 id = m_nextId++;
+    Job job;
+    job.due = deadline.toMSecsSinceEpoch();
+    job.context = context;
+    job.hasContext = context != nullptr;
+    job.callback = callback;
+    job.source = source;
+    m_jobs.insert(id, job);
+    push(id, job.due);
+
+    if (!m_timer.isActive() || job.due < m_armedDue) {
+        arm();
+    }
+    return id;
+}
+
+bool Scheduler::reschedule(quint64 id, const QDateTime &deadline)
+{
+    auto it = m_jobs.find(id);
+    if (it == m_jobs.end() || !deadline.isValid()) {
+        return false;
+    }
+
+    const qint64 due = deadline.toMSecsSinceEpoch();
+    if (it->due == due) {
+        return true;
+    }
+
+    // The old heap entry goes stale: its deadline no longer matches the job
+    const bool wasArmed = it->due == m_armedDue;
+    it->due = due;
+    push(id, due);
+    if (wasArmed || !m_timer.isActive() || due < m_armedDue) {
+        arm();
+    }
+    return true;
+}
+
+bool Scheduler::cancel(quint64 id)
+{
+    auto it = m_jobs.find(id);
+    if (it == m_jobs.end()) {
+        return false;
+    }
+
+    const bool wasArmed = it->due == m_armedDue;
+    m_jobs.erase(it);
+    if (wasArmed) {
+        arm();
+    }
+    return true;
+}
+
+bool Scheduler::isScheduled(quint64 id) const
+{
+    return m_jobs.contains(id);
+}
+
+QDateTime Scheduler::deadline(quint64 id) const
+{
+    auto it = m_jobs.constFind(id);
+    return it == m_jobs.constEnd() ? QDateTime() : QDateTime::fromMSecsSinceEpoch(it->due);
+}
+
+int Scheduler::pendingCount() const
+{
+    return m_jobs.size();
+}
+
+QVariantMap Scheduler::statistics() const
+{
+    QVariantMap stats;
+    stats["pending"] = m_jobs.size();
+    stats["heapEntries"] = int(m_heap.size());
+    stats["wakeups"] = m_wakeups;
+    stats["fired"] = m_fired;
+    stats["clockChanges"] = m_clockChanges;
+    stats["nextDeadline"] = m_timer.isActive() ? QDateTime::fromMSecsSinceEpoch(m_armedDue) : QDateTime();
+    return stats;
+}
+
+void Scheduler::clockWasChanged()
+{
+    m_clockChangePending = false;
+    ++m_clockChanges;
+    qDebug() << "Wall clock or time zone changed, re-arming" << m_jobs.size() << "scheduled jobs";
+
+    // Owners move local-time deadlines first, then whatever is due runs
+    emit clockChanged();
+    runDue();
+    arm();
+}
+
+bool Scheduler::nativeEventFilter(const QByteArray &eventType, void *message, long *result)
+{
+    Q_UNUSED(result)
+#ifdef Q_OS_WIN
+    if (eventType == "windows_generic_MSG") {
+        const MSG *msg = static_cast<const MSG *>(message);
+        const bool changed = msg->message == WM_TIMECHANGE
+            || (msg->message == WM_POWERBROADCAST && msg->wParam == PBT_APMRESUMEAUTOMATIC);
+
+        // Every top-level window gets the broadcast; handle it once
+        if (changed && !m_clockChangePending) {
+            m_clockChangePending = true;
+            QMetaObject::invokeMethod(this, &Scheduler::clockWasChanged, Qt::QueuedConnection);
+        }
+    }
+#else
+    Q_UNUSED(eventType)
+    Q_UNUSED(message)
+#endif
+    return false;
+}
+
+void Scheduler::push(quint64 id, qint64 due)
+{
+    m_heap.push_back(Entry{ due, id });
+    std::push_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+
+    // Each live job has one current entry; the rest are stale
+    if (m_heap.size() > 2 * size_t(m_jobs.size()) + 16) {
+        sweep();
+    }
+}
+
+bool Scheduler::isStale(const Entry &entry) const
+{
+    auto it = m_jobs.constFind(entry.id);
+    return it == m_jobs.constEnd() || it->due != entry.due;
+}
+
+void Scheduler::arm()
+{
+    while (!m_heap.empty() && isStale(m_heap.front())) {
+        std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+        m_heap.pop_back();
+    }
+
+    if (m_heap.empty()) {
+        m_timer.stop();
+        return;
+    }
+
+    m_armedDue = m_heap.front().due;
+    m_armedWall = QDateTime::currentMSecsSinceEpoch();
+    m_armedOffset = QDateTime::currentDateTime().offsetFromUtc();
+    m_armedClock.start();
+    m_timer.start(int(qBound<qint64>(0, m_armedDue - m_armedWall, kMaxIntervalMs)));
+}
+
+void Scheduler::runDue()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    // Jobs that callbacks schedule wait for the next pass, so a callback
+    // rescheduling itself in the past cannot spin here
+    const quint64 firstNewId = m_nextId;
+
+    while (!m_heap.empty() && m_heap.front().due <= now && m_heap.front().id < firstNewId) {
+        const Entry entry = m_heap.front();
+        std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+        m_heap.pop_back();
+
+        auto it = m_jobs.find(entry.id);
+        if (it == m_jobs.end() || it->due != entry.due) {
+            continue;
+        }
+
+        // One-shot: gone before its callback runs, which may schedule again
+        const Job job = it.value();
+        m_jobs.erase(it);
+        if (job.hasContext && !job.context) {
+            continue;
+        }
+
+        WakeupMonitor::instance()->record(job.source);
+        ++m_fired;
+        job.callback();
+    }
+}
+
+void Scheduler::sweep()
+{
+    m_heap.clear();
+    m_heap.reserve(size_t(m_jobs.size()));
+    for (auto it = m_jobs.cbegin(); it != m_jobs.cend(); ++it) {
+        m_heap.push_back(Entry{ it->due, it.key() });
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+}
+
+bool Scheduler::clockJumped() const
+{
+    if (!m_armedClock.isValid()) {
+        return false;
+    }
+
+    // QElapsedTimer ignores clock changes (and usually sleep), the wall clock does not
+    const qint64 expected = m_armedWall + m_armedClock.elapsed();
+    return qAbs(QDateTime::currentMSecsSinceEpoch() - expected) > kClockJumpMs
+        || QDateTime::currentDateTime().offsetFromUtc() != m_armedOffset;
+}
+
+void Scheduler::watchClock()
+{
+    // Static instance: let go of the event loop's resources while it still exists
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        connect(app, &QCoreApplication::aboutToQuit, this, &Scheduler::unwatchClock);
+        app->installNativeEventFilter(this);
+    }
+
+#ifdef Q_OS_LINUX
+    // A realtime timerfd that can never expire but is cancelled, and
+    // becomes readable, whenever the clock is set or the system resumes
+    m_clockFd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_clockFd >= 0 && armClockFd()) {
+        m_clockNotifier = new QSocketNotifier(m_clockFd, QSocketNotifier::Read, this);
+        connect(m_clockNotifier, &QSocketNotifier::activated, this, [this]() {
+            quint64 expirations = 0;
+            if (::read(m_clockFd, &expirations, sizeof(expirations)) < 0 && errno == ECANCELED) {
+                armClockFd();
+                clockWasChanged();
+            }
+        });
+    } else if (m_clockFd >= 0) {
+        ::close(m_clockFd);
+        m_clockFd = -1;
+    }
+
+    // Time zone changes replace the link rather than touching the clock
+    if (QFileInfo::exists(QLatin1String(kZoneFile))) {
+        m_zoneWatcher = new QFileSystemWatcher(QStringList(QLatin1String(kZoneFile)), this);
+        connect(m_zoneWatcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path) {
+            if (!m_zoneWatcher->files().contains(path) && QFileInfo::exists(path)) {
+                m_zoneWatcher->addPath(path);
+            }
+            clockWasChanged();
+        });
+    }
+#endif
+}
+
+void Scheduler::unwatchClock()
+{
+    m_timer.stop();
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        app->removeNativeEventFilter(this);
+    }
+
+    delete m_clockNotifier;
+    m_clockNotifier = nullptr;
+    delete m_zoneWatcher;
+    m_zoneWatcher = nullptr;
+
+#ifdef Q_OS_LINUX
+    if (m_clockFd >= 0) {
+        ::close(m_clockFd);
+        m_clockFd = -1;
+    }
+#endif
+}
+
+bool Scheduler::armClockFd()
+{
+#ifdef Q_OS_LINUX
+    itimerspec spec = {};
+    spec.it_value.tv_sec = std::numeric_limits<time_t>::max() / 2;
+    return timerfd_settime(m_clockFd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr) == 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,114 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <QAbstractNativeEventFilter>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVariantMap>
+#include <functional>
+#include <vector>
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+
+// Runs callbacks at wall-clock deadlines with one timer for all of them.
+// Jobs sit in a binary min-heap by deadline and the single-shot timer is
+// armed for the top only, so any number of jobs costs one wakeup per due
+// deadline and none in between. Cancelling or moving a job leaves its
+// old heap entry behind; it is skipped when it surfaces and swept once
+// stale entries outnumber live ones.
+//
+// QTimer counts on the monotonic clock, which ignores clock changes and
+// may stop while the machine sleeps. When the wall clock is set, the
+// system resumes or the time zone changes, clockChanged() lets owners of
+// local-time deadlines recompute them and the timer is re-armed; jobs
+// already due run at once. Linux (timerfd) and Windows (WM_TIMECHANGE,
+// resume) report this as it happens; elsewhere a jump is noticed at the
+// next wakeup.
+class Scheduler : public QObject, public QAbstractNativeEventFilter
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void()>;
+
+    static Scheduler *instance();
+
+    // Returns a job ID, never 0. source is a string literal naming the
+    // job in WakeupMonitor; callbacks of a deleted context are dropped.
+    quint64 schedule(const QDateTime &deadline, QObject *context, const Callback &callback, const char *source);
+    bool reschedule(quint64 id, const QDateTime &deadline);
+    bool cancel(quint64 id);
+    bool isScheduled(quint64 id) const;
+    QDateTime deadline(quint64 id) const; // Invalid if not scheduled
+    int pendingCount() const;
+
+    // pending, heapEntries, wakeups, fired, clockChanges, nextDeadline
+    Q_INVOKABLE QVariantMap statistics() const;
+
+    bool nativeEventFilter(const QByteArray &eventType, void *message, long *result) override;
+
+public slots:
+    void clockWasChanged(); // Re-arm, and tell owners to recompute
+
+signals:
+    void clockChanged();
+
+private:
+    explicit Scheduler(QObject *parent = nullptr);
+    ~Scheduler();
+
+    struct Job {
+        qint64 due; // UTC milliseconds since the epoch
+        QPointer<QObject> context;
+        bool hasContext;
+        Callback callback;
+        const char *source;
+    };
+
+    struct Entry {
+        qint64 due;
+        quint64 id;
+
+        bool operator>(const Entry &other) const
+        {
+            return due != other.due ? due > other.due : id > other.id;
+        }
+    };
+
+    void push(quint64 id, qint64 due);
+    bool isStale(const Entry &entry) const;
+    void arm();
+    void runDue();
+    void sweep();
+    void watchClock();
+    void unwatchClock();
+    bool armClockFd();
+    bool clockJumped() const; // Since arm(), per the monotonic clock
+
+    QHash<quint64, Job> m_jobs;
+    std::vector<Entry> m_heap; // Min-heap on (due, id)
+    quint64 m_nextId;
+    QTimer m_timer;
+    qint64 m_armedDue; // Deadline the timer is running for
+
+    // Wall clock and UTC offset when last armed, to spot jumps at wakeup
+    QElapsedTimer m_armedClock;
+    qint64 m_armedWall;
+    int m_armedOffset;
+
+    quint64 m_wakeups;
+    quint64 m_fired;
+    quint64 m_clockChanges;
+    bool m_clockChangePending;
+
+    int m_clockFd;
+    QSocketNotifier *m_clockNotifier;
+    QFileSystemWatcher *m_zoneWatcher;
+};
+
+#endif // SCHEDULER_H
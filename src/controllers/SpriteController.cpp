@@ -1,29 +1,74 @@
 #include "SpriteController.h"
 #include <QDebug>
-#include <QEasingCurve>
+#include <algorithm>
+
+namespace {
+enum Transition {
+    Deny,  // Request is dropped
+    Allow, // Current state ends, requested one starts now
+    Queue  // Requested one-shot plays once the current state finishes
+};
+
+enum EndPolicy {
+    LoopForever,     // Ends only when another state takes over
+    LoopWhileMoving, // Cycles while the motion runs, otherwise plays once
+    PlayOnce
+};
+
+struct StateInfo {
+    const char *name;
+    int priority;                                   // Orders the pending queue
+    EndPolicy endPolicy;
+    SpriteController::AnimationState frames;        // Whose animation set to play
+    void (SpriteController::*finishedSignal)();     // Emitted when the state completes
+};
+
+const int kMaxPendingStates = 4;
+
+const StateInfo kStates[SpriteController::AnimationStateCount] = {
+    { "idle", 0, LoopForever,     SpriteController::IdleState, nullptr },
+    { "move", 2, LoopWhileMoving, SpriteController::MoveState, &SpriteController::moveAnimationFinished },
+    { "jump", 1, PlayOnce,        SpriteController::JumpState, &SpriteController::jumpAnimationFinished },
+    { "drag", 3, LoopForever,     SpriteController::IdleState, nullptr },
+};
+
+// kTransitions[from][to]
+const Transition kTransitions[SpriteController::AnimationStateCount][SpriteController::AnimationStateCount] = {
+    //            idle   move   jump   drag
+    /* idle */  { Allow, Allow, Allow, Allow },
+    /* move */  { Allow, Allow, Queue, Allow },
+    /* jump */  { Allow, Allow, Allow, Allow },
+    /* drag */  { Allow, Queue, Queue, Allow },
+};
+}
 
 SpriteController::SpriteController(QObject *parent)
     : QObject(parent)
     , m_targetPosition(960, 540) // Default to screen center
     , m_position(100, 100)
     , m_isAnimating(false)
+    , m_isPlaying(false)
+    , m_isSuspended(false)
+    , m_state(IdleState)
+    , m_clockAcquired(false)
+    , m_pendingAtlasFrames(IdleState)
+    , m_animationStart(0)
     , m_currentFrameIndex(0)
-    , m_frameDuration(500)
-    , m_frameTimer(new QTimer(this))
-    , m_positionAnimation(new QPropertyAnimation(this, "position", this))
+    , m_isMoving(false)
+    , m_hasQueuedMove(false)
+    , m_queuedMovePath(MotionEngine::Line)
+    , m_frameCache(new SpriteFrameCache)
 {
-    // Setup frame timer
-    m_frameTimer->setSingleShot(false);
-    connect(m_frameTimer, &QTimer::timeout, this, &SpriteController::onAnimationFrameChanged);
+    // Own clock until a shared one is attached
+    setAnimationClock(new AnimationClock(this));
 
-    // Setup position animation
-    m_positionAnimation->setDuration(2000); // 2 seconds for movement
-    m_positionAnimation->setEasingCurve(QEasingCurve::InOutQuad);
-    connect(m_positionAnimation, &QPropertyAnimation::finished, this, &SpriteController::onMoveAnimationFinished);
+    connect(m_frameCache.data(), &SpriteFrameCache::atlasReady,
+            this, &SpriteController::onAtlasReady);
 
     // Set default image path
     m_defaultImagePath = "qrc:/resources/images/default.gif";
     m_currentImagePath = m_defaultImagePath;
+    m_animations[IdleState] = SpriteAnimation::fromPaths(QStringList() << m_defaultImagePath);
 }
 
 SpriteController::~SpriteController()
@@ -46,6 +91,44 @@ bool SpriteController::isAnimating() const
     return m_isAnimating;
 }
 
+int SpriteController::currentFrameIndex() const
+{
+    return m_currentAtlas.isNull() ? -1 : m_currentFrameIndex;
+}
+
+SpriteFrameAtlas SpriteController::frameAtlas() const
+{
+    return m_currentAtlas;
+}
+
+bool SpriteController::isSuspended() const
+{
+    return m_isSuspended;
+}
+
+SpriteController::AnimationState SpriteController::state() const
+{
+    return m_state;
+}
+
+void SpriteController::setSuspended(bool suspended)
+{
+    if (m_isSuspended == suspended) {
+        return;
+    }
+
+    m_isSuspended = suspended;
+    emit suspendedChanged();
+
+    if (suspended) {
+        stopAllAnimations();
+        qDebug() << "Sprite suspended, all animations stopped";
+    } else {
+        startIdleAnimation();
+        qDebug() << "Sprite resumed";
+    }
+}
+
 void SpriteController::setPosition(const QPoint &position)
 {
     if (m_position != position) {
@@ -54,107 +137,338 @@ void SpriteController::setPosition(const QPoint &position)
     }
 }
 
+AnimationClock *SpriteController::animationClock() const
+{
+    return m_clock;
+}
+
+void SpriteController::setAnimationClock(AnimationClock *clock)
+{
+    if (m_clock == clock) {
+        return;
+    }
+
+    if (m_clock) {
+        if (m_clockAcquired) {
+            m_clock->release();
+            m_clockAcquired = false;
+        }
+        m_clock->cancelTick(this);
+        disconnect(m_clock, nullptr, this, nullptr);
+    }
+
+    // Keep animation progress continuous across the switch
+    const qint64 oldNow = m_clock ? m_clock->now() : 0;
+    m_clock = clock;
+
+    if (m_clock) {
+        const qint64 offset = m_clock->now() - oldNow;
+        m_animationStart += offset;
+        m_motion.shiftTime(offset);
+
+        connect(m_clock, &AnimationClock::tick, this, &SpriteController::onClockTick);
+        updateClockSubscription();
+    }
+}
+
+QSharedPointer<SpriteFrameCache> SpriteController::frameCache() const
+{
+    return m_frameCache;
+}
+
+void SpriteController::setFrameCache(const QSharedPointer<SpriteFrameCache> &cache)
+{
+    if (!cache || m_frameCache == cache) {
+        return;
+    }
+
+    disconnect(m_frameCache.data(), nullptr, this, nullptr);
+    m_frameCache = cache;
+    connect(m_frameCache.data(), &SpriteFrameCache::atlasReady,
+            this, &SpriteController::onAtlasReady);
+
+    for (SpriteFrameAtlas &atlas : m_atlases) {
+        atlas = SpriteFrameAtlas();
+    }
+    m_pendingAtlasKey.clear();
+}
+
+QVariantMap SpriteController::frameCacheStats() const
+{
+    const SpriteFrameCache::Stats stats = m_frameCache->stats();
+
+    QVariantMap map;
+    map["hits"] = stats.hits;
+    map["misses"] = stats.misses;
+    map["evictions"] = stats.evictions;
+    map["bytes"] = stats.bytes;
+    map["byteBudget"] = stats.byteBudget;
+    map["frameCount"] = stats.frameCount;
+    map["atlasCount"] = stats.atlasCount;
+    map["sheetCount"] = stats.sheetCount;
+    map["atlasReadyHits"] = stats.atlasReadyHits;
+    map["atlasNeededBeforeReady"] = stats.atlasNeededBeforeReady;
+    map["asyncDecodes"] = stats.asyncDecodes;
+    map["maxAtlasWaitMs"] = stats.maxAtlasWaitMs;
+    return map;
+}
+
 void SpriteController::startIdleAnimation()
 {
     stopAllAnimations();
-    
-    m_currentImagePath = m_defaultImagePath;
-    emit currentImagePathChanged();
-    
-    qDebug() << "Started idle animation with image:" << m_currentImagePath;
+    requestState(IdleState);
 }
 
 void SpriteController::startMoveAnimation()
 {
-    if (m_moveAnimationPaths.isEmpty()) {
+    if (m_animations[MoveState].isEmpty()) {
         qWarning() << "No move animation paths configured";
         return;
     }
 
-    stopAllAnimations();
-    startFrameAnimation(m_moveAnimationPaths, 1000); // 1 second total duration
-    
-    qDebug() << "Started move animation with" << m_moveAnimationPaths.size() << "frames";
+    requestState(MoveState);
 }
 
 void SpriteController::startJumpAnimation()
 {
-    if (m_jumpAnimationPaths.isEmpty()) {
+    if (m_animations[JumpState].isEmpty()) {
         qWarning() << "No jump animation paths configured";
         return;
     }
 
-    stopAllAnimations();
-    startFrameAnimation(m_jumpAnimationPaths, 1000); // 1 second total duration
-    
-    qDebug() << "Started jump animation with" << m_jumpAnimationPaths.size() << "frames";
+    requestState(JumpState);
 }
 
-void SpriteController::moveToTarget()
+void SpriteController::prefetchState(AnimationState state)
 {
-    if (m_position == m_targetPosition) {
-        qDebug() << "Already at target position";
+    AnimationState frames = kStates[state].frames;
+    if (m_animations[frames].isEmpty()) {
+        frames = IdleState;
+    }
+
+    if (m_atlases[frames].isNull()) {
+        m_frameCache->prefetchAtlas(m_animations[frames].frames);
+    }
+}
+
+void SpriteController::beginDrag()
+{
+    requestState(DragState);
+}
+
+void SpriteController::endDrag()
+{
+    if (m_state == DragState && m_isPlaying) {
+        finishState();
+    }
+}
+
+bool SpriteController::requestState(AnimationState state)
+{
+    if (m_isSuspended) {
+        return false;
+    }
+
+    // A stopped sprite is idle whatever state it stopped in
+    const AnimationState from = m_isPlaying ? m_state : IdleState;
+    switch (kTransitions[from][state]) {
+    case Deny:
+        qDebug() << "Ignoring" << kStates[state].name << "while" << kStates[from].name;
+        return false;
+    case Queue:
+        enqueueState(state);
+        return false;
+    case Allow:
+        break;
+    }
+
+    enterState(state);
+    return true;
+}
+
+void SpriteController::enterState(AnimationState state)
+{
+    const AnimationState previous = m_state;
+
+    // Only the move state owns the motion
+    if (state != MoveState && m_isMoving) {
+        m_isMoving = false;
+        m_motion.stop();
+    }
+
+    m_state = state;
+    m_isPlaying = true;
+
+    // A held sprite is not animating: the jump effect stays off while dragging
+    setAnimating(state != IdleState && state != DragState);
+
+    // States without frames of their own play the idle frames
+    AnimationState frames = kStates[state].frames;
+    if (m_animations[frames].isEmpty()) {
+        frames = IdleState;
+    }
+    if (m_animations[frames].isEmpty()) {
+        m_pendingAtlasKey.clear();
+        m_currentAnimation = SpriteAnimation();
+        m_frameEnds.clear();
+        m_frameOrder.clear();
+        m_currentAtlas = SpriteFrameAtlas();
+        emit frameAtlasChanged();
+        m_currentImagePath = m_defaultImagePath;
+        emit currentImagePathChanged();
+    } else {
+        startFrameAnimation(frames);
+    }
+    updateClockSubscription();
+
+    if (previous != state) {
+        emit stateChanged(previous, state);
+    }
+
+    qDebug() << "Entered" << kStates[state].name << "state with image:" << m_currentImagePath;
+}
+
+void SpriteController::finishState()
+{
+    const AnimationState finished = m_state;
+
+    m_isPlaying = false;
+    setAnimating(false);
+    emit animationFinished();
+    if (kStates[finished].finishedSignal) {
+        emit (this->*kStates[finished].finishedSignal)();
+    }
+    emit stateFinished(finished);
+
+    // Next queued one-shot, otherwise back to idle
+    const AnimationState next = m_pendingStates.isEmpty() ? IdleState : m_pendingStates.takeFirst();
+    enterState(next);
+
+    // A move requested during a drag starts from wherever the sprite was left
+    if (next == MoveState && m_hasQueuedMove) {
+        m_hasQueuedMove = false;
+        startMotion(m_queuedMoveTarget, m_queuedMovePath);
+    }
+}
+
+void SpriteController::enqueueState(AnimationState state)
+{
+    if (m_pendingStates.contains(state) || m_pendingStates.size() >= kMaxPendingStates) {
         return;
     }
 
-    // Start move animation first
-    startMoveAnimation();
-    
-    // Start position animation
-    m_positionAnimation->setStartValue(m_position);
-    m_positionAnimation->setEndValue(m_targetPosition);
-    m_positionAnimation->start();
-    
-    qDebug() << "Moving from" << m_position << "to" << m_targetPosition;
+    // Stable insert: higher priority first, equal priorities in request order
+    int index = 0;
+    while (index < m_pendingStates.size()
+           && kStates[m_pendingStates[index]].priority >= kStates[state].priority) {
+        ++index;
+    }
+    m_pendingStates.insert(index, state);
+
+    qDebug() << "Queued" << kStates[state].name << "behind" << kStates[m_state].name;
+}
+
+void SpriteController::setAnimating(bool animating)
+{
+    if (m_isAnimating != animating) {
+        m_isAnimating = animating;
+        emit isAnimatingChanged();
+    }
+}
+
+void SpriteController::moveToTarget()
+{
+    moveToPosition(m_targetPosition);
 }
 
 void SpriteController::moveToPosition(const QPoint &position)
 {
+    moveAlongPath(position, MotionEngine::Line);
+}
+
+void SpriteController::moveAlongPath(const QPoint &position, int pathType)
+{
+    if (m_isSuspended) {
+        qDebug() << "Sprite suspended, ignoring move to" << position;
+        return;
+    }
+
     if (m_position == position) {
         qDebug() << "Already at target position";
         return;
     }
 
     // Start move animation first
-    startMoveAnimation();
-    
-    // Start position animation
-    m_positionAnimation->setStartValue(m_position);
-    m_positionAnimation->setEndValue(position);
-    m_positionAnimation->start();
+    if (!requestState(MoveState)) {
+        // Queued behind the current state; the motion starts when it is dequeued
+        if (m_pendingStates.contains(MoveState)) {
+            m_hasQueuedMove = true;
+            m_queuedMoveTarget = position;
+            m_queuedMovePath = pathType;
+        }
+        return;
+    }
+
+    startMotion(position, pathType);
+}
+
+void SpriteController::startMotion(const QPoint &position, int pathType)
+{
+    if (m_position == position) {
+        finishState();
+        return;
+    }
+
+    // Start position animation on the same clock as the frames
+    m_motion.start(m_position, position, MotionEngine::PathType(pathType), m_clock->now());
+    m_isMoving = true;
+    updateClockSubscription();
     
-    qDebug() << "Moving from" << m_position << "to" << position;
+    qDebug() << "Moving from" << m_position << "to" << position
+             << "over about" << m_motion.estimatedDuration() << "ms";
 }
 
 void SpriteController::stopAllAnimations()
 {
-    m_frameTimer->stop();
-    m_positionAnimation->stop();
-    
-    if (m_isAnimating) {
-        m_isAnimating = false;
-        emit isAnimatingChanged();
+    m_isMoving = false;
+    m_motion.stop();
+    m_isPlaying = false;
+    m_pendingStates.clear();
+    m_hasQueuedMove = false;
+    setAnimating(false);
+
+    const AnimationState previous = m_state;
+    m_state = IdleState;
+    if (previous != IdleState) {
+        emit stateChanged(previous, IdleState);
     }
+
+    updateClockSubscription();
 }
 
 void SpriteController::setDefaultImagePath(const QString &path)
 {
     m_defaultImagePath = path;
+    m_animations[IdleState] = SpriteAnimation::fromPaths(QStringList() << path);
+    m_atlases[IdleState] = SpriteFrameAtlas();
     if (!m_isAnimating) {
-        m_currentImagePath = m_defaultImagePath;
-        emit currentImagePathChanged();
+        startIdleAnimation();
     }
 }
 
 void SpriteController::setMoveAnimationPaths(const QStringList &paths)
 {
     m_moveAnimationPaths = paths;
+    m_animations[MoveState] = SpriteAnimation::fromPaths(paths);
+    m_atlases[MoveState] = SpriteFrameAtlas();
     qDebug() << "Set move animation paths:" << paths;
 }
 
 void SpriteController::setJumpAnimationPaths(const QStringList &paths)
 {
     m_jumpAnimationPaths = paths;
+    m_animations[JumpState] = SpriteAnimation::fromPaths(paths);
+    m_atlases[JumpState] = SpriteFrameAtlas();
     qDebug() << "Set jump animation paths:" << paths;
 }
 
@@ -164,70 +478,186 @@ void SpriteController::setTargetPosition(const QPoint &target)
     qDebug() << "Set target position to:" << target;
 }
 
-void SpriteController::onAnimationFrameChanged()
+void SpriteController::onClockTick(qint64 now)
 {
-    updateCurrentFrame();
+    // Movement first: finishing a move may end the frame animation too
+    if (m_isMoving) {
+        updateMovement(now);
+    }
+    if (m_isPlaying) {
+        updateCurrentFrame(now);
+    }
+    updateClockSubscription();
 }
 
-void SpriteController::onMoveAnimationFinished()
+void SpriteController::updateCurrentFrame(qint64 now)
 {
-    qDebug() << "Move animation finished";
-    emit moveAnimationFinished();
-    startIdleAnimation(); // Return to idle state
+    if (m_currentAnimation.isEmpty() || m_frameEnds.isEmpty()) {
+        return;
+    }
+
+    const qint64 cycleDuration = m_frameEnds.last();
+    qint64 elapsed = now - m_animationStart;
+
+    // The state's end policy decides whether a full cycle ends it
+    if (elapsed >= cycleDuration) {
+        const EndPolicy policy = kStates[m_state].endPolicy;
+        if (policy == PlayOnce || (policy == LoopWhileMoving && !m_isMoving)) {
+            finishState();
+            return;
+        }
+        elapsed %= cycleDuration;
+    }
+
+    // Pick the frame from wall time so a late tick skips frames instead
+    // of stretching the animation
+    const int step = int(std::upper_bound(m_frameEnds.cbegin(), m_frameEnds.cend(), elapsed)
+                         - m_frameEnds.cbegin());
+    const int frameIndex = m_frameOrder[qMin(step, m_frameOrder.size() - 1)];
+
+    // Keep the last shown frame until the new atlas has been decoded
+    if (!m_pendingAtlasKey.isEmpty()) {
+        return;
+    }
+
+    if (frameIndex != m_currentFrameIndex) {
+        m_currentFrameIndex = frameIndex;
+        m_currentImagePath = m_currentAnimation.frames[m_currentFrameIndex];
+        emit currentFrameIndexChanged();
+        emit currentImagePathChanged();
+    }
 }
 
-void SpriteController::onJumpAnimationFinished()
+void SpriteController::updateMovement(qint64 now)
 {
-    qDebug() << "Jump animation finished";
-    emit jumpAnimationFinished();
-    startIdleAnimation(); // Return to idle state
+    const bool stillMoving = m_motion.advance(now);
+
+    // One position update per displayed frame
+    setPosition(m_motion.position().toPoint());
+
+    if (!stillMoving) {
+        m_isMoving = false;
+        if (m_state == MoveState) {
+            finishState();
+        }
+    }
 }
 
-void SpriteController::updateCurrentFrame()
+void SpriteController::startFrameAnimation(AnimationState frames)
 {
-    if (m_currentFrames.isEmpty()) {
+    const SpriteAnimation &animation = m_animations[frames];
+    if (animation.isEmpty()) {
         return;
     }
 
-    m_currentImagePath = m_currentFrames[m_currentFrameIndex];
-    emit currentImagePathChanged();
+    m_currentAnimation = animation;
+
+    // Flatten the cycle into a timeline; ping-pong plays back down to frame 1
+    m_frameEnds.clear();
+    m_frameOrder.clear();
+    qint64 end = 0;
+    const int frameCount = animation.frames.size();
+    for (int i = 0; i < frameCount; ++i) {
+        end += animation.durations[i];
+        m_frameEnds.append(end);
+        m_frameOrder.append(i);
+    }
+    if (animation.loopMode == SpriteSheet::PingPong) {
+        for (int i = frameCount - 2; i > 0; --i) {
+            end += animation.durations[i];
+            m_frameEnds.append(end);
+            m_frameOrder.append(i);
+        }
+    }
 
-    m_currentFrameIndex = (m_currentFrameIndex + 1) % m_currentFrames.size();
+    m_animationStart = m_clock->now();
 
-    // If we've completed one full cycle, stop the animation
-    if (m_currentFrameIndex == 0) {
-        m_frameTimer->stop();
-        m_isAnimating = false;
-        emit isAnimatingChanged();
-        emit animationFinished();
-        
-        // Determine which animation finished
-        if (m_currentFrames == m_moveAnimationPaths) {
-            onMoveAnimationFinished();
-        } else if (m_currentFrames == m_jumpAnimationPaths) {
-            onJumpAnimationFinished();
-        }
+    // The whole cycle lives in one atlas, so no frame switch pays decode
+    // or texture upload cost. A cold atlas decodes on the cache's workers;
+    // the timeline runs meanwhile and the previous frame stays up.
+    if (m_atlases[frames].isNull()) {
+        m_atlases[frames] = m_frameCache->readyAtlas(animation.frames);
+    }
+    if (m_atlases[frames].isNull()) {
+        m_pendingAtlasKey = m_frameCache->atlasKey(animation.frames);
+        m_pendingAtlasFrames = frames;
+        return;
     }
+
+    m_pendingAtlasKey.clear();
+    showAtlas(m_atlases[frames]);
+}
+
+void SpriteController::showAtlas(const SpriteFrameAtlas &atlas)
+{
+    m_currentAtlas = atlas;
+    m_currentFrameIndex = 0;
+    emit frameAtlasChanged();
+
+    // Start with first frame
+    m_currentImagePath = m_currentAnimation.frames[0];
+    emit currentFrameIndexChanged();
+    emit currentImagePathChanged();
 }
 
-void SpriteController::startFrameAnimation(const QStringList &framePaths, int duration)
+void SpriteController::onAtlasReady(const QString &key)
 {
-    if (framePaths.isEmpty()) {
+    if (key != m_pendingAtlasKey) {
         return;
     }
 
-    m_currentFrames = framePaths;
-    m_currentFrameIndex = 0;
-    m_frameDuration = duration / framePaths.size(); // Divide total duration by frame count
+    const SpriteFrameAtlas atlas = m_frameCache->cachedAtlas(key);
+    if (atlas.isNull()) {
+        // Evicted again before it got here; decode it once more
+        m_frameCache->readyAtlas(m_animations[m_pendingAtlasFrames].frames);
+        return;
+    }
+    m_pendingAtlasKey.clear();
+    m_atlases[m_pendingAtlasFrames] = atlas;
+    showAtlas(atlas);
 
-    m_isAnimating = true;
-    emit isAnimatingChanged();
+    // Catch up with the timeline, which kept running during the decode
+    if (m_isPlaying) {
+        updateCurrentFrame(m_clock->now());
+    }
+}
 
-    // Start with first frame
-    m_currentImagePath = m_currentFrames[0];
-    emit currentImagePathChanged();
+qint64 SpriteController::nextFrameBoundary(qint64 now) const
+{
+    if (m_frameEnds.isEmpty()) {
+        return now;
+    }
+
+    // End of the timeline step now falls in; the end of the cycle for the last
+    const qint64 cycleDuration = m_frameEnds.last();
+    const qint64 elapsed = qMax<qint64>(0, now - m_animationStart);
+    const qint64 cycleStart = now - elapsed % cycleDuration;
+    const auto end = std::upper_bound(m_frameEnds.cbegin(), m_frameEnds.cend(), elapsed % cycleDuration);
+    return cycleStart + (end == m_frameEnds.cend() ? cycleDuration : *end);
+}
+
+void SpriteController::updateClockSubscription()
+{
+    if (!m_clock) {
+        return;
+    }
+
+    // Only movement renders at vsync. A frame loop wakes once per frame
+    // boundary, and a single looping frame needs no ticks at all.
+    const bool frameTicks = !m_isMoving && m_isPlaying && !m_frameEnds.isEmpty()
+                            && (m_currentAnimation.frames.size() > 1
+                                || kStates[m_state].endPolicy != LoopForever);
+    if (m_isMoving && !m_clockAcquired) {
+        m_clock->acquire();
+        m_clockAcquired = true;
+    } else if (!m_isMoving && m_clockAcquired) {
+        m_clock->release();
+        m_clockAcquired = false;
+    }
 
-    // Start frame timer
-    m_frameTimer->setInterval(m_frameDuration);
-    m_frameTimer->start();
-}
\ No newline at end of file
+    if (frameTicks) {
+        m_clock->requestTick(this, nextFrameBoundary(m_clock->now()));
+    } else {
+        m_clock->cancelTick(this);
+    }
+}
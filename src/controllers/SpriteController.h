@@ -3,10 +3,15 @@
 
 #include <QObject>
 #include <QPoint>
-#include <QTimer>
 #include <QStringList>
-#include <QPropertyAnimation>
-#include <QSequentialAnimationGroup>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QVariantMap>
+#include <QVector>
+#include "AnimationClock.h"
+#include "MotionEngine.h"
+#include "SpriteFrameCache.h"
+#include "SpriteSheet.h"
 
 class SpriteController : public QObject
 {
@@ -14,8 +19,23 @@ class SpriteController : public QObject
     Q_PROPERTY(QString currentImagePath READ currentImagePath NOTIFY currentImagePathChanged)
     Q_PROPERTY(QPoint position READ position WRITE setPosition NOTIFY positionChanged)
     Q_PROPERTY(bool isAnimating READ isAnimating NOTIFY isAnimatingChanged)
+    Q_PROPERTY(int currentFrameIndex READ currentFrameIndex NOTIFY currentFrameIndexChanged)
+    Q_PROPERTY(bool suspended READ isSuspended WRITE setSuspended NOTIFY suspendedChanged)
+    Q_PROPERTY(AnimationState state READ state NOTIFY stateChanged)
 
 public:
+    // Behaviours are numbered states; what may follow what, and which
+    // requests wait their turn, comes from the transition table in the
+    // source file. A new behaviour is a new entry here plus a table row.
+    enum AnimationState {
+        IdleState,
+        MoveState,
+        JumpState,
+        DragState
+    };
+    Q_ENUM(AnimationState)
+    static const int AnimationStateCount = DragState + 1;
+
     explicit SpriteController(QObject *parent = nullptr);
     ~SpriteController();
 
@@ -23,10 +43,28 @@ public:
     QString currentImagePath() const;
     QPoint position() const;
     bool isAnimating() const;
+    int currentFrameIndex() const;
+    bool isSuspended() const;
+    AnimationState state() const;
+
+    // All frames of the current animation in one image, for SpriteItem
+    SpriteFrameAtlas frameAtlas() const;
 
     // Property setters
     void setPosition(const QPoint &position);
 
+    // Hidden power state: stops every animation and releases the clock
+    void setSuspended(bool suspended);
+
+    // Time base shared by frame animation and movement
+    AnimationClock *animationClock() const;
+    void setAnimationClock(AnimationClock *clock);
+
+    // Decoded frame cache shared with the QML image provider
+    QSharedPointer<SpriteFrameCache> frameCache() const;
+    void setFrameCache(const QSharedPointer<SpriteFrameCache> &cache);
+    Q_INVOKABLE QVariantMap frameCacheStats() const;
+
 public slots:
     // Animation control
     void startIdleAnimation();
@@ -34,9 +72,21 @@ public slots:
     void startJumpAnimation();
     void moveToTarget();
     void stopAllAnimations();
+
+    // Enter a state through the transition table; a lower priority
+    // one-shot requested during a busy state is queued behind it
+    bool requestState(AnimationState state);
+
+    // Held by the user: interrupts jumps and moves until released
+    void beginDrag();
+    void endDrag();
+
+    // Decode a state's atlas in the background ahead of its first play
+    void prefetchState(AnimationState state);
     
-    // Movement
+    // Movement, duration follows distance and motion speed
     void moveToPosition(const QPoint &position);
+    void moveAlongPath(const QPoint &position, int pathType); // MotionEngine::PathType
 
     // Configuration
     void setDefaultImagePath(const QString &path);
@@ -52,35 +102,69 @@ signals:
     void currentImagePathChanged();
     void positionChanged();
     void isAnimatingChanged();
+    void currentFrameIndexChanged();
+    void frameAtlasChanged();
+    void suspendedChanged();
     void animationFinished();
     void moveAnimationFinished();
     void jumpAnimationFinished();
+    void stateChanged(SpriteController::AnimationState from, SpriteController::AnimationState to);
+    void stateFinished(SpriteController::AnimationState state);
 
 private slots:
-    void onAnimationFrameChanged();
-    void onMoveAnimationFinished();
-    void onJumpAnimationFinished();
+    void onClockTick(qint64 now);
+    void onAtlasReady(const QString &key);
 
 private:
-    void updateCurrentFrame();
-    void startFrameAnimation(const QStringList &framePaths, int duration);
+    void enterState(AnimationState state);
+    void finishState();
+    void enqueueState(AnimationState state);
+    void startMotion(const QPoint &position, int pathType);
+    void setAnimating(bool animating);
+    void updateCurrentFrame(qint64 now);
+    void updateMovement(qint64 now);
+    void startFrameAnimation(AnimationState frames);
+    void showAtlas(const SpriteFrameAtlas &atlas);
+    void updateClockSubscription();
+    qint64 nextFrameBoundary(qint64 now) const; // When the shown frame next changes
 
     QString m_defaultImagePath;
     QStringList m_moveAnimationPaths;
     QStringList m_jumpAnimationPaths;
+    SpriteAnimation m_animations[AnimationStateCount]; // Idle is the default image, or its frames if animated
+    SpriteFrameAtlas m_atlases[AnimationStateCount];   // Built on first play
     QPoint m_targetPosition;
     QPoint m_position;
     QString m_currentImagePath;
     bool m_isAnimating;
+    bool m_isPlaying; // Frame timeline running, idle included
+    bool m_isSuspended;
 
-    // Animation management
-    QTimer *m_frameTimer;
-    QStringList m_currentFrames;
+    // State machine
+    AnimationState m_state;
+    QList<AnimationState> m_pendingStates; // Queued one-shots, highest priority first
+
+    // Animation management, frames are picked from elapsed clock time
+    QPointer<AnimationClock> m_clock;
+    bool m_clockAcquired;
+    SpriteAnimation m_currentAnimation;
+    SpriteFrameAtlas m_currentAtlas;
+    QVector<qint64> m_frameEnds;  // Cumulative end time of each timeline step
+    QVector<int> m_frameOrder;    // Frame shown at each step (ping-pong plays back)
+    QString m_pendingAtlasKey;    // Atlas still decoding for the current animation
+    AnimationState m_pendingAtlasFrames;
+    qint64 m_animationStart;
     int m_currentFrameIndex;
-    int m_frameDuration;
 
-    // Position animation
-    QPropertyAnimation *m_positionAnimation;
+    // Position animation, integrated once per clock tick
+    bool m_isMoving;
+    MotionEngine m_motion;
+    bool m_hasQueuedMove; // moveAlongPath() waiting behind a drag
+    QPoint m_queuedMoveTarget;
+    int m_queuedMovePath;
+
+    // Decoded frames for the current animation set
+    QSharedPointer<SpriteFrameCache> m_frameCache;
 };
 
 #endif // SPRITECONTROLLER_H
\ No newline at end of file
@@ -0,0 +1,613 @@
+#include "SpriteFrameCache.h"
+#include "SpriteSheet.h"
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QRunnable>
+#include <QThread>
+#include <QUrl>
+#include <QDebug>
+#include <QtMath>
+#include <cmath>
+#include <vector>
+
+namespace {
+// Matches the DropShadow the sprite window used to apply live
+const int kShadowRadius = 8;
+const QColor kShadowColor(0, 0, 0, 0x40);
+const QPoint kShadowOffset(2, 2);
+
+const int kMaxDecodeThreads = 4;
+
+// Three box blurs approximate a gaussian (same deviation QtGraphicalEffects
+// derives from a radius: (radius + 1) / 3.3333)
+void boxBlurPass(std::vector<uchar> &data, std::vector<uchar> &scratch,
+                 int width, int height, int radius, bool horizontal)
+{
+    const int lines = horizontal ? height : width;
+    const int length = horizontal ? width : height;
+    const int step = horizontal ? 1 : width;
+    const int window = 2 * radius + 1;
+
+    for (int line = 0; line < lines; ++line) {
+        const int start = horizontal ? line * width : line;
+        int sum = 0;
+
+        // Pixels outside the frame count as transparent
+        for (int i = 0; i <= radius && i < length; ++i) {
+            sum += data[start + i * step];
+        }
+
+        for (int i = 0; i < length; ++i) {
+            scratch[start + i * step] = uchar(sum / window);
+
+            const int incoming = i + radius + 1;
+            const int outgoing = i - radius;
+            if (incoming < length) {
+                sum += data[start + incoming * step];
+            }
+            if (outgoing >= 0) {
+                sum -= data[start + outgoing * step];
+            }
+        }
+    }
+
+    data.swap(scratch);
+}
+
+void gaussianBlurAlpha(std::vector<uchar> &alpha, int width, int height, qreal sigma)
+{
+    const int passes = 3;
+    const qreal idealWidth = std::sqrt(12.0 * sigma * sigma / passes + 1.0);
+    int lowerWidth = int(std::floor(idealWidth));
+    if (lowerWidth % 2 == 0) {
+        --lowerWidth;
+    }
+    const int upperWidth = lowerWidth + 2;
+    const qreal idealLowerPasses = (12.0 * sigma * sigma - passes * lowerWidth * lowerWidth
+                                    - 4.0 * passes * lowerWidth - 3.0 * passes)
+                                   / (-4.0 * lowerWidth - 4.0);
+    const int lowerPasses = qRound(idealLowerPasses);
+
+    std::vector<uchar> scratch(alpha.size());
+    for (int pass = 0; pass < passes; ++pass) {
+        const int radius = ((pass < lowerPasses ? lowerWidth : upperWidth) - 1) / 2;
+        if (radius <= 0) {
+            continue;
+        }
+        boxBlurPass(alpha, scratch, width, height, radius, true);
+        boxBlurPass(alpha, scratch, width, height, radius, false);
+    }
+}
+}
+
+SpriteFrameCache::SpriteFrameCache(qint64 byteBudget)
+    : m_byteBudget(byteBudget)
+    , m_bytes(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_evictions(0)
+    , m_atlasReadyHits(0)
+    , m_atlasNeededBeforeReady(0)
+    , m_asyncDecodes(0)
+    , m_maxAtlasWaitMs(0)
+{
+    m_settings.frameSize = QSize(120, 120);
+    m_settings.devicePixelRatio = 1.0;
+    m_settings.shadowEnabled = true;
+    m_waitTimer.start();
+
+    // Leave a core for the GUI and render threads
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, kMaxDecodeThreads));
+}
+
+SpriteFrameCache::~SpriteFrameCache()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+QSize SpriteFrameCache::frameSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_settings.frameSize;
+}
+
+void SpriteFrameCache::setFrameSize(const QSize &size)
+{
+    QMutexLocker locker(&m_mutex);
+    m_settings.frameSize = size;
+}
+
+qreal SpriteFrameCache::devicePixelRatio() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_settings.devicePixelRatio;
+}
+
+void SpriteFrameCache::setDevicePixelRatio(qreal ratio)
+{
+    QMutexLocker locker(&m_mutex);
+    m_settings.devicePixelRatio = qMax<qreal>(1.0, ratio);
+}
+
+void SpriteFrameCache::setByteBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_byteBudget = bytes;
+    evictToBudget();
+}
+
+bool SpriteFrameCache::shadowEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_settings.shadowEnabled;
+}
+
+void SpriteFrameCache::setShadowEnabled(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    m_settings.shadowEnabled = enabled;
+}
+
+QImage SpriteFrameCache::frame(const QString &source, const Settings &settings)
+{
+    if (source.isEmpty()) {
+        return QImage();
+    }
+
+    const QString key = cacheKey(source, settings);
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            ++m_hits;
+            m_lru.splice(m_lru.begin(), m_lru, it->lruPosition);
+            return it->image;
+        }
+        ++m_misses;
+    }
+
+    // Decode unlocked; two threads racing on one frame both decode, one inserts
+    const QImage image = decode(source, settings);
+
+    QMutexLocker locker(&m_mutex);
+    if (!image.isNull() && !m_entries.contains(key)) {
+        insert(key, image);
+    }
+    return image;
+}
+
+QString SpriteFrameCache::atlasKey(const QStringList &sources) const
+{
+    QMutexLocker locker(&m_mutex);
+    return atlasKey(sources, m_settings);
+}
+
+QString SpriteFrameCache::atlasKey(const QStringList &sources, const Settings &settings)
+{
+    // Prefixed so a one-frame atlas never collides with its frame
+    return QLatin1String("atlas:") + cacheKey(sources.join(QLatin1Char('\n')), settings);
+}
+
+SpriteFrameAtlas SpriteFrameCache::cachedAtlas(const QString &key) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(key);
+    if (it == m_entries.constEnd()) {
+        return SpriteFrameAtlas();
+    }
+
+    SpriteFrameAtlas atlas;
+    atlas.image = it->image;
+    atlas.rects = it->rects;
+    return atlas;
+}
+
+SpriteFrameAtlas SpriteFrameCache::lookupAtlas(const QString &key)
+{
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return SpriteFrameAtlas();
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, it->lruPosition);
+    SpriteFrameAtlas atlas;
+    atlas.image = it->image;
+    atlas.rects = it->rects;
+    return atlas;
+}
+
+SpriteFrameAtlas SpriteFrameCache::readyAtlas(const QStringList &sources)
+{
+    if (sources.isEmpty()) {
+        return SpriteFrameAtlas();
+    }
+
+    QString key;
+    Settings settings;
+    {
+        QMutexLocker locker(&m_mutex);
+        settings = m_settings;
+        key = atlasKey(sources, settings);
+        const SpriteFrameAtlas cached = lookupAtlas(key);
+        if (!cached.isNull()) {
+            ++m_atlasReadyHits;
+            return cached;
+        }
+        ++m_atlasNeededBeforeReady;
+    }
+
+    queueAtlas(key, sources, settings, true);
+    return SpriteFrameAtlas();
+}
+
+void SpriteFrameCache::prefetchAtlas(const QStringList &sources)
+{
+    if (sources.isEmpty()) {
+        return;
+    }
+
+    QString key;
+    Settings settings;
+    {
+        QMutexLocker locker(&m_mutex);
+        settings = m_settings;
+        key = atlasKey(sources, settings);
+        if (m_entries.contains(key)) {
+            return;
+        }
+    }
+
+    queueAtlas(key, sources, settings, false);
+}
+
+// key is atlasKey(sources, settings), captured together under the lock
+void SpriteFrameCache::queueAtlas(const QString &key, const QStringList &sources, const Settings &settings, bool needed)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_pendingAtlases.find(key);
+        if (it != m_pendingAtlases.end()) {
+            // Already decoding; a prefetch that becomes needed starts its wait now
+            if (needed && it.value() < 0) {
+                it.value() = m_waitTimer.elapsed();
+            }
+            return;
+        }
+        m_pendingAtlases.insert(key, needed ? m_waitTimer.elapsed() : -1);
+        ++m_asyncDecodes;
+    }
+
+    m_pool.start(QRunnable::create([this, key, sources, settings]() {
+        const SpriteFrameAtlas result = buildAtlas(sources, settings);
+
+        {
+            QMutexLocker locker(&m_mutex);
+            // Settings may have changed meanwhile; the key still names what was built
+            insertAtlas(key, result);
+            const qint64 neededAt = m_pendingAtlases.take(key);
+            if (neededAt >= 0) {
+                m_maxAtlasWaitMs = qMax(m_maxAtlasWaitMs, m_waitTimer.elapsed() - neededAt);
+            }
+        }
+
+        emit atlasReady(key);
+    }));
+}
+
+SpriteFrameAtlas SpriteFrameCache::buildAtlas(const QStringList &sources, const Settings &settings)
+{
+    SpriteFrameAtlas result;
+
+    QVector<QImage> frames;
+    frames.reserve(sources.size());
+    for (const QString &source : sources) {
+        frames.append(frame(source, settings));
+    }
+
+    const QSize pixelSize = settings.pixelSize();
+
+    // Near-square grid keeps long animations inside texture size limits
+    const int columns = qCeil(qSqrt(qreal(frames.size())));
+    const int rows = (frames.size() + columns - 1) / columns;
+
+    result.image = QImage(pixelSize.width() * columns, pixelSize.height() * rows,
+                          QImage::Format_ARGB32_Premultiplied);
+    result.image.fill(Qt::transparent);
+
+    QPainter painter(&result.image);
+    for (int i = 0; i < frames.size(); ++i) {
+        const QRect rect(QPoint((i % columns) * pixelSize.width(), (i / columns) * pixelSize.height()),
+                         pixelSize);
+        if (!frames[i].isNull()) {
+            // Explicit source rect: frames carry a device pixel ratio, the atlas does not
+            painter.drawImage(rect, frames[i], frames[i].rect());
+        }
+        result.rects.append(rect);
+    }
+    painter.end();
+
+    return result;
+}
+
+void SpriteFrameCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+SpriteFrameCache::Stats SpriteFrameCache::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    Stats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.evictions = m_evictions;
+    stats.bytes = m_bytes;
+    stats.byteBudget = m_byteBudget;
+    for (const Entry &entry : m_entries) {
+        if (entry.sheet) {
+            ++stats.sheetCount;
+        } else if (!entry.rects.isEmpty()) {
+            ++stats.atlasCount;
+        } else {
+            ++stats.frameCount;
+        }
+    }
+    stats.atlasReadyHits = m_atlasReadyHits;
+    stats.atlasNeededBeforeReady = m_atlasNeededBeforeReady;
+    stats.asyncDecodes = m_asyncDecodes;
+    stats.maxAtlasWaitMs = m_maxAtlasWaitMs;
+    return stats;
+}
+
+QString SpriteFrameCache::localPath(const QString &source)
+{
+    if (source.startsWith(QLatin1String("qrc:"))) {
+        return QLatin1Char(':') + QUrl(source).path();
+    }
+    if (source.startsWith(QLatin1String("file:"))) {
+        return QUrl(source).toLocalFile();
+    }
+    return source;
+}
+
+QString SpriteFrameCache::cacheKey(const QString &source, const Settings &settings)
+{
+    return QStringLiteral("%1@%2x%3@%4%5")
+        .arg(source)
+        .arg(settings.frameSize.width())
+        .arg(settings.frameSize.height())
+        .arg(settings.devicePixelRatio)
+        .arg(settings.shadowEnabled ? QStringLiteral("+shadow") : QString());
+}
+
+QString SpriteFrameCache::sheetKey(const QString &sheetSource)
+{
+    return QLatin1String("sheet:") + sheetSource;
+}
+
+QImage SpriteFrameCache::decode(const QString &source, const Settings &settings)
+{
+    QString baseSource;
+    int frameIndex = 0;
+    if (SpriteSheet::splitFrameSource(source, &baseSource, &frameIndex)) {
+        if (SpriteSheet::isSpriteSheet(baseSource)) {
+            return decodeSheetFrame(baseSource, frameIndex, settings);
+        }
+        return decodeAnimatedFrame(baseSource, frameIndex, settings);
+    }
+
+    const QSize pixelSize = settings.pixelSize();
+
+    QImageReader reader(localPath(source));
+    if (reader.size().isValid()) {
+        // Let the decoder scale (SVG renders, JPEG uses DCT scaling)
+        reader.setScaledSize(reader.size().scaled(pixelSize, Qt::KeepAspectRatio));
+    }
+
+    const QImage decoded = reader.read();
+    if (decoded.isNull()) {
+        qWarning() << "Failed to decode sprite frame:" << source << reader.errorString();
+        return QImage();
+    }
+
+    return fitToFrame(decoded, settings);
+}
+
+QImage SpriteFrameCache::decodeSheetFrame(const QString &sheetSource, int index, const Settings &settings)
+{
+    // One atlas decode per sheet while it stays in the LRU
+    const QString key = sheetKey(sheetSource);
+    QSharedPointer<SpriteSheet> sheet;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->lruPosition);
+            sheet = it->sheet;
+        }
+    }
+
+    if (!sheet) {
+        sheet.reset(new SpriteSheet);
+        if (!sheet->load(sheetSource)) {
+            qWarning() << "Failed to load sprite sheet:" << sheetSource << sheet->errorString();
+            return QImage();
+        }
+
+        QMutexLocker locker(&m_mutex);
+        if (!m_entries.contains(key)) {
+            Entry entry;
+            entry.sheet = sheet;
+            entry.bytes = sheet->atlas().sizeInBytes();
+            insertEntry(key, entry);
+        }
+    }
+
+    const QImage decoded = sheet->frameImage(index);
+    if (decoded.isNull()) {
+        qWarning() << "Sprite sheet frame out of range:" << sheetSource << index;
+        return QImage();
+    }
+
+    return fitToFrame(decoded, settings);
+}
+
+QImage SpriteFrameCache::decodeAnimatedFrame(const QString &imageSource, int index, const Settings &settings)
+{
+    // Animated formats decode sequentially, so cache every frame in one pass
+    QImageReader reader(localPath(imageSource));
+    QImage requested;
+
+    for (int i = 0; reader.canRead(); ++i) {
+        const QImage decoded = reader.read();
+        if (decoded.isNull()) {
+            break;
+        }
+
+        if (i == index) {
+            requested = fitToFrame(decoded, settings);
+            continue; // Inserted by frame()
+        }
+
+        const QString key = cacheKey(SpriteSheet::frameSource(imageSource, i), settings);
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_entries.contains(key)) {
+                continue;
+            }
+        }
+
+        const QImage image = fitToFrame(decoded, settings);
+        QMutexLocker locker(&m_mutex);
+        if (!m_entries.contains(key)) {
+            insert(key, image);
+        }
+    }
+
+    if (requested.isNull()) {
+        qWarning() << "Failed to decode animation frame:" << imageSource << index << reader.errorString();
+    }
+    return requested;
+}
+
+QImage SpriteFrameCache::fitToFrame(const QImage &source, const Settings &settings)
+{
+    const QSize pixelSize = settings.pixelSize();
+
+    QImage decoded = source;
+    if (decoded.size() != pixelSize) {
+        decoded = decoded.scaled(pixelSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    // Center on a display-sized canvas, matching Image.PreserveAspectFit
+    QImage image(pixelSize, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.drawImage((pixelSize.width() - decoded.width()) / 2,
+                      (pixelSize.height() - decoded.height()) / 2,
+                      decoded);
+    painter.end();
+
+    if (settings.shadowEnabled) {
+        image = bakeShadow(image, settings);
+    }
+
+    image.setDevicePixelRatio(settings.devicePixelRatio);
+    return image;
+}
+
+QImage SpriteFrameCache::bakeShadow(const QImage &frame, const Settings &settings)
+{
+    const int width = frame.width();
+    const int height = frame.height();
+    const QPoint offset = kShadowOffset * settings.devicePixelRatio;
+
+    // Blur the frame's alpha, shifted by the shadow offset
+    std::vector<uchar> alpha(size_t(width) * height, 0);
+    for (int y = 0; y < height; ++y) {
+        const int sourceY = y - offset.y();
+        if (sourceY < 0 || sourceY >= height) {
+            continue;
+        }
+        const QRgb *line = reinterpret_cast<const QRgb *>(frame.constScanLine(sourceY));
+        for (int x = 0; x < width; ++x) {
+            const int sourceX = x - offset.x();
+            if (sourceX >= 0 && sourceX < width) {
+                alpha[size_t(y) * width + x] = uchar(qAlpha(line[sourceX]));
+            }
+        }
+    }
+
+    const qreal sigma = (kShadowRadius + 1) / 3.3333 * settings.devicePixelRatio;
+    gaussianBlurAlpha(alpha, width, height, sigma);
+
+    // Shadow first, then the sprite over it
+    QImage result(frame.size(), QImage::Format_ARGB32_Premultiplied);
+    const int shadowAlpha = kShadowColor.alpha();
+    for (int y = 0; y < height; ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(result.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            const int a = alpha[size_t(y) * width + x] * shadowAlpha / 255;
+            line[x] = qPremultiply(qRgba(kShadowColor.red(), kShadowColor.green(), kShadowColor.blue(), a));
+        }
+    }
+
+    QPainter painter(&result);
+    painter.drawImage(0, 0, frame);
+    painter.end();
+
+    return result;
+}
+
+void SpriteFrameCache::insert(const QString &key, const QImage &image)
+{
+    Entry entry;
+    entry.image = image;
+    entry.bytes = image.sizeInBytes();
+    insertEntry(key, entry);
+}
+
+void SpriteFrameCache::insertAtlas(const QString &key, const SpriteFrameAtlas &atlas)
+{
+    if (atlas.isNull() || m_entries.contains(key)) {
+        return;
+    }
+
+    Entry entry;
+    entry.image = atlas.image;
+    entry.rects = atlas.rects;
+    entry.bytes = atlas.image.sizeInBytes();
+    insertEntry(key, entry);
+}
+
+void SpriteFrameCache::insertEntry(const QString &key, Entry entry)
+{
+    m_lru.push_front(key);
+    entry.lruPosition = m_lru.begin();
+
+    m_entries.insert(key, entry);
+    m_bytes += entry.bytes;
+
+    evictToBudget();
+}
+
+void SpriteFrameCache::evictToBudget()
+{
+    // Always keep the most recent entry, even if it alone exceeds the budget
+    while (m_bytes > m_byteBudget && m_lru.size() > 1) {
+        const QString key = m_lru.back();
+        m_lru.pop_back();
+
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_bytes -= it->bytes;
+            m_entries.erase(it);
+            ++m_evictions;
+        }
+    }
+}
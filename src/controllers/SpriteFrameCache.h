@@ -0,0 +1,149 @@
+#ifndef SPRITEFRAMECACHE_H
+#define SPRITEFRAMECACHE_H
+
+#include <QColor>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPoint>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QRect>
+#include <QThreadPool>
+#include <QVector>
+#include <list>
+
+class SpriteSheet;
+
+// All frames of one animation packed into a single image, so a
+// renderer can upload one texture and switch frames by sub-rect
+struct SpriteFrameAtlas {
+    QImage image;
+    QVector<QRect> rects; // Pixel rect of each frame within image
+
+    bool isNull() const { return image.isNull(); }
+};
+
+// Decoded sprite frames, keyed by source path and display size.
+// Each frame is decoded once at its device pixel size and kept in a
+// byte-budgeted LRU, so switching animation frames is a lookup. Built
+// atlases and loaded sprite sheets share that LRU and budget, so the
+// cache stays bounded however many animation sets come and go; a sprite
+// holding an evicted atlas keeps its own reference until it lets go.
+// Sources are image paths or frames of sprite sheets and animated
+// images ("<file>#<index>"). The sprite's drop shadow is baked into each
+// frame at decode time instead of running as a live shader effect.
+//
+// Atlases are built only on a small worker pool: readyAtlas() never
+// decodes on the calling thread, it queues the work and atlasReady()
+// follows once the atlas is in the cache. There is no blocking lookup,
+// so a miss on the GUI thread cannot turn into a decode there. Decoding
+// runs outside the cache lock, so lookups stay cheap while a worker is busy.
+class SpriteFrameCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        qint64 bytes = 0;
+        qint64 byteBudget = 0;
+        int frameCount = 0;
+        int atlasCount = 0;
+        int sheetCount = 0;
+        quint64 atlasReadyHits = 0;         // Atlas was decoded before it was needed
+        quint64 atlasNeededBeforeReady = 0; // Atlas was needed while still cold or decoding
+        quint64 asyncDecodes = 0;
+        qint64 maxAtlasWaitMs = 0;          // Longest time from needed to ready
+    };
+
+    explicit SpriteFrameCache(qint64 byteBudget = 32 * 1024 * 1024);
+    ~SpriteFrameCache();
+
+    // Display configuration
+    QSize frameSize() const;
+    void setFrameSize(const QSize &size);
+    qreal devicePixelRatio() const;
+    void setDevicePixelRatio(qreal ratio);
+    void setByteBudget(qint64 bytes);
+    bool shadowEnabled() const;
+    void setShadowEnabled(bool enabled);
+
+    void clear();
+
+    // Atlas access; an atlas is shared by every sprite playing the same frames
+    QString atlasKey(const QStringList &sources) const;
+    SpriteFrameAtlas cachedAtlas(const QString &key) const;
+    SpriteFrameAtlas readyAtlas(const QStringList &sources); // Null and queued if not decoded yet
+    void prefetchAtlas(const QStringList &sources);
+
+    Stats stats() const;
+
+    // Maps qrc:/ and file:// URLs to paths QImageReader understands
+    static QString localPath(const QString &source);
+
+signals:
+    // Emitted from a worker thread; queued to receivers in other threads
+    void atlasReady(const QString &key);
+
+private:
+    // One LRU slot: a frame, an atlas (image and rects) or a sprite sheet
+    struct Entry {
+        QImage image;
+        QVector<QRect> rects;
+        QSharedPointer<SpriteSheet> sheet;
+        qint64 bytes;
+        std::list<QString>::iterator lruPosition;
+    };
+
+    // Display configuration captured under the lock for one decode
+    struct Settings {
+        QSize frameSize;
+        qreal devicePixelRatio;
+        bool shadowEnabled;
+
+        QSize pixelSize() const { return frameSize * devicePixelRatio; }
+    };
+
+    QImage frame(const QString &source, const Settings &settings); // Decodes on a miss; worker threads only
+    static QString cacheKey(const QString &source, const Settings &settings);
+    static QString atlasKey(const QStringList &sources, const Settings &settings);
+    static QString sheetKey(const QString &sheetSource);
+    QImage decode(const QString &source, const Settings &settings);
+    QImage decodeSheetFrame(const QString &sheetSource, int index, const Settings &settings);
+    QImage decodeAnimatedFrame(const QString &imageSource, int index, const Settings &settings);
+    static QImage fitToFrame(const QImage &decoded, const Settings &settings);
+    static QImage bakeShadow(const QImage &frame, const Settings &settings);
+    SpriteFrameAtlas buildAtlas(const QStringList &sources, const Settings &settings);
+    void queueAtlas(const QString &key, const QStringList &sources, const Settings &settings, bool needed);
+    void insert(const QString &key, const QImage &image);
+    void insertAtlas(const QString &key, const SpriteFrameAtlas &atlas);
+    void insertEntry(const QString &key, Entry entry);
+    SpriteFrameAtlas lookupAtlas(const QString &key); // Marks a hit as recently used; caller holds the lock
+    void evictToBudget();
+
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    std::list<QString> m_lru; // Most recently used at the front
+    QHash<QString, qint64> m_pendingAtlases; // In flight: time first needed, or -1 if only prefetched
+    Settings m_settings;
+    qint64 m_byteBudget;
+    qint64 m_bytes;
+    quint64 m_hits;
+    quint64 m_misses;
+    quint64 m_evictions;
+    quint64 m_atlasReadyHits;
+    quint64 m_atlasNeededBeforeReady;
+    quint64 m_asyncDecodes;
+    qint64 m_maxAtlasWaitMs;
+    QElapsedTimer m_waitTimer;
+    QThreadPool m_pool; // Last member: destroyed first, after its jobs finish
+};
+
+#endif // SPRITEFRAMECACHE_H
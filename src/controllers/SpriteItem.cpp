@@ -0,0 +1,92 @@
+#include "SpriteItem.h"
+#include <QQuickWindow>
+#include <QSGImageNode>
+#include <QSGTexture>
+
+SpriteItem::SpriteItem(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_frameIndex(-1)
+    , m_textureDirty(false)
+{
+    setFlag(ItemHasContents, true);
+}
+
+SpriteController *SpriteItem::controller() const
+{
+    return m_controller;
+}
+
+void SpriteItem::setController(SpriteController *controller)
+{
+    if (m_controller == controller) {
+        return;
+    }
+
+    if (m_controller) {
+        disconnect(m_controller, nullptr, this, nullptr);
+    }
+
+    m_controller = controller;
+
+    if (m_controller) {
+        // Plain C++ connections: frame switches never touch the QML engine
+        connect(m_controller, &SpriteController::frameAtlasChanged,
+                this, &SpriteItem::onFrameAtlasChanged);
+        connect(m_controller, &SpriteController::currentFrameIndexChanged,
+                this, &SpriteItem::onCurrentFrameIndexChanged);
+    }
+
+    onFrameAtlasChanged();
+    emit controllerChanged();
+}
+
+QSGNode *SpriteItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data)
+
+    QSGImageNode *node = static_cast<QSGImageNode *>(oldNode);
+
+    if (m_atlas.isNull() || m_frameIndex < 0 || m_frameIndex >= m_atlas.rects.size()) {
+        delete node;
+        return nullptr;
+    }
+
+    if (!node) {
+        node = window()->createImageNode();
+        node->setOwnsTexture(true);
+        m_textureDirty = true;
+    }
+
+    // The only texture upload: once per animation, not per frame
+    if (m_textureDirty) {
+        node->setTexture(window()->createTextureFromImage(m_atlas.image));
+        m_textureDirty = false;
+    }
+
+    // Fit the frame into the item, matching Image.PreserveAspectFit
+    const QRectF frameRect = m_atlas.rects[m_frameIndex];
+    QSizeF size = frameRect.size();
+    size.scale(width(), height(), Qt::KeepAspectRatio);
+    const QRectF targetRect((width() - size.width()) / 2, (height() - size.height()) / 2,
+                            size.width(), size.height());
+
+    node->setSourceRect(frameRect);
+    node->setRect(targetRect);
+    node->setFiltering(smooth() ? QSGTexture::Linear : QSGTexture::Nearest);
+
+    return node;
+}
+
+void SpriteItem::onFrameAtlasChanged()
+{
+    m_atlas = m_controller ? m_controller->frameAtlas() : SpriteFrameAtlas();
+    m_frameIndex = m_controller ? m_controller->currentFrameIndex() : -1;
+    m_textureDirty = true;
+    update();
+}
+
+void SpriteItem::onCurrentFrameIndexChanged()
+{
+    m_frameIndex = m_controller ? m_controller->currentFrameIndex() : -1;
+    update();
+}
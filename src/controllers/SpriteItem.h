@@ -0,0 +1,39 @@
+#ifndef SPRITEITEM_H
+#define SPRITEITEM_H
+
+#include <QQuickItem>
+#include <QPointer>
+#include "SpriteController.h"
+
+// Renders the controller's current animation from one atlas texture.
+// A frame change only moves the texture sub-rect on the scene graph
+// node: no QML binding evaluation and no texture upload.
+class SpriteItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(SpriteController *controller READ controller WRITE setController NOTIFY controllerChanged)
+
+public:
+    explicit SpriteItem(QQuickItem *parent = nullptr);
+
+    SpriteController *controller() const;
+    void setController(SpriteController *controller);
+
+signals:
+    void controllerChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+
+private slots:
+    void onFrameAtlasChanged();
+    void onCurrentFrameIndexChanged();
+
+private:
+    QPointer<SpriteController> m_controller;
+    SpriteFrameAtlas m_atlas;
+    int m_frameIndex;
+    bool m_textureDirty;
+};
+
+#endif // SPRITEITEM_H
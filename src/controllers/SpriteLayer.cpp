@@ -0,0 +1,176 @@
+#include "SpriteLayer.h"
+#include <QHash>
+#include <QSet>
+#include <QQuickWindow>
+#include <QSGImageNode>
+#include <QSGTexture>
+
+namespace {
+const int kSpriteWindowSize = 150; // Sprite position is the top-left of this box
+
+// Root node owning the shared atlas textures. Nodes are destroyed on the
+// render thread, so the textures go with them in the right context.
+class SpriteLayerNode : public QSGNode
+{
+public:
+    ~SpriteLayerNode() override
+    {
+        qDeleteAll(textures);
+    }
+
+    QHash<qint64, QSGTexture *> textures; // Keyed by QImage::cacheKey()
+};
+}
+
+SpriteLayer::SpriteLayer(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_spriteSize(120)
+{
+    setFlag(ItemHasContents, true);
+}
+
+SpriteManager *SpriteLayer::manager() const
+{
+    return m_manager;
+}
+
+void SpriteLayer::setManager(SpriteManager *manager)
+{
+    if (m_manager == manager) {
+        return;
+    }
+
+    if (m_manager) {
+        disconnect(m_manager, nullptr, this, nullptr);
+        for (SpriteController *sprite : m_manager->sprites()) {
+            onSpriteRemoved(sprite);
+        }
+    }
+
+    m_manager = manager;
+
+    if (m_manager) {
+        connect(m_manager, &SpriteManager::spriteAdded, this, &SpriteLayer::onSpriteAdded);
+        connect(m_manager, &SpriteManager::spriteRemoved, this, &SpriteLayer::onSpriteRemoved);
+        for (SpriteController *sprite : m_manager->sprites()) {
+            onSpriteAdded(sprite);
+        }
+    }
+
+    update();
+    emit managerChanged();
+}
+
+int SpriteLayer::spriteSize() const
+{
+    return m_spriteSize;
+}
+
+void SpriteLayer::setSpriteSize(int size)
+{
+    if (m_spriteSize == size) {
+        return;
+    }
+
+    m_spriteSize = size;
+    update();
+    emit spriteSizeChanged();
+}
+
+void SpriteLayer::onSpriteAdded(SpriteController *sprite)
+{
+    // Any sprite's frame or position change repaints the one layer
+    connect(sprite, &SpriteController::frameAtlasChanged, this, &QQuickItem::update);
+    connect(sprite, &SpriteController::currentFrameIndexChanged, this, &QQuickItem::update);
+    connect(sprite, &SpriteController::positionChanged, this, &QQuickItem::update);
+    update();
+}
+
+void SpriteLayer::onSpriteRemoved(SpriteController *sprite)
+{
+    disconnect(sprite, nullptr, this, nullptr);
+    update();
+}
+
+QSGNode *SpriteLayer::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data)
+
+    SpriteLayerNode *root = static_cast<SpriteLayerNode *>(oldNode);
+    const QList<SpriteController *> sprites = m_manager ? m_manager->sprites() : QList<SpriteController *>();
+
+    if (sprites.isEmpty()) {
+        delete root;
+        return nullptr;
+    }
+
+    if (!root) {
+        root = new SpriteLayerNode;
+    }
+
+    const QPointF origin = mapToGlobal(QPointF(0, 0));
+    const qreal inset = (kSpriteWindowSize - m_spriteSize) / 2.0;
+    const QSGTexture::Filtering filtering = smooth() ? QSGTexture::Linear : QSGTexture::Nearest;
+
+    QSet<qint64> usedTextures;
+    QSGNode *child = root->firstChild();
+
+    for (SpriteController *sprite : sprites) {
+        const SpriteFrameAtlas atlas = sprite->frameAtlas();
+        const int frameIndex = sprite->currentFrameIndex();
+        if (atlas.isNull() || frameIndex < 0 || frameIndex >= atlas.rects.size()) {
+            continue;
+        }
+
+        // One upload per distinct atlas, however many sprites play it
+        const qint64 key = atlas.image.cacheKey();
+        QSGTexture *texture = root->textures.value(key);
+        if (!texture) {
+            texture = window()->createTextureFromImage(atlas.image);
+            root->textures.insert(key, texture);
+        }
+        usedTextures.insert(key);
+
+        QSGImageNode *node = static_cast<QSGImageNode *>(child);
+        if (!node) {
+            node = window()->createImageNode();
+            node->setOwnsTexture(false);
+            root->appendChildNode(node);
+        }
+        child = node->nextSibling();
+
+        // Fit the frame into the sprite box, matching SpriteItem
+        const QRectF frameRect = atlas.rects[frameIndex];
+        QSizeF size = frameRect.size();
+        size.scale(m_spriteSize, m_spriteSize, Qt::KeepAspectRatio);
+        const QPointF topLeft = QPointF(sprite->position()) - origin
+                + QPointF(inset + (m_spriteSize - size.width()) / 2,
+                          inset + (m_spriteSize - size.height()) / 2);
+
+        if (node->texture() != texture) {
+            node->setTexture(texture);
+        }
+        node->setSourceRect(frameRect);
+        node->setRect(QRectF(topLeft, size));
+        node->setFiltering(filtering);
+    }
+
+    // Drop nodes of removed sprites, then textures nobody plays any more
+    while (child) {
+        QSGNode *next = child->nextSibling();
+        root->removeChildNode(child);
+        delete child;
+        child = next;
+    }
+
+    for (auto it = root->textures.begin(); it != root->textures.end();) {
+        if (!usedTextures.contains(it.key())) {
+            delete it.value();
+            it = root->textures.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    return root;
+}
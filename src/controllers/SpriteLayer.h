@@ -0,0 +1,42 @@
+#ifndef SPRITELAYER_H
+#define SPRITELAYER_H
+
+#include <QQuickItem>
+#include <QPointer>
+#include "SpriteManager.h"
+
+// Draws every sprite of a SpriteManager in one item: one image node per
+// sprite under a single root, with atlas textures uploaded once and
+// shared by all sprites playing the same animation. Positions are in
+// screen coordinates and mapped through the item's global origin.
+class SpriteLayer : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(SpriteManager *manager READ manager WRITE setManager NOTIFY managerChanged)
+    Q_PROPERTY(int spriteSize READ spriteSize WRITE setSpriteSize NOTIFY spriteSizeChanged)
+
+public:
+    explicit SpriteLayer(QQuickItem *parent = nullptr);
+
+    SpriteManager *manager() const;
+    void setManager(SpriteManager *manager);
+    int spriteSize() const;
+    void setSpriteSize(int size);
+
+signals:
+    void managerChanged();
+    void spriteSizeChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+
+private slots:
+    void onSpriteAdded(SpriteController *sprite);
+    void onSpriteRemoved(SpriteController *sprite);
+
+private:
+    QPointer<SpriteManager> m_manager;
+    int m_spriteSize;
+};
+
+#endif // SPRITELAYER_H
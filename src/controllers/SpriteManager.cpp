@@ -0,0 +1,176 @@
+#include "SpriteManager.h"
+#include <QRandomGenerator>
+#include <QDebug>
+
+namespace {
+const int kSpriteWindowSize = 150; // Same footprint as the main sprite window
+}
+
+SpriteManager::SpriteManager(QObject *parent)
+    : QObject(parent)
+    , m_frameCache(new SpriteFrameCache)
+    , m_defaultImagePath("qrc:/resources/images/default.gif")
+    , m_bounds(0, 0, 1920, 1080)
+    , m_isSuspended(false)
+{
+}
+
+SpriteManager::~SpriteManager()
+{
+    clear();
+}
+
+int SpriteManager::count() const
+{
+    return m_sprites.size();
+}
+
+QList<SpriteController *> SpriteManager::sprites() const
+{
+    return m_sprites;
+}
+
+bool SpriteManager::isSuspended() const
+{
+    return m_isSuspended;
+}
+
+void SpriteManager::setSuspended(bool suspended)
+{
+    if (m_isSuspended == suspended) {
+        return;
+    }
+
+    m_isSuspended = suspended;
+    for (SpriteController *sprite : qAsConst(m_sprites)) {
+        sprite->setSuspended(suspended);
+    }
+    emit suspendedChanged();
+}
+
+void SpriteManager::setAnimationClock(AnimationClock *clock)
+{
+    m_clock = clock;
+    for (SpriteController *sprite : qAsConst(m_sprites)) {
+        sprite->setAnimationClock(clock);
+    }
+}
+
+void SpriteManager::setFrameCache(const QSharedPointer<SpriteFrameCache> &cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    m_frameCache = cache;
+    for (SpriteController *sprite : qAsConst(m_sprites)) {
+        sprite->setFrameCache(cache);
+    }
+}
+
+void SpriteManager::setBounds(const QRect &bounds)
+{
+    m_bounds = bounds;
+}
+
+QRect SpriteManager::bounds() const
+{
+    return m_bounds;
+}
+
+SpriteController *SpriteManager::addSprite()
+{
+    return addSpriteAt(randomPosition());
+}
+
+SpriteController *SpriteManager::addSpriteAt(const QPoint &position)
+{
+    SpriteController *sprite = new SpriteController(this);
+
+    // Shared clock and frames before any animation is configured
+    if (m_clock) {
+        sprite->setAnimationClock(m_clock);
+    }
+    sprite->setFrameCache(m_frameCache);
+    sprite->setPosition(position);
+    sprite->setMoveAnimationPaths(m_moveAnimationPaths);
+    sprite->setJumpAnimationPaths(m_jumpAnimationPaths);
+    sprite->setDefaultImagePath(m_defaultImagePath);
+    sprite->setSuspended(m_isSuspended);
+    if (!m_isSuspended) {
+        sprite->startIdleAnimation();
+    }
+
+    m_sprites.append(sprite);
+    emit spriteAdded(sprite);
+    emit countChanged();
+
+    qDebug() << "Added companion sprite" << m_sprites.size() << "at" << position;
+    return sprite;
+}
+
+void SpriteManager::removeSprite()
+{
+    if (m_sprites.isEmpty()) {
+        return;
+    }
+
+    SpriteController *sprite = m_sprites.takeLast();
+    emit spriteRemoved(sprite);
+    emit countChanged();
+    sprite->deleteLater();
+}
+
+void SpriteManager::clear()
+{
+    if (m_sprites.isEmpty()) {
+        return;
+    }
+
+    const QList<SpriteController *> sprites = m_sprites;
+    m_sprites.clear();
+    for (SpriteController *sprite : sprites) {
+        emit spriteRemoved(sprite);
+        sprite->deleteLater();
+    }
+    emit countChanged();
+}
+
+void SpriteManager::moveAllRandomly()
+{
+    for (SpriteController *sprite : qAsConst(m_sprites)) {
+        sprite->moveAlongPath(randomPosition(), MotionEngine::Wander);
+    }
+}
+
+void SpriteManager::setDefaultImagePath(const QString &path)
+{
+    m_defaultImagePath = path;
+    for (SpriteController *sprite : qAsConst(m_sprites)) {
+        sprite->setDefaultImagePath(path);
+    }
+}
+
+void SpriteManager::setMoveAnimationPaths(const QStringList &paths)
+{
+    m_moveAnimationPaths = paths;
+    for (SpriteController *sprite : qAsConst(m_sprites)) {
+        sprite->setMoveAnimationPaths(paths);
+    }
+}
+
+void SpriteManager::setJumpAnimationPaths(const QStringList &paths)
+{
+    m_jumpAnimationPaths = paths;
+    for (SpriteController *sprite : qAsConst(m_sprites)) {
+        sprite->setJumpAnimationPaths(paths);
+    }
+}
+
+QPoint SpriteManager::randomPosition() const
+{
+    const int width = qMax(1, m_bounds.width() - kSpriteWindowSize);
+    const int height = qMax(1, m_bounds.height() - kSpriteWindowSize);
+    return m_bounds.topLeft() + QPoint(QRandomGenerator::global()->bounded(width),
+                                       QRandomGenerator::global()->bounded(height));
+}
@@ -0,0 +1,72 @@
+#ifndef SPRITEMANAGER_H
+#define SPRITEMANAGER_H
+
+#include <QObject>
+#include <QList>
+#include <QPoint>
+#include <QPointer>
+#include <QRect>
+#include <QSharedPointer>
+#include <QStringList>
+#include "SpriteController.h"
+
+// Hosts companion sprites in the same process as the main sprite.
+// Every sprite has its own state, position and animation set, but all
+// of them tick from one AnimationClock, decode through one shared
+// SpriteFrameCache (identical animations share frames and atlases) and
+// are drawn by a single SpriteLayer on one transparent overlay window.
+class SpriteManager : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(bool suspended READ isSuspended WRITE setSuspended NOTIFY suspendedChanged)
+
+public:
+    explicit SpriteManager(QObject *parent = nullptr);
+    ~SpriteManager();
+
+    int count() const;
+    QList<SpriteController *> sprites() const;
+    bool isSuspended() const;
+    void setSuspended(bool suspended);
+
+    // Shared resources handed to every sprite
+    void setAnimationClock(AnimationClock *clock);
+    void setFrameCache(const QSharedPointer<SpriteFrameCache> &cache);
+
+    // Geometry of the overlay the sprites live on, in screen coordinates
+    void setBounds(const QRect &bounds);
+    QRect bounds() const;
+
+public slots:
+    SpriteController *addSprite();
+    SpriteController *addSpriteAt(const QPoint &position);
+    void removeSprite();
+    void clear();
+    void moveAllRandomly();
+
+    // Default animation set for sprites added from now on and existing ones
+    void setDefaultImagePath(const QString &path);
+    void setMoveAnimationPaths(const QStringList &paths);
+    void setJumpAnimationPaths(const QStringList &paths);
+
+signals:
+    void countChanged();
+    void suspendedChanged();
+    void spriteAdded(SpriteController *sprite);
+    void spriteRemoved(SpriteController *sprite);
+
+private:
+    QPoint randomPosition() const;
+
+    QList<SpriteController *> m_sprites;
+    QPointer<AnimationClock> m_clock;
+    QSharedPointer<SpriteFrameCache> m_frameCache;
+    QString m_defaultImagePath;
+    QStringList m_moveAnimationPaths;
+    QStringList m_jumpAnimationPaths;
+    QRect m_bounds;
+    bool m_isSuspended;
+};
+
+#endif // SPRITEMANAGER_H
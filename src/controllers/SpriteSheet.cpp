@@ -0,0 +1,404 @@
+#include "SpriteSheet.h"
+#include "SpriteFrameCache.h"
+#include <QBuffer>
+#include <QFile>
+#include <QImageReader>
+#include <QVector>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+const char kMagic[4] = { 'E', 'L', 'F', 'S' };
+const quint16 kVersion = 1;
+const int kHeaderSize = 12;      // magic + version + loop mode + frame count
+const int kFrameRecordSize = 20; // x, y, width, height, duration
+const QLatin1String kSuffix(".elfsheet");
+const int kDefaultFrameDelay = 100; // For animated formats that keep delays in the frame data
+
+// Skips a run of GIF data sub-blocks; false if the data ends first
+bool skipGifSubBlocks(const QByteArray &data, int &pos)
+{
+    while (pos < data.size()) {
+        const int size = quint8(data[pos++]);
+        if (size == 0) {
+            return true;
+        }
+        pos += size;
+    }
+    return false;
+}
+
+// Per-frame delays of a GIF in milliseconds, from the Graphic Control
+// Extension in front of each image. Walks the block structure only;
+// nothing is decompressed. Empty if the file is not a readable GIF.
+QVector<int> gifFrameDelays(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QVector<int>();
+    }
+    const QByteArray data = file.readAll();
+    if (data.size() < 13 || !data.startsWith("GIF")) {
+        return QVector<int>();
+    }
+
+    const auto colorTableSize = [](quint8 flags) {
+        return (flags & 0x80) ? 3 * (2 << (flags & 0x07)) : 0;
+    };
+
+    QVector<int> delays;
+    int pendingDelay = 0;
+    int pos = 13 + colorTableSize(quint8(data[10]));
+    while (pos < data.size()) {
+        const quint8 introducer = quint8(data[pos++]);
+        if (introducer == 0x3b) { // Trailer
+            break;
+        }
+        if (introducer == 0x21 && pos < data.size()) { // Extension
+            const quint8 label = quint8(data[pos++]);
+            if (label == 0xf9 && pos + 5 <= data.size() && quint8(data[pos]) >= 4) {
+                pendingDelay = (quint8(data[pos + 2]) | (quint8(data[pos + 3]) << 8)) * 10;
+            }
+            if (!skipGifSubBlocks(data, pos)) {
+                break;
+            }
+        } else if (introducer == 0x2c && pos + 10 <= data.size()) { // Image descriptor
+            pos += 9 + colorTableSize(quint8(data[pos + 8]));
+            ++pos; // LZW minimum code size
+            if (!skipGifSubBlocks(data, pos)) {
+                break;
+            }
+            delays.append(pendingDelay);
+            pendingDelay = 0;
+        } else {
+            break;
+        }
+    }
+    return delays;
+}
+}
+
+SpriteSheet::SpriteSheet()
+    : m_loopMode(Once)
+{
+}
+
+bool SpriteSheet::load(const QString &source)
+{
+    return read(source, true);
+}
+
+bool SpriteSheet::loadHeader(const QString &source)
+{
+    return read(source, false);
+}
+
+bool SpriteSheet::read(const QString &source, bool decodeAtlas)
+{
+    m_atlas = QImage();
+    m_frames.clear();
+    m_loopMode = Once;
+    m_errorString.clear();
+
+    QFile file(SpriteFrameCache::localPath(source));
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+
+    // Map the file so the atlas decodes straight from the page cache;
+    // compressed resources cannot be mapped and fall back to a read
+    const qint64 size = file.size();
+    if (uchar *data = file.map(0, size)) {
+        const bool ok = parse(data, size, decodeAtlas);
+        file.unmap(data);
+        return ok;
+    }
+
+    const QByteArray data = file.readAll();
+    return parse(reinterpret_cast<const uchar *>(data.constData()), data.size(), decodeAtlas);
+}
+
+bool SpriteSheet::parse(const uchar *data, qint64 size, bool decodeAtlas)
+{
+    if (size < kHeaderSize || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        m_errorString = QStringLiteral("Not a sprite sheet");
+        return false;
+    }
+
+    const quint16 version = qFromLittleEndian<quint16>(data + 4);
+    if (version != kVersion) {
+        m_errorString = QStringLiteral("Unsupported sprite sheet version %1").arg(version);
+        return false;
+    }
+
+    const quint16 loopMode = qFromLittleEndian<quint16>(data + 6);
+    const quint32 frameCount = qFromLittleEndian<quint32>(data + 8);
+    const qint64 framesEnd = kHeaderSize + qint64(frameCount) * kFrameRecordSize;
+    if (frameCount == 0 || framesEnd + 4 > size) {
+        m_errorString = QStringLiteral("Truncated sprite sheet header");
+        return false;
+    }
+
+    m_loopMode = loopMode <= PingPong ? LoopMode(loopMode) : Once;
+
+    const uchar *record = data + kHeaderSize;
+    for (quint32 i = 0; i < frameCount; ++i, record += kFrameRecordSize) {
+        Frame frame;
+        frame.rect = QRect(qFromLittleEndian<qint32>(record),
+                           qFromLittleEndian<qint32>(record + 4),
+                           qFromLittleEndian<qint32>(record + 8),
+                           qFromLittleEndian<qint32>(record + 12));
+        frame.duration = int(qMax<quint32>(1, qFromLittleEndian<quint32>(record + 16)));
+        m_frames.append(frame);
+    }
+
+    const quint32 atlasSize = qFromLittleEndian<quint32>(data + framesEnd);
+    if (framesEnd + 4 + atlasSize > size) {
+        m_errorString = QStringLiteral("Truncated sprite sheet atlas");
+        m_frames.clear();
+        return false;
+    }
+
+    if (decodeAtlas) {
+        m_atlas = QImage::fromData(data + framesEnd + 4, int(atlasSize));
+        if (m_atlas.isNull()) {
+            m_errorString = QStringLiteral("Failed to decode sprite sheet atlas");
+            m_frames.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SpriteSheet::save(const QString &path) const
+{
+    if (m_frames.isEmpty() || m_atlas.isNull()) {
+        qWarning() << "Cannot save empty sprite sheet to:" << path;
+        return false;
+    }
+
+    QByteArray atlasData;
+    QBuffer buffer(&atlasData);
+    buffer.open(QIODevice::WriteOnly);
+    m_atlas.save(&buffer, "PNG");
+
+    QByteArray data(kHeaderSize + m_frames.size() * kFrameRecordSize + 4, '\0');
+    uchar *out = reinterpret_cast<uchar *>(data.data());
+    memcpy(out, kMagic, sizeof(kMagic));
+    qToLittleEndian<quint16>(kVersion, out + 4);
+    qToLittleEndian<quint16>(quint16(m_loopMode), out + 6);
+    qToLittleEndian<quint32>(quint32(m_frames.size()), out + 8);
+
+    uchar *record = out + kHeaderSize;
+    for (const Frame &frame : m_frames) {
+        qToLittleEndian<qint32>(frame.rect.x(), record);
+        qToLittleEndian<qint32>(frame.rect.y(), record + 4);
+        qToLittleEndian<qint32>(frame.rect.width(), record + 8);
+        qToLittleEndian<qint32>(frame.rect.height(), record + 12);
+        qToLittleEndian<quint32>(quint32(frame.duration), record + 16);
+        record += kFrameRecordSize;
+    }
+    qToLittleEndian<quint32>(quint32(atlasData.size()), record);
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to save sprite sheet to:" << path;
+        return false;
+    }
+    file.write(data);
+    file.write(atlasData);
+    return true;
+}
+
+void SpriteSheet::setAtlas(const QImage &atlas)
+{
+    m_atlas = atlas;
+}
+
+void SpriteSheet::addFrame(const QRect &rect, int duration)
+{
+    Frame frame;
+    frame.rect = rect;
+    frame.duration = qMax(1, duration);
+    m_frames.append(frame);
+}
+
+void SpriteSheet::setLoopMode(LoopMode mode)
+{
+    m_loopMode = mode;
+}
+
+bool SpriteSheet::isValid() const
+{
+    return !m_frames.isEmpty();
+}
+
+QImage SpriteSheet::atlas() const
+{
+    return m_atlas;
+}
+
+QList<SpriteSheet::Frame> SpriteSheet::frames() const
+{
+    return m_frames;
+}
+
+int SpriteSheet::frameCount() const
+{
+    return m_frames.size();
+}
+
+SpriteSheet::LoopMode SpriteSheet::loopMode() const
+{
+    return m_loopMode;
+}
+
+int SpriteSheet::totalDuration() const
+{
+    int total = 0;
+    for (const Frame &frame : m_frames) {
+        total += frame.duration;
+    }
+    return total;
+}
+
+QImage SpriteSheet::frameImage(int index) const
+{
+    if (index < 0 || index >= m_frames.size() || m_atlas.isNull()) {
+        return QImage();
+    }
+    return m_atlas.copy(m_frames[index].rect);
+}
+
+QString SpriteSheet::errorString() const
+{
+    return m_errorString;
+}
+
+bool SpriteSheet::isSpriteSheet(const QString &source)
+{
+    return source.endsWith(kSuffix, Qt::CaseInsensitive);
+}
+
+QString SpriteSheet::frameSource(const QString &sheetSource, int index)
+{
+    return sheetSource + QLatin1Char('#') + QString::number(index);
+}
+
+bool SpriteSheet::parseFrameSource(const QString &source, QString *sheetSource, int *index)
+{
+    QString baseSource;
+    if (!splitFrameSource(source, &baseSource, index) || !isSpriteSheet(baseSource)) {
+        return false;
+    }
+
+    if (sheetSource) {
+        *sheetSource = baseSource;
+    }
+    return true;
+}
+
+bool SpriteSheet::splitFrameSource(const QString &source, QString *baseSource, int *index)
+{
+    const int separator = source.lastIndexOf(QLatin1Char('#'));
+    if (separator <= 0) {
+        return false;
+    }
+
+    bool ok = false;
+    const int frameIndex = source.midRef(separator + 1).toInt(&ok);
+    if (!ok) {
+        return false;
+    }
+
+    if (baseSource) {
+        *baseSource = source.left(separator);
+    }
+    if (index) {
+        *index = frameIndex;
+    }
+    return true;
+}
+
+int SpriteAnimation::totalDuration() const
+{
+    int total = 0;
+    for (int duration : durations) {
+        total += duration;
+    }
+    return total;
+}
+
+SpriteAnimation SpriteAnimation::fromPaths(const QStringList &paths, int totalDuration)
+{
+    SpriteAnimation animation;
+
+    if (paths.size() == 1 && SpriteSheet::isSpriteSheet(paths.first())) {
+        SpriteSheet sheet;
+        if (!sheet.loadHeader(paths.first())) {
+            qWarning() << "Failed to load sprite sheet:" << paths.first() << sheet.errorString();
+            return animation;
+        }
+
+        const QList<SpriteSheet::Frame> frames = sheet.frames();
+        for (int i = 0; i < frames.size(); ++i) {
+            animation.frames.append(SpriteSheet::frameSource(paths.first(), i));
+            animation.durations.append(frames[i].duration);
+        }
+        animation.loopMode = sheet.loopMode();
+        return animation;
+    }
+
+    if (paths.isEmpty()) {
+        return animation;
+    }
+
+    // A single animated image plays its own frames with their own delays,
+    // read without decoding any frame: GIF from its block structure,
+    // other formats by skipping from frame to frame where the handler can
+    if (paths.size() == 1) {
+        const QString path = SpriteFrameCache::localPath(paths.first());
+        QImageReader reader(path);
+        if (reader.supportsAnimation() && reader.imageCount() > 1) {
+            QVector<int> delays;
+            if (reader.format() == "gif") {
+                delays = gifFrameDelays(path);
+            } else {
+                for (int i = 0; i < reader.imageCount(); ++i) {
+                    delays.append(reader.nextImageDelay() > 0 ? reader.nextImageDelay() : kDefaultFrameDelay);
+                    if (!reader.jumpToNextImage()) {
+                        break;
+                    }
+                }
+                delays.resize(reader.imageCount());
+            }
+            // A zero delay, or a GIF frame without a Graphic Control
+            // Extension, plays at the default rate rather than the clamp
+            for (int &delay : delays) {
+                if (delay <= 0) {
+                    delay = kDefaultFrameDelay;
+                }
+            }
+
+            for (int i = 0; i < delays.size(); ++i) {
+                animation.frames.append(SpriteSheet::frameSource(paths.first(), i));
+                animation.durations.append(qMax(10, delays[i]));
+            }
+            if (!animation.frames.isEmpty()) {
+                animation.loopMode = SpriteSheet::Loop;
+                return animation;
+            }
+        }
+    }
+
+    // Loose frames spread the total duration evenly
+    const int frameDuration = qMax(1, totalDuration / paths.size());
+    animation.frames = paths;
+    for (int i = 0; i < paths.size(); ++i) {
+        animation.durations.append(frameDuration);
+    }
+    return animation;
+}
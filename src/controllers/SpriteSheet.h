@@ -0,0 +1,89 @@
+#ifndef SPRITESHEET_H
+#define SPRITESHEET_H
+
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <QString>
+#include <QStringList>
+
+// Packed single-file animation (*.elfsheet): one atlas image plus a
+// header with frame rects, per-frame durations and loop mode.
+//
+// Layout, all integers little-endian:
+//   char[4]  magic "ELFS"
+//   quint16  version (1)
+//   quint16  loop mode
+//   quint32  frame count
+//   frame count x { qint32 x, y, width, height; quint32 durationMs }
+//   quint32  atlas byte length
+//   bytes    atlas image (PNG)
+class SpriteSheet
+{
+public:
+    enum LoopMode {
+        Once = 0,
+        Loop = 1,
+        PingPong = 2
+    };
+
+    struct Frame {
+        QRect rect;
+        int duration;
+    };
+
+    SpriteSheet();
+
+    bool load(const QString &source);
+    bool loadHeader(const QString &source); // Frames and timings only, no atlas decode
+    bool save(const QString &path) const;
+
+    // Packing
+    void setAtlas(const QImage &atlas);
+    void addFrame(const QRect &rect, int duration);
+    void setLoopMode(LoopMode mode);
+
+    bool isValid() const;
+    QImage atlas() const;
+    QList<Frame> frames() const;
+    int frameCount() const;
+    LoopMode loopMode() const;
+    int totalDuration() const;
+    QImage frameImage(int index) const;
+    QString errorString() const;
+
+    // Frame sources address a single frame as "<sheet>#<index>"; the same
+    // form addresses frames of multi-frame images such as animated GIFs
+    static bool isSpriteSheet(const QString &source);
+    static QString frameSource(const QString &sheetSource, int index);
+    static bool parseFrameSource(const QString &source, QString *sheetSource, int *index);
+    static bool splitFrameSource(const QString &source, QString *baseSource, int *index);
+
+private:
+    bool read(const QString &source, bool decodeAtlas);
+    bool parse(const uchar *data, qint64 size, bool decodeAtlas);
+
+    QImage m_atlas;
+    QList<Frame> m_frames;
+    LoopMode m_loopMode;
+    QString m_errorString;
+};
+
+// Frame list and timing for one animation, expanded from either loose
+// image paths or a sprite sheet
+struct SpriteAnimation {
+    QStringList frames;
+    QList<int> durations;
+    SpriteSheet::LoopMode loopMode;
+
+    SpriteAnimation() : loopMode(SpriteSheet::Once) {}
+
+    bool isEmpty() const { return frames.isEmpty(); }
+    int totalDuration() const;
+
+    // Loose paths share totalDuration evenly; a single *.elfsheet path or
+    // animated image uses the timings stored in the file
+    static SpriteAnimation fromPaths(const QStringList &paths, int totalDuration = 1000);
+};
+
+#endif // SPRITESHEET_H
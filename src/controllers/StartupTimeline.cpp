@@ -0,0 +1,148 @@
+#include "StartupTimeline.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <QMutex>
+#include <QQuickWindow>
+#include <QVector>
+#include <QDebug>
+#include <atomic>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <QFile>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#endif
+
+namespace {
+struct Mark {
+    const char *stage;
+    qint64 msecs; // Since main()
+};
+
+QElapsedTimer g_clock;
+qint64 g_preMainMs = -1; // Process start to main(), -1 when unknown
+bool g_enabled = false;
+std::atomic<bool> g_firstFrame(false);
+QMutex g_mutex;
+QVector<Mark> g_marks;
+QMetaObject::Connection g_frameConnection; // GUI thread only
+
+qint64 processAgeMs()
+{
+#if defined(Q_OS_LINUX)
+    // Field 22 of /proc/self/stat: start time in clock ticks after boot
+    QFile stat(QStringLiteral("/proc/self/stat"));
+    if (!stat.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    const QByteArray line = stat.readAll();
+    const QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    timespec now;
+    if (fields.size() < 20 || clock_gettime(CLOCK_BOOTTIME, &now) != 0) {
+        return -1;
+    }
+    const qint64 startMs = fields.at(19).toLongLong() * 1000 / sysconf(_SC_CLK_TCK);
+    return qMax<qint64>(0, qint64(now.tv_sec) * 1000 + now.tv_nsec / 1000000 - startMs);
+#elif defined(Q_OS_WIN)
+    FILETIME created, exited, kernel, user, now;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+        return -1;
+    }
+    GetSystemTimeAsFileTime(&now);
+    const auto ticks = [](const FILETIME &time) {
+        return (qint64(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return qMax<qint64>(0, (ticks(now) - ticks(created)) / 10000); // 100 ns units
+#else
+    return -1;
+#endif
+}
+}
+
+void StartupTimeline::begin(int argc, char *argv[])
+{
+    g_clock.start();
+    g_preMainMs = processAgeMs();
+
+    g_enabled = qEnvironmentVariableIntValue("DESKTOPELF_STARTUP_TIMELINE") != 0;
+    for (int i = 1; i < argc && !g_enabled; ++i) {
+        g_enabled = std::strcmp(argv[i], "--startup-timeline") == 0;
+    }
+
+    mark("main");
+}
+
+bool StartupTimeline::isEnabled()
+{
+    return g_enabled;
+}
+
+void StartupTimeline::mark(const char *stage)
+{
+    const qint64 msecs = g_clock.elapsed();
+    QMutexLocker locker(&g_mutex);
+    g_marks.append(Mark{ stage, msecs });
+}
+
+void StartupTimeline::watchFirstFrame(QQuickWindow *window)
+{
+    // Direct: frameSwapped comes from the render thread, after the swap
+    g_frameConnection = QObject::connect(window, &QQuickWindow::frameSwapped, window,
+                                         &StartupTimeline::firstFrameSwapped, Qt::DirectConnection);
+}
+
+void StartupTimeline::firstFrameSwapped()
+{
+    if (g_firstFrame.exchange(true)) {
+        return;
+    }
+    mark("first frame swapped");
+
+    // Usually called on the render thread; disconnect and print from the
+    // GUI thread, which owns the connection. Frames swapped before then
+    // stop at the flag above.
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        QMetaObject::invokeMethod(app, []() {
+            QObject::disconnect(g_frameConnection);
+            report();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void StartupTimeline::report()
+{
+    if (!g_enabled) {
+        return;
+    }
+
+    QVector<Mark> marks;
+    {
+        QMutexLocker locker(&g_mutex);
+        marks = g_marks;
+    }
+
+    // Relative to process start when the OS told us when that was
+    const qint64 offset = qMax<qint64>(0, g_preMainMs);
+    qInfo().noquote() << (g_preMainMs >= 0 ? "Startup timeline (ms since process start):"
+                                           : "Startup timeline (ms since main):");
+    if (g_preMainMs >= 0) {
+        qInfo().noquote() << QString("%1  +%2  process start").arg(0, 6).arg(0, 5);
+    }
+
+    qint64 previous = 0;
+    for (const Mark &mark : marks) {
+        const qint64 at = mark.msecs + offset;
+        qInfo().noquote() << QString("%1  +%2  %3").arg(at, 6).arg(at - previous, 5).arg(QLatin1String(mark.stage));
+        previous = at;
+    }
+
+    if (g_firstFrame && previous > kBudgetMs) {
+        qWarning().noquote() << QString("First frame after %1 ms, over the %2 ms budget").arg(previous).arg(kBudgetMs);
+    }
+}
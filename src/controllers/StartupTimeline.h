@@ -0,0 +1,34 @@
+#ifndef STARTUPTIMELINE_H
+#define STARTUPTIMELINE_H
+
+#include <QtGlobal>
+
+class QQuickWindow;
+
+// Milestones from process start to the first frame on screen. Marks are
+// cheap and always taken; the table is printed only when asked for with
+// --startup-timeline or DESKTOPELF_STARTUP_TIMELINE=1. Time before main()
+// (loader, static initializers) comes from the OS where it says when the
+// process was created: /proc on Linux, to the clock tick; Windows exactly.
+class StartupTimeline
+{
+public:
+    static constexpr qint64 kBudgetMs = 150; // Process start to first frame
+
+    // Call first thing in main(); reads the flag from the arguments
+    static void begin(int argc, char *argv[]);
+    static bool isEnabled();
+
+    // stage must be a string literal. Safe from the render thread.
+    static void mark(const char *stage);
+
+    // Listens for the window's first frameSwapped, then disconnects
+    static void watchFirstFrame(QQuickWindow *window);
+
+    // Marks the first frame and reports once; later calls do nothing
+    static void firstFrameSwapped();
+
+    static void report();
+};
+
+#endif // STARTUPTIMELINE_H
@@ -1,15 +1,24 @@
 #include "TimerManager.h"
+#include "Scheduler.h"
 #include <QDebug>
 
+namespace {
+const qint64 kApproachLeadMs = 30 * 1000; // Time the sprite has to prefetch before moving
+}
+
 TimerManager::TimerManager(QObject *parent)
     : QObject(parent)
     , m_isHourlyTimerEnabled(true)
-    , m_timer(new QTimer(this))
+    , m_isSuspended(false)
+    , m_hourlyJob(0)
+    , m_approachJob(0)
 {
-    // Setup timer
-    m_timer->setSingleShot(false);
-    m_timer->setInterval(60000); // Check every minute
-    connect(m_timer, &QTimer::timeout, this, &TimerManager::onTimerTimeout);
+    // "The next hour" is local time; move it when the clock or zone changes
+    connect(Scheduler::instance(), &Scheduler::clockChanged, this, [this]() {
+        if (m_hourlyJob || m_approachJob) {
+            startHourlyTimer();
+        }
+    });
 
     // Calculate initial next trigger
     calculateNextHourlyTrigger();
@@ -20,7 +29,7 @@ TimerManager::TimerManager(QObject *parent)
 
 TimerManager::~TimerManager()
 {
-    stopHourlyTimer();
+    cancelJobs();
 }
 
 bool TimerManager::isHourlyTimerEnabled() const
@@ -33,6 +42,28 @@ QDateTime TimerManager::nextHourlyTrigger() const
     return m_nextHourlyTrigger;
 }
 
+bool TimerManager::isSuspended() const
+{
+    return m_isSuspended;
+}
+
+void TimerManager::setSuspended(bool suspended)
+{
+    if (m_isSuspended == suspended) {
+        return;
+    }
+
+    m_isSuspended = suspended;
+    emit suspendedChanged();
+
+    if (suspended) {
+        cancelJobs();
+        qDebug() << "Hourly timer suspended";
+    } else {
+        startHourlyTimer();
+    }
+}
+
 void TimerManager::setHourlyTimerEnabled(bool enabled)
 {
     if (m_isHourlyTimerEnabled != enabled) {
@@ -49,19 +80,19 @@ void TimerManager::setHourlyTimerEnabled(bool enabled)
 
 void TimerManager::startHourlyTimer()
 {
-    if (!m_isHourlyTimerEnabled) {
+    if (!m_isHourlyTimerEnabled || m_isSuspended) {
         return;
     }
 
     calculateNextHourlyTrigger();
-    m_timer->start();
+    scheduleJobs();
     
     qDebug() << "Hourly timer started. Next trigger at:" << m_nextHourlyTrigger.toString();
 }
 
 void TimerManager::stopHourlyTimer()
 {
-    m_timer->stop();
+    cancelJobs();
     qDebug() << "Hourly timer stopped";
 }
 
@@ -79,13 +110,33 @@ void TimerManager::checkHourlyTrigger()
     }
 }
 
-void TimerManager::onTimerTimeout()
+void TimerManager::scheduleJobs()
 {
-    if (!m_isHourlyTimerEnabled) {
-        return;
+    cancelJobs();
+    Scheduler *scheduler = Scheduler::instance();
+
+    m_hourlyJob = scheduler->schedule(m_nextHourlyTrigger, this, [this]() {
+        m_hourlyJob = 0;
+        checkHourlyTrigger();
+        scheduleJobs();
+    }, "timerManager.hourly");
+
+    // One early job per hour to announce the approaching trigger
+    const QDateTime approach = m_nextHourlyTrigger.addMSecs(-kApproachLeadMs);
+    if (approach > QDateTime::currentDateTime()) {
+        m_approachJob = scheduler->schedule(approach, this, [this]() {
+            m_approachJob = 0;
+            emit hourlyTriggerApproaching();
+        }, "timerManager.approach");
     }
+}
 
-    checkHourlyTrigger();
+void TimerManager::cancelJobs()
+{
+    Scheduler::instance()->cancel(m_hourlyJob);
+    Scheduler::instance()->cancel(m_approachJob);
+    m_hourlyJob = 0;
+    m_approachJob = 0;
 }
 
 void TimerManager::calculateNextHourlyTrigger()
@@ -107,12 +158,3 @@ void TimerManager::calculateNextHourlyTrigger()
     
     qDebug() << "Next hourly trigger calculated:" << m_nextHourlyTrigger.toString();
 }
-
-void TimerManager::updateTimer()
-{
-    if (m_isHourlyTimerEnabled && !m_timer->isActive()) {
-        startHourlyTimer();
-    } else if (!m_isHourlyTimerEnabled && m_timer->isActive()) {
-        stopHourlyTimer();
-    }
-}
\ No newline at end of file
@@ -2,14 +2,17 @@
 #define TIMERMANAGER_H
 
 #include <QObject>
-#include <QTimer>
 #include <QDateTime>
 
+// Hourly chime on top of the shared Scheduler: one job at the hour and
+// one just before it for prefetching, so the process sleeps in between.
+// Both are recomputed when the wall clock or time zone changes.
 class TimerManager : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(bool isHourlyTimerEnabled READ isHourlyTimerEnabled WRITE setHourlyTimerEnabled NOTIFY hourlyTimerEnabledChanged)
     Q_PROPERTY(QDateTime nextHourlyTrigger READ nextHourlyTrigger NOTIFY nextHourlyTriggerChanged)
+    Q_PROPERTY(bool suspended READ isSuspended WRITE setSuspended NOTIFY suspendedChanged)
 
 public:
     explicit TimerManager(QObject *parent = nullptr);
@@ -18,9 +21,13 @@ public:
     // Property getters
     bool isHourlyTimerEnabled() const;
     QDateTime nextHourlyTrigger() const;
+    bool isSuspended() const;
 
     // Property setters
     void setHourlyTimerEnabled(bool enabled);
+
+    // Hidden power state: disarms the trigger entirely, re-armed on resume
+    void setSuspended(bool suspended);
     
     // Alias method for compatibility
     bool enabled() const { return isHourlyTimerEnabled(); }
@@ -36,18 +43,20 @@ public slots:
 signals:
     void hourlyTimerEnabledChanged();
     void nextHourlyTriggerChanged();
+    void suspendedChanged();
     void hourlyTriggerActivated();
-
-private slots:
-    void onTimerTimeout();
+    void hourlyTriggerApproaching(); // Shortly before the trigger, for prefetching
 
 private:
     void calculateNextHourlyTrigger();
-    void updateTimer();
+    void scheduleJobs();
+    void cancelJobs();
 
     bool m_isHourlyTimerEnabled;
+    bool m_isSuspended;
     QDateTime m_nextHourlyTrigger;
-    QTimer *m_timer;
+    quint64 m_hourlyJob;   // Scheduler job IDs, 0 when not scheduled
+    quint64 m_approachJob;
 };
 
 #endif // TIMERMANAGER_H
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "WakeupMonitor.h"
+
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+WakeupMonitor *WakeupMonitor::instance()
+{
+    static WakeupMonitor monitor;
+    return &monitor;
+}
+
+WakeupMonitor::WakeupMonitor(QObject *parent)
+    : QObject(parent)
+    , m_cpuAtReset(processCpuMs())
+{
+    m_time.start();
+}
+
+void WakeupMonitor::record(const char *source)
+{
+    Counter &counter = m_counters[QByteArray::fromRawData(source, int(qstrlen(source)))];
+    const qint64 minute = currentMinute();
+
+    if (counter.minute != minute) {
+        // Only a bucket from the directly preceding minute is still "last minute"
+        counter.previousCount = counter.minute == minute - 1 ? counter.currentCount : 0;
+        counter.currentCount = 0;
+        counter.minute = minute;
+    }
+
+    ++counter.currentCount;
+    ++counter.total;
+}
+
+QVariantMap WakeupMonitor::wakeupsPerMinute() const
+{
+    const qint64 minute = currentMinute();
+    const qreal minutesElapsed = qMax<qreal>(1.0, m_time.elapsed() / 60000.0);
+
+    QVariantMap result;
+    for (auto it = m_counters.cbegin(); it != m_counters.cend(); ++it) {
+        const Counter &counter = it.value();
+
+        quint32 lastMinute = 0;
+        quint32 thisMinute = 0;
+        if (counter.minute == minute) {
+            lastMinute = counter.previousCount;
+            thisMinute = counter.currentCount;
+        } else if (counter.minute == minute - 1) {
+            lastMinute = counter.currentCount;
+        }
+
+        QVariantMap entry;
+        entry["lastMinute"] = lastMinute;
+        entry["currentMinute"] = thisMinute;
+        entry["total"] = counter.total;
+        entry["averagePerMinute"] = counter.total / minutesElapsed;
+        result.insert(QString::fromLatin1(it.key()), entry);
+    }
+    return result;
+}
+
+quint64 WakeupMonitor::totalWakeups() const
+{
+    quint64 total = 0;
+    for (const Counter &counter : m_counters) {
+        total += counter.total;
+    }
+    return total;
+}
+
+QVariantMap WakeupMonitor::cpuUsage() const
+{
+    const qint64 cpuMs = processCpuMs() - m_cpuAtReset;
+    const qint64 wallMs = qMax<qint64>(1, m_time.elapsed());
+
+    QVariantMap result;
+    result["cpuMs"] = cpuMs;
+    result["wallMs"] = wallMs;
+    result["percentOfCore"] = 100.0 * cpuMs / wallMs;
+    return result;
+}
+
+void WakeupMonitor::reset()
+{
+    m_counters.clear();
+    m_cpuAtReset = processCpuMs();
+    m_time.restart();
+}
+
+qint64 WakeupMonitor::currentMinute() const
+{
+    return m_time.elapsed() / 60000;
+}
+
+qint64 WakeupMonitor::processCpuMs()
+{
+#ifdef Q_OS_WIN
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+        return 0;
+    }
+    const auto ticks = [](const FILETIME &time) {
+        return (qint64(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) / 10000; // 100 ns units
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return qint64(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+#endif
+}
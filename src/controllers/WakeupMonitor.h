@@ -0,0 +1,49 @@
+#ifndef WAKEUPMONITOR_H
+#define WAKEUPMONITOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVariantMap>
+
+// Counts process wakeups per source (timer fires, rendered frames), in
+// one-minute buckets. It never schedules anything itself: buckets roll
+// over lazily when a wakeup is recorded or a report is requested.
+class WakeupMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static WakeupMonitor *instance();
+
+    // source must be a string literal; it is keyed without copying
+    void record(const char *source);
+
+    // source -> { lastMinute, currentMinute, total, averagePerMinute }
+    Q_INVOKABLE QVariantMap wakeupsPerMinute() const;
+    Q_INVOKABLE quint64 totalWakeups() const;
+
+    // Process CPU time since the last reset against wall time:
+    // { cpuMs, wallMs, percentOfCore }
+    Q_INVOKABLE QVariantMap cpuUsage() const;
+    Q_INVOKABLE void reset();
+
+private:
+    explicit WakeupMonitor(QObject *parent = nullptr);
+
+    struct Counter {
+        qint64 minute = 0;
+        quint32 currentCount = 0;
+        quint32 previousCount = 0;
+        quint64 total = 0;
+    };
+
+    qint64 currentMinute() const;
+    static qint64 processCpuMs();
+
+    QElapsedTimer m_time;
+    qint64 m_cpuAtReset;
+    QHash<QByteArray, Counter> m_counters;
+};
+
+#endif // WAKEUPMONITOR_H
@@ -1,5 +1,6 @@
 #include <QApplication>
 #include <QQmlApplicationEngine>
+#include <QQuickWindow>
 #include <QQmlContext>
 #include <QIcon>
 #include <QSystemTrayIcon>
@@ -8,20 +9,38 @@
 #include <QPoint>
 #include <QTime>
 #include <QRandomGenerator>
+#ifdef DESKTOPELF_BENCHMARKS
+#include <QTimer>
+#endif
 
 // Include controllers
 #include "controllers/SpriteController.h"
 #include "controllers/ConfigManager.h"
 #include "controllers/TimerManager.h"
+#include "controllers/Scheduler.h"
 #include "controllers/FitnessManager.h"
+#include "controllers/FitnessMonthModel.h"
+#include "controllers/FitnessAnalytics.h"
+#include "controllers/FitnessReminder.h"
+#include "controllers/AnimationClock.h"
+#include "controllers/SpriteItem.h"
+#include "controllers/WakeupMonitor.h"
+#include "controllers/SpriteManager.h"
+#include "controllers/PersistenceWorker.h"
+#include "controllers/SpriteLayer.h"
+#include "controllers/StartupTimeline.h"
 
 int main(int argc, char *argv[])
 {
+    // Startup milestones; printed with --startup-timeline
+    StartupTimeline::begin(argc, argv);
+
     // Enable high DPI scaling
     QApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
     QApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
 
     QApplication app(argc, argv);
+    StartupTimeline::mark("application created");
 
     // Set application properties
     app.setApplicationName("DesktopElf");
@@ -40,12 +59,31 @@ int main(int argc, char *argv[])
     qmlRegisterType<ConfigManager>("DesktopElf", 1, 0, "ConfigManager");
     qmlRegisterType<TimerManager>("DesktopElf", 1, 0, "TimerManager");
     qmlRegisterType<FitnessManager>("DesktopElf", 1, 0, "FitnessManager");
-
-    // Create controller instances
+    qmlRegisterType<FitnessMonthModel>("DesktopElf", 1, 0, "FitnessMonthModel");
+    qmlRegisterType<FitnessAnalytics>("DesktopElf", 1, 0, "FitnessAnalytics");
+    qmlRegisterType<FitnessReminder>("DesktopElf", 1, 0, "FitnessReminder");
+    qmlRegisterUncreatableType<FitnessDayModel>("DesktopElf", 1, 0, "FitnessDayModel",
+                                                "FitnessDayModel is provided by FitnessMonthModel");
+    qmlRegisterType<SpriteItem>("DesktopElf", 1, 0, "SpriteItem");
+    qmlRegisterType<SpriteLayer>("DesktopElf", 1, 0, "SpriteLayer");
+    qmlRegisterUncreatableType<SpriteManager>("DesktopElf", 1, 0, "SpriteManager",
+                                              "SpriteManager is provided as a context property");
+
+    // Create controller instances; the persistence worker outlives the
+    // managers, which flush their last saves through it on destruction
+    PersistenceWorker persistenceWorker;
+    AnimationClock animationClock;
     SpriteController spriteController;
+    SpriteManager spriteManager;
     ConfigManager configManager;
     TimerManager timerManager;
     FitnessManager fitnessManager;
+    FitnessReminder fitnessReminder;
+    configManager.setPersistenceWorker(&persistenceWorker);
+    fitnessManager.setPersistenceWorker(&persistenceWorker);
+    fitnessReminder.setManager(&fitnessManager);
+
+    StartupTimeline::mark("controllers created");
 
     // Connect timer to sprite controller for hourly movement
     QObject::connect(&timerManager, &TimerManager::hourlyTriggerActivated, [&]() {
@@ -57,11 +95,22 @@ int main(int argc, char *argv[])
         int randomY = QRandomGenerator::global()->bounded(screenHeight - 150);
         
         QPoint randomPosition(randomX, randomY);
-        spriteController.moveToPosition(randomPosition);
+        spriteController.moveAlongPath(randomPosition, MotionEngine::Wander);
+        spriteManager.moveAllRandomly();
         
         qDebug() << "Hourly movement triggered, moving to:" << randomPosition;
     });
 
+    // Decode the move animation ahead of the hourly trip; companions share the cache
+    QObject::connect(&timerManager, &TimerManager::hourlyTriggerApproaching, [&]() {
+        spriteController.prefetchState(SpriteController::MoveState);
+    });
+
+    // Behind on today's fitness goal: the sprite jumps for attention
+    QObject::connect(&fitnessReminder, &FitnessReminder::reminderDue, [&]() {
+        spriteController.startJumpAnimation();
+    });
+
     // Connect config manager to sprite controller
     QObject::connect(&configManager, &ConfigManager::spriteImagePathChanged,
                      &spriteController, &SpriteController::setDefaultImagePath);
@@ -72,14 +121,42 @@ int main(int argc, char *argv[])
     QObject::connect(&configManager, &ConfigManager::positionChanged,
                      &spriteController, &SpriteController::setPosition);
 
-    // Load initial configuration
-    configManager.loadConfig();
-    
+    // Companions follow the same animation set
+    QObject::connect(&configManager, &ConfigManager::spriteImagePathChanged,
+                     &spriteManager, &SpriteManager::setDefaultImagePath);
+    QObject::connect(&configManager, &ConfigManager::moveAnimationPathChanged,
+                     &spriteManager, &SpriteManager::setMoveAnimationPaths);
+    QObject::connect(&configManager, &ConfigManager::jumpAnimationPathChanged,
+                     &spriteManager, &SpriteManager::setJumpAnimationPaths);
+
+    // Fitness reminder follows its config values
+    QObject::connect(&configManager, &ConfigManager::fitnessDailyGoalChanged,
+                     &fitnessReminder, &FitnessReminder::setDailyGoal);
+    QObject::connect(&configManager, &ConfigManager::fitnessReminderEnabledChanged,
+                     &fitnessReminder, &FitnessReminder::setEnabled);
+
+    // Frame animation and movement share one render-loop driven clock
+    spriteController.setAnimationClock(&animationClock);
+
+    // Decode sprite frames at the primary screen's pixel density, before
+    // any path setter below requests frames or atlases
+    spriteController.frameCache()->setDevicePixelRatio(app.devicePixelRatio());
+
+    // Companions tick from the same clock and share decoded frames and atlases
+    spriteManager.setAnimationClock(&animationClock);
+    spriteManager.setFrameCache(spriteController.frameCache());
+    spriteManager.setBounds(QApplication::primaryScreen()->geometry());
+
     // Initialize sprite controller with config values
     spriteController.setDefaultImagePath(configManager.defaultImagePath());
     spriteController.setMoveAnimationPaths(configManager.moveAnimationPaths());
     spriteController.setJumpAnimationPaths(configManager.jumpAnimationPaths());
     spriteController.setPosition(configManager.targetPosition());
+    spriteManager.setDefaultImagePath(configManager.defaultImagePath());
+    spriteManager.setMoveAnimationPaths(configManager.moveAnimationPaths());
+    spriteManager.setJumpAnimationPaths(configManager.jumpAnimationPaths());
+    fitnessReminder.setDailyGoal(configManager.fitnessDailyGoal());
+    fitnessReminder.setEnabled(configManager.fitnessReminderEnabled());
     
     // Start timer manager if enabled
     if (timerManager.enabled()) {
@@ -88,12 +165,19 @@ int main(int argc, char *argv[])
 
     // Create QML engine
     QQmlApplicationEngine engine;
+    StartupTimeline::mark("engine created");
 
     // Expose controllers to QML
     engine.rootContext()->setContextProperty("spriteController", &spriteController);
     engine.rootContext()->setContextProperty("configManager", &configManager);
     engine.rootContext()->setContextProperty("timerManager", &timerManager);
     engine.rootContext()->setContextProperty("fitnessManager", &fitnessManager);
+    engine.rootContext()->setContextProperty("spriteManager", &spriteManager);
+    engine.rootContext()->setContextProperty("animationClock", &animationClock);
+    engine.rootContext()->setContextProperty("fitnessReminder", &fitnessReminder);
+    engine.rootContext()->setContextProperty("scheduler", Scheduler::instance());
+    engine.rootContext()->setContextProperty("wakeupMonitor", WakeupMonitor::instance());
+    engine.rootContext()->setContextProperty("persistenceWorker", &persistenceWorker);
 
     // Load main QML file
     const QUrl url(QStringLiteral("qrc:/src/qml/main.qml"));
@@ -105,10 +189,64 @@ int main(int argc, char *argv[])
     }, Qt::QueuedConnection);
 
     engine.load(url);
+    StartupTimeline::mark("QML loaded");
+
+    // Tick the animation clock from the sprite window's render loop
+    if (!engine.rootObjects().isEmpty()) {
+        QQuickWindow *spriteWindow = qobject_cast<QQuickWindow *>(engine.rootObjects().first());
+        animationClock.attachWindow(spriteWindow);
+
+        if (spriteWindow) {
+            // The end of the startup timeline
+            StartupTimeline::watchFirstFrame(spriteWindow);
+
+            // One native window move per sprite position update
+            QObject::connect(&spriteController, &SpriteController::positionChanged, spriteWindow, [&, spriteWindow]() {
+                spriteWindow->setPosition(spriteController.position());
+            });
+
+            // Hidden power state: nothing ticks or polls while the sprite is hidden
+            QObject::connect(spriteWindow, &QWindow::visibleChanged, [&](bool visible) {
+                spriteController.setSuspended(!visible);
+                fitnessReminder.setSuspended(!visible);
+                spriteManager.setSuspended(!visible);
+                timerManager.setSuspended(!visible);
+            });
+        }
+    }
 
     // Start the sprite controller with idle animation
     spriteController.startIdleAnimation();
 
+#ifdef DESKTOPELF_BENCHMARKS
+    // --companion-benchmark [N]: N companions (100 by default) wander for
+    // 30 s, then the process CPU use over that time is printed
+    const int benchmarkArgument = app.arguments().indexOf(QStringLiteral("--companion-benchmark"));
+    if (benchmarkArgument > 0) {
+        const int companions = qMax(1, app.arguments().value(benchmarkArgument + 1, QStringLiteral("100")).toInt());
+        for (int i = 0; i < companions; ++i) {
+            spriteManager.addSprite();
+        }
+        spriteManager.moveAllRandomly();
+
+        QTimer *wander = new QTimer(&app);
+        QObject::connect(wander, &QTimer::timeout, &spriteManager, &SpriteManager::moveAllRandomly);
+        wander->start(5000);
+
+        WakeupMonitor::instance()->reset();
+        QTimer::singleShot(30000, &app, [&app, companions]() {
+            const QVariantMap usage = WakeupMonitor::instance()->cpuUsage();
+            qInfo().noquote() << QString("Companion benchmark: %1 sprites, %2 ms CPU in %3 ms, %4% of one core")
+                                     .arg(companions)
+                                     .arg(usage.value("cpuMs").toLongLong())
+                                     .arg(usage.value("wallMs").toLongLong())
+                                     .arg(usage.value("percentOfCore").toDouble(), 0, 'f', 2);
+            qInfo() << "Wakeups:" << WakeupMonitor::instance()->wakeupsPerMinute();
+            app.quit();
+        });
+    }
+#endif
+
     qDebug() << "DesktopElf application started successfully";
 
     return app.exec();
@@ -14,8 +14,8 @@ Rectangle {
     property bool hasPlans: false
     property real completionRate: 0.0
     property bool isEditing: false
-    // 文本列表模型与编辑索引
-    property ListModel planModel: ListModel {}
+    // 当日计划模型（FitnessMonthModel 的 plans 角色）与编辑索引
+    property var planModel: null
     property int editingIndex: -1
     
     // 信号
@@ -111,8 +111,13 @@ Rectangle {
                 spacing: 4
 
                 Repeater {
+                    id: listRepeater
                     model: planModel
                     Rectangle {
+                        readonly property string planName: model.name
+                        readonly property var planId: model.planId
+                        // 非0表示由重复规则展开的实例
+                        readonly property var recurrenceId: model.recurrenceId
                         width: listColumn.width
                         height: 22
                         radius: 4
@@ -120,8 +125,28 @@ Rectangle {
                         border.color: "#3a3d44"
                         border.width: 1
 
+                        CheckBox {
+                            id: completedBox
+                            anchors.left: parent.left
+                            anchors.verticalCenter: parent.verticalCenter
+                            width: 20
+                            height: 20
+                            padding: 0
+                            checked: model.completed
+                            onToggled: {
+                                if (typeof fitnessManager !== 'undefined' && fitnessManager) {
+                                    if (recurrenceId) {
+                                        fitnessManager.setOccurrenceCompleted(recurrenceId, calendarCell.cellDate, checked)
+                                    } else {
+                                        fitnessManager.setPlanCompleted(planId, checked)
+                                    }
+                                }
+                            }
+                        }
+
                         Loader {
                             anchors.fill: parent
+                            anchors.leftMargin: completedBox.width
                             sourceComponent: (index === calendarCell.editingIndex) ? editComp : textComp
                         }
 
@@ -132,7 +157,8 @@ Rectangle {
                                 anchors.left: parent.left
                                 anchors.leftMargin: 6
                                 text: model.name
-                                color: isToday ? "white" : "#d0d4dc"
+                                color: model.completed ? "#888888" : (isToday ? "white" : "#d0d4dc")
+                                font.strikeout: model.completed
                                 font.pixelSize: 12
                                 elide: Text.ElideRight
                             }
@@ -147,30 +173,33 @@ Rectangle {
                                 font.pixelSize: 12
                                 focus: true
                                 selectByMouse: true
-                                // 编辑前的旧名称，用于后端更新
+                                // 编辑前的旧名称，用于判断是否变更
                                 property string oldName: model.name
                                 onEditingFinished: {
                                     var content = text.trim()
                                     if (typeof fitnessManager !== 'undefined' && fitnessManager) {
-                                        if (content === "") {
-                                            // 空内容则移除占位计划
-                                            fitnessManager.removePlan(calendarCell.cellDate, oldName)
-                                        } else {
-                                            // 名称变更：先移除旧名称，再添加新名称
-                                            if (content !== oldName) {
-                                                fitnessManager.removePlan(calendarCell.cellDate, oldName)
+                                        if (recurrenceId && content !== oldName) {
+                                            // 重复计划只改这一天：跳过该实例，另存为普通计划
+                                            fitnessManager.skipOccurrence(recurrenceId, calendarCell.cellDate)
+                                            if (content !== "") {
+                                                fitnessManager.addPlan(calendarCell.cellDate, content, "")
                                             }
-                                            fitnessManager.addPlan(calendarCell.cellDate, content, "")
+                                        } else if (content === "") {
+                                            // 空内容则移除占位计划
+                                            fitnessManager.removePlanById(planId)
+                                        } else if (content !== oldName) {
+                                            // 按ID原地改名，保留完成状态和创建时间
+                                            fitnessManager.renamePlan(planId, content)
                                         }
                                     }
                                     calendarCell.editingIndex = -1
-                                    calendarCell.loadPlans()
                                 }
                             }
                         }
 
                         MouseArea {
                             anchors.fill: parent
+                            anchors.leftMargin: completedBox.width
                             hoverEnabled: true
                             onDoubleClicked: {
                                 calendarCell.editingIndex = index
@@ -188,8 +217,8 @@ Rectangle {
                         var name = base
                         var n = 1
                         var existing = {}
-                        for (var i = 0; i < planModel.count; i++) {
-                            existing[planModel.get(i).name] = true
+                        for (var i = 0; i < listRepeater.count; i++) {
+                            existing[listRepeater.itemAt(i).planName] = true
                         }
                         while (existing[name]) {
                             name = base + " " + n
@@ -197,20 +226,26 @@ Rectangle {
                         }
 
                         if (typeof fitnessManager !== 'undefined' && fitnessManager) {
-                            fitnessManager.addPlan(calendarCell.cellDate, name, "")
+                            // 模型已同步刷新；重复计划实例排在普通计划之后，按ID找新行而非取最后一行
+                            var newId = fitnessManager.addPlan(calendarCell.cellDate, name, "")
+                            for (var row = 0; newId && row < listRepeater.count; row++) {
+                                if (listRepeater.itemAt(row).planId == newId) {
+                                    calendarCell.editingIndex = row
+                                    break
+                                }
+                            }
                         }
-                        calendarCell.loadPlans()
-                        calendarCell.editingIndex = planModel.count - 1
                     }
                 }
             }
         }
     }
     
-    // 鼠标交互
+    // 鼠标交互（置于内容下方，列表中的勾选、编辑和添加按钮才能收到点击）
     MouseArea {
         id: mouseArea
         anchors.fill: parent
+        z: -1
         hoverEnabled: true
         
         onClicked: {
@@ -238,21 +273,4 @@ Rectangle {
         radius: 8
         visible: isSelected && !isToday
     }
-    
-    // 函数：加载指定日期的计划列表
-    function loadPlans() {
-        planModel.clear()
-        if (typeof fitnessManager !== 'undefined' && fitnessManager) {
-            var plans = fitnessManager.getPlansForDate(cellDate)
-            for (var i = 0; i < plans.length; i++) {
-                var p = plans[i]
-                planModel.append({ name: p.name, description: p.description, completed: p.completed })
-            }
-        }
-    }
-
-    Component.onCompleted: loadPlans()
-    // 监听属性变化
-    onCellDateChanged: loadPlans()
-    onHasPlansChanged: loadPlans()
-}
\ No newline at end of file
+}
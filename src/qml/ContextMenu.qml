@@ -112,6 +112,48 @@ Menu {
             fitnessRequested()
         }
     }
+
+    // Only while today's fitness reminder is due
+    MenuItem {
+        id: snoozeItem
+        text: "稍后提醒"
+        icon.source: "qrc:/resources/images/fitness.svg"
+        visible: fitnessReminder.due
+        height: visible ? 32 : 0
+
+        background: Rectangle {
+            implicitWidth: 180
+            implicitHeight: 32
+            color: parent.hovered ? "#e0e0e0" : "transparent"
+            radius: 4
+        }
+
+        contentItem: Row {
+            spacing: 8
+            leftPadding: 12
+            rightPadding: 12
+
+            Image {
+                source: snoozeItem.icon.source
+                width: 16
+                height: 16
+                anchors.verticalCenter: parent.verticalCenter
+                fillMode: Image.PreserveAspectFit
+            }
+
+            Text {
+                text: snoozeItem.text + " (10 分钟)"
+                font.pixelSize: 12
+                color: "#333333"
+                anchors.verticalCenter: parent.verticalCenter
+            }
+        }
+
+        onTriggered: {
+            contextMenu.close()
+            fitnessReminder.snooze(10)
+        }
+    }
     
     MenuSeparator {
         background: Rectangle {
@@ -281,6 +323,74 @@ Menu {
         
         onTriggered: animationSubmenu.popup()
     }
+
+    MenuItem {
+        id: companionItem
+        text: "伙伴"
+        icon.source: "qrc:/resources/images/animation.svg"
+        height: 32
+        
+        background: Rectangle {
+            implicitWidth: 180
+            implicitHeight: 32
+            color: parent.hovered ? "#e0e0e0" : "transparent"
+            radius: 4
+        }
+        
+        contentItem: Row {
+            spacing: 8
+            leftPadding: 12
+            rightPadding: 12
+            
+            Image {
+                source: companionItem.icon.source
+                width: 16
+                height: 16
+                anchors.verticalCenter: parent.verticalCenter
+                fillMode: Image.PreserveAspectFit
+            }
+            
+            Text {
+                text: companionItem.text + " (" + spriteManager.count + ")"
+                font.pixelSize: 12
+                color: "#333333"
+                anchors.verticalCenter: parent.verticalCenter
+            }
+        }
+        
+        Menu {
+            id: companionSubmenu
+            title: "伙伴"
+            
+            MenuItem {
+                text: "添加伙伴"
+                onTriggered: {
+                    spriteManager.addSprite()
+                    contextMenu.close()
+                }
+            }
+            
+            MenuItem {
+                text: "移除伙伴"
+                enabled: spriteManager.count > 0
+                onTriggered: {
+                    spriteManager.removeSprite()
+                    contextMenu.close()
+                }
+            }
+            
+            MenuItem {
+                text: "移除全部"
+                enabled: spriteManager.count > 0
+                onTriggered: {
+                    spriteManager.clear()
+                    contextMenu.close()
+                }
+            }
+        }
+        
+        onTriggered: companionSubmenu.popup()
+    }
     
     MenuSeparator {
         background: Rectangle {
@@ -19,12 +19,23 @@ ApplicationWindow {
     height: Screen.height
     
     // 属性
-    property date currentDate: new Date()
     property date selectedDate: new Date()
     property var monthNames: ["一月", "二月", "三月", "四月", "五月", "六月", 
                              "七月", "八月", "九月", "十月", "十一月", "十二月"]
     property var weekDays: ["周一", "周二", "周三", "周四", "周五", "周六", "周日"]
     
+    // 当月 42 个格子的数据，一次区间查询填充，编辑时只刷新对应格子
+    FitnessMonthModel {
+        id: monthModel
+        manager: fitnessManager
+    }
+    
+    // 连续打卡与完成率，随编辑增量更新
+    FitnessAnalytics {
+        id: analytics
+        manager: fitnessManager
+    }
+    
     // ESC键退出快捷键
     Shortcut {
         sequence: "Escape"
@@ -79,6 +90,7 @@ ApplicationWindow {
         
         // 标题和导航
         Rectangle {
+            id: titleBar
             anchors.top: parent.top
             anchors.horizontalCenter: parent.horizontalCenter
             anchors.topMargin: 30
@@ -109,16 +121,12 @@ ApplicationWindow {
                         verticalAlignment: Text.AlignVCenter
                     }
                     
-                    onClicked: {
-                        currentDate.setMonth(currentDate.getMonth() - 1)
-                        currentDate = new Date(currentDate)
-                        updateCalendar()
-                    }
+                    onClicked: monthModel.previousMonth()
                 }
                 
                 Text {
                     Layout.fillWidth: true
-                    text: currentDate.getFullYear() + "年 " + monthNames[currentDate.getMonth()]
+                    text: monthModel.year + "年 " + monthNames[monthModel.month - 1]
                     font.pixelSize: 24
                     font.bold: true
                     color: "white"
@@ -144,11 +152,30 @@ ApplicationWindow {
                         verticalAlignment: Text.AlignVCenter
                     }
                     
-                    onClicked: {
-                        currentDate.setMonth(currentDate.getMonth() + 1)
-                        currentDate = new Date(currentDate)
-                        updateCalendar()
-                    }
+                    onClicked: monthModel.nextMonth()
+                }
+            }
+        }
+        
+        // 统计信息
+        Row {
+            anchors.top: titleBar.bottom
+            anchors.topMargin: 8
+            anchors.horizontalCenter: parent.horizontalCenter
+            spacing: 24
+            
+            Repeater {
+                model: [
+                    "当前连续 " + analytics.currentStreak + " 天",
+                    "最长连续 " + analytics.longestStreak + " 天",
+                    "本周完成率 " + Math.round(analytics.weeklyCompletionRate * 100) + "%",
+                    "本月完成率 " + Math.round(analytics.monthlyCompletionRate * 100) + "%"
+                ]
+                
+                Text {
+                    text: modelData
+                    color: "#d0d4dc"
+                    font.pixelSize: 14
                 }
             }
         }
@@ -195,225 +222,24 @@ ApplicationWindow {
                     }
                 }
                 
-                // 第2-7行：日期格子（动态生成）
-                // 这里会通过 updateCalendar() 函数动态添加42个日期格子
-            }
-        }
-    }
-    
-    // 日期单元格组件
-    Component {
-        id: dayCellComponent
-        
-        Rectangle {
-            id: dayCell
-            
-            // 属性
-            property date cellDate: new Date()
-            property bool isCurrentMonth: true
-            property bool isToday: false
-            property bool isSelected: false
-            property ListModel todoModel: ListModel {}
-            
-            Layout.fillWidth: true
-            Layout.fillHeight: true
-            Layout.minimumHeight: 120
-            
-            color: {
-                if (isToday) return "#ff6b35"
-                if (isSelected) return "#4a90e2"
-                if (!isCurrentMonth) return "#1a1a1a"
-                return "#2a2a2a"
-            }
-            
-            border.color: isToday ? "#ffffff" : "#555555"
-            border.width: isToday ? 2 : 1
-            radius: 8
-            
-            MouseArea {
-                anchors.fill: parent
-                onClicked: {
-                    selectedDate = new Date(dayCell.cellDate)
-                    updateCalendar()
-                }
-            }
-            
-            ColumnLayout {
-                anchors.fill: parent
-                anchors.margins: 6
-                spacing: 4
-                
-                // 日期数字
-                Rectangle {
-                    Layout.fillWidth: true
-                    Layout.preferredHeight: 28
-                    color: "#333333"
-                    radius: 4
-                    
-                    Text {
-                        anchors.centerIn: parent
-                        text: cellDate.getDate()
-                        font.pixelSize: isToday ? 18 : 14
-                        font.bold: isToday || isSelected
-                        color: {
-                            if (isToday) return "white"
-                            if (isSelected) return "white"
-                            if (!isCurrentMonth) return "#666666"
-                            return "#ffffff"
-                        }
-                    }
-                }
-                
-                // 待办列表区域
-                ScrollView {
-                    Layout.fillWidth: true
-                    Layout.fillHeight: true
-                    clip: true
-                    ScrollBar.horizontal.policy: ScrollBar.AlwaysOff
-                    ScrollBar.vertical.policy: ScrollBar.AsNeeded
+                // 第2-7行：日期格子
+                Repeater {
+                    model: monthModel
                     
-                    ColumnLayout {
-                        width: parent.width
-                        spacing: 2
+                    CalendarCell {
+                        Layout.fillWidth: true
+                        Layout.fillHeight: true
+                        Layout.minimumHeight: 120
                         
-                        // 待办项列表
-                        Repeater {
-                            model: todoModel
-                            
-                            Rectangle {
-                                Layout.fillWidth: true
-                                Layout.preferredHeight: 24
-                                color: "transparent"
-                                
-                                RowLayout {
-                                    anchors.fill: parent
-                                    spacing: 4
-                                    
-                                    CheckBox {
-                                        Layout.preferredWidth: 20
-                                        Layout.preferredHeight: 20
-                                        checked: model.completed || false
-                                        
-                                        onCheckedChanged: {
-                                            todoModel.setProperty(index, "completed", checked)
-                                        }
-                                        
-                                        indicator: Rectangle {
-                                            implicitWidth: 16
-                                            implicitHeight: 16
-                                            x: parent.leftPadding
-                                            y: parent.height / 2 - height / 2
-                                            radius: 3
-                                            border.color: parent.checked ? "#4a90e2" : "#666666"
-                                            border.width: 2
-                                            color: parent.checked ? "#4a90e2" : "transparent"
-                                            
-                                            Text {
-                                                anchors.centerIn: parent
-                                                text: "✓"
-                                                color: "white"
-                                                font.pixelSize: 10
-                                                visible: parent.parent.checked
-                                            }
-                                        }
-                                    }
-                                    
-                                    Rectangle {
-                                        Layout.fillWidth: true
-                                        Layout.fillHeight: true
-                                        color: textArea.activeFocus ? "#3a3a3a" : "transparent"
-                                        radius: 3
-                                        border.color: textArea.activeFocus ? "#4a90e2" : "transparent"
-                                        border.width: 1
-                                        
-                                        TextInput {
-                                            id: textArea
-                                            anchors.fill: parent
-                                            anchors.margins: 4
-                                            verticalAlignment: Text.AlignVCenter
-                                            text: model.text || ""
-                                            font.pixelSize: 11
-                                            color: model.completed ? "#888888" : "#ffffff"
-                                            font.strikeout: model.completed || false
-                                            selectByMouse: true
-                                            activeFocusOnPress: true
-                                            
-                                            // 双击处理
-                                            MouseArea {
-                                                anchors.fill: parent
-                                                acceptedButtons: Qt.NoButton // 不接受按钮事件，只处理双击
-                                                onDoubleClicked: {
-                                                    textArea.forceActiveFocus()
-                                                    textArea.selectAll()
-                                                }
-                                            }
-                                            
-                                            // 键盘事件处理
-                                            Keys.onReturnPressed: {
-                                                textArea.focus = false // 失去焦点，触发 onEditingFinished
-                                            }
-                                            
-                                            Keys.onEnterPressed: {
-                                                textArea.focus = false // 失去焦点，触发 onEditingFinished
-                                            }
-                                            
-                                            Keys.onEscapePressed: {
-                                                textArea.text = model.text || "" // 恢复原始文本
-                                                textArea.focus = false // 失去焦点
-                                            }
-                                            
-                                            // 编辑完成处理
-                                            onEditingFinished: {
-                                                console.log("编辑完成，保存文本:", text)
-                                                todoModel.setProperty(index, "text", text)
-                                            }
-                                            
-                                            // 接受处理（回车键触发）
-                                            onAccepted: {
-                                                console.log("接受输入，保存文本:", text)
-                                                todoModel.setProperty(index, "text", text)
-                                                textArea.focus = false
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                        }
+                        cellDate: model.date
+                        isCurrentMonth: model.inMonth
+                        isToday: model.isToday
+                        isSelected: isSameDate(model.date, selectedDate)
+                        hasPlans: model.total > 0
+                        completionRate: model.total > 0 ? model.completed / model.total : 0
+                        planModel: model.plans
                         
-                        // 添加按钮
-                        Button {
-                            Layout.fillWidth: true
-                            Layout.preferredHeight: 24
-                            text: "+ 添加待办"
-                            
-                            background: Rectangle {
-                                color: parent.hovered ? "#4a90e2" : "#3a3a3a"
-                                radius: 4
-                                border.color: "#4a90e2"
-                                border.width: 1
-                            }
-                            
-                            contentItem: Text {
-                                text: parent.text
-                                color: "white"
-                                font.pixelSize: 10
-                                horizontalAlignment: Text.AlignHCenter
-                                verticalAlignment: Text.AlignVCenter
-                            }
-                            
-                            onClicked: {
-                                todoModel.append({
-                                    "text": "",
-                                    "completed": false
-                                })
-                                
-                                // 自动聚焦到新添加的文本框
-                                Qt.callLater(function() {
-                                    var lastIndex = todoModel.count - 1
-                                    // 这里可以添加自动聚焦逻辑
-                                })
-                            }
-                        }
+                        onClicked: selectedDate = date
                     }
                 }
             }
@@ -421,47 +247,6 @@ ApplicationWindow {
     }
     
     // 函数
-    function updateCalendar() {
-        console.log("=== 开始更新日历 ===")
-        console.log("当前日期:", Qt.formatDate(currentDate, "yyyy-MM-dd"))
-        
-        // 清空现有的日期格子（保留星期标题）
-        for (var i = mainCalendarGrid.children.length - 1; i >= 7; i--) {
-            mainCalendarGrid.children[i].destroy()
-        }
-        
-        // 计算当月第一天
-        var firstDay = new Date(currentDate.getFullYear(), currentDate.getMonth(), 1)
-        var lastDay = new Date(currentDate.getFullYear(), currentDate.getMonth() + 1, 0)
-        
-        // 计算开始日期（包含上月末尾几天），以周一为第一列
-        var startDate = new Date(firstDay)
-        var jsDay = firstDay.getDay() // 0=周日,1=周一,...
-        var mondayOffset = (jsDay + 6) % 7
-        startDate.setDate(startDate.getDate() - mondayOffset)
-        
-        console.log("日历开始日期(周一起):", startDate)
-        
-        // 生成6行7列的日期格子（共42天）
-        for (var i = 0; i < 42; i++) {
-            var cellDate = new Date(startDate)
-            cellDate.setDate(startDate.getDate() + i)
-            
-            var cell = dayCellComponent.createObject(mainCalendarGrid, {
-                "cellDate": cellDate,
-                "isCurrentMonth": cellDate.getMonth() === currentDate.getMonth(),
-                "isToday": isSameDate(cellDate, new Date()),
-                "isSelected": isSameDate(cellDate, selectedDate)
-            })
-            
-            if (cell) {
-                console.log("创建日期格子:", Qt.formatDate(cellDate, "yyyy-MM-dd"))
-            }
-        }
-        
-        console.log("=== 日历更新完成 ===")
-    }
-    
     function isSameDate(date1, date2) {
         return date1.getFullYear() === date2.getFullYear() &&
                date1.getMonth() === date2.getMonth() &&
@@ -470,7 +255,6 @@ ApplicationWindow {
     
     Component.onCompleted: {
         console.log("FitnessCalendar window completed")
-        updateCalendar()
         console.log("Fitness calendar window loaded in fullscreen mode")
     }
 }
@@ -0,0 +1,28 @@
+import QtQuick 2.15
+import QtQuick.Window 2.15
+import DesktopElf 1.0
+
+// Transparent full-screen layer hosting companion sprites. All companions
+// are drawn by one SpriteLayer in this one window, so their cost does not
+// grow with a window per sprite. It is still a second top-level window
+// next to the main sprite's: it has its own render loop and swap, so a
+// frame with companions moving presents two surfaces. The window never
+// takes input, so clicks pass through to the desktop.
+Window {
+    id: overlayWindow
+
+    x: Screen.virtualX
+    y: Screen.virtualY
+    width: Screen.width
+    height: Screen.height
+    flags: Qt.FramelessWindowHint | Qt.WindowStaysOnTopHint | Qt.Tool
+           | Qt.WindowTransparentForInput
+    color: "transparent"
+    title: "Desktop Elf Companions"
+
+    SpriteLayer {
+        id: spriteLayer
+        anchors.fill: parent
+        manager: spriteManager
+    }
+}
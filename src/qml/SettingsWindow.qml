@@ -131,7 +131,7 @@ ApplicationWindow {
                         TextField {
                             id: moveAnimationField
                             Layout.fillWidth: true
-                            text: configManager.moveAnimationPath
+                            text: pathsText(configManager.moveAnimationPaths)
                             placeholderText: "选择移动动画文件夹"
                             readOnly: true
                             
@@ -176,7 +176,7 @@ ApplicationWindow {
                         TextField {
                             id: jumpAnimationField
                             Layout.fillWidth: true
-                            text: configManager.jumpAnimationPath
+                            text: pathsText(configManager.jumpAnimationPaths)
                             placeholderText: "选择跳跃动画文件夹"
                             readOnly: true
                             
@@ -619,26 +619,45 @@ ApplicationWindow {
     }
     
     // Functions
+
+    // Animation frame lists are shown as one comma-separated field
+    function pathsText(paths) {
+        return paths.join(", ")
+    }
+
+    function parsePaths(text) {
+        return text.split(",").map(function(path) { return path.trim() })
+                              .filter(function(path) { return path.length > 0 })
+    }
+
     function applySettings() {
-        // Apply all settings
+        // Apply all settings as one batch: each changed value notifies once, on commit
+        configManager.beginUpdate()
         configManager.spriteImagePath = spriteImageField.text
-        configManager.moveAnimationPath = moveAnimationField.text
-        configManager.jumpAnimationPath = jumpAnimationField.text
+        // Untouched fields are not written back: a path containing ',' would not survive the split
+        var moveBefore = configManager.moveAnimationPaths
+        var moveEdited = moveAnimationField.text !== pathsText(moveBefore)
+        if (moveEdited) {
+            configManager.moveAnimationPaths = parsePaths(moveAnimationField.text)
+        }
+        if (jumpAnimationField.text !== pathsText(configManager.jumpAnimationPaths)) {
+            configManager.jumpAnimationPaths = parsePaths(jumpAnimationField.text)
+        }
         configManager.position = Qt.point(positionXSpinBox.value, positionYSpinBox.value)
         configManager.backgroundColor = backgroundColorField.text
         configManager.opacity = opacitySlider.value
         configManager.fontColor = fontColorField.text
         configManager.alwaysOnTop = alwaysOnTopCheckBox.checked
+        configManager.commit()
+
+        // Round trip: Apply with the field untouched keeps the frame list as it was
+        console.assert(moveEdited || configManager.moveAnimationPaths.length === moveBefore.length
+                       && pathsText(configManager.moveAnimationPaths) === pathsText(moveBefore),
+                       "Apply changed the move animation frames")
         
-        // Save configuration
+        // Save configuration; the sprite controller already follows the change signals
         configManager.saveConfig()
         
-        // Update sprite controller
-        spriteController.setDefaultImagePath(configManager.spriteImagePath)
-        spriteController.setMoveAnimationPath(configManager.moveAnimationPath)
-        spriteController.setJumpAnimationPath(configManager.jumpAnimationPath)
-        spriteController.position = configManager.position
-        
         isModified = false
         
         console.log("Settings applied successfully")
@@ -649,8 +668,8 @@ ApplicationWindow {
         
         // Update UI
         spriteImageField.text = configManager.spriteImagePath
-        moveAnimationField.text = configManager.moveAnimationPath
-        jumpAnimationField.text = configManager.jumpAnimationPath
+        moveAnimationField.text = pathsText(configManager.moveAnimationPaths)
+        jumpAnimationField.text = pathsText(configManager.jumpAnimationPaths)
         positionXSpinBox.value = configManager.position.x
         positionYSpinBox.value = configManager.position.y
         backgroundColorField.text = configManager.backgroundColor
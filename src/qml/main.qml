@@ -1,7 +1,6 @@
 import QtQuick 2.15
 import QtQuick.Window 2.15
 import QtQuick.Controls 2.15
-import QtGraphicalEffects 1.15
 import DesktopElf 1.0
 
 ApplicationWindow {
@@ -27,18 +26,8 @@ ApplicationWindow {
     property var fitnessWindow: null
     property var fitnessWindow2: null
 
-    // Window positioning
-    x: spriteController.position.x
-    y: spriteController.position.y
-
-    // Update window position when sprite position changes
-    Connections {
-        target: spriteController
-        function onPositionChanged() {
-            mainWindow.x = spriteController.position.x
-            mainWindow.y = spriteController.position.y
-        }
-    }
+    // Window positioning is driven from C++: each sprite position update
+    // becomes a single native window move (see main.cpp)
 
     // Main sprite display
     Rectangle {
@@ -54,62 +43,52 @@ ApplicationWindow {
             }
         }
 
-        // Sprite image
-        AnimatedImage {
+        // Sprite frames, drawn from one atlas texture per animation with
+        // the drop shadow baked in at decode time
+        SpriteItem {
             id: spriteImage
             anchors.centerIn: parent
             width: 120
             height: 120
-            fillMode: Image.PreserveAspectFit
-            source: spriteController.currentImagePath
-            playing: true
-
-            // Handle static images
-            onStatusChanged: {
-                if (status === Image.Error) {
-                    console.log("Failed to load image:", source)
-                }
-            }
-        }
-
-        // Fallback for static images when AnimatedImage fails
-        Image {
-            id: staticImage
-            anchors.centerIn: parent
-            width: 120
-            height: 120
-            fillMode: Image.PreserveAspectFit
-            source: spriteImage.status === Image.Error ? spriteController.currentImagePath : ""
-            visible: spriteImage.status === Image.Error
-        }
-
-        // Glow effect for sprite
-        DropShadow {
-            anchors.fill: spriteImage
-            source: spriteImage
-            radius: 8
-            samples: 16
-            color: "#40000000"
-            horizontalOffset: 2
-            verticalOffset: 2
-            z: -1  // Place behind the sprite
+            controller: spriteController
         }
 
         MouseArea {
             id: mouseArea
             anchors.fill: parent
             acceptedButtons: Qt.LeftButton | Qt.RightButton
+            hoverEnabled: true
 
             property point lastPos: Qt.point(0, 0)
+            property bool dragging: false
+
+            // A hovering cursor often means a click is coming: decode the jump ahead of it
+            onEntered: spriteController.prefetchState(SpriteController.JumpState)
 
             onPressed: (mouse) => {
                 lastPos = Qt.point(mouse.x, mouse.y)
             }
 
             onPositionChanged: (mouse) => {
+                // Hover also reports positions; only a pressed move drags
+                if (!pressed) {
+                    return
+                }
+
+                // The first real move enters the drag state, interrupting jumps and moves
+                if (!dragging) {
+                    dragging = true
+                    spriteController.beginDrag()
+                }
                 var delta = Qt.point(mouse.x - lastPos.x, mouse.y - lastPos.y)
-                mainWindow.x += delta.x
-                mainWindow.y += delta.y
+                spriteController.position = Qt.point(mainWindow.x + delta.x, mainWindow.y + delta.y)
+            }
+
+            onReleased: {
+                if (dragging) {
+                    dragging = false
+                    spriteController.endDrag()
+                }
             }
 
             onClicked: {
@@ -120,6 +99,12 @@ ApplicationWindow {
         }
     }
 
+    // Companion sprites share this window's clock and frame cache
+    Overlay {
+        id: companionOverlay
+        visible: spriteManager.count > 0 && mainWindow.visible
+    }
+
     // Context menu
     ContextMenu {
         id: contextMenu
@@ -187,7 +172,7 @@ ApplicationWindow {
     // Animation effects
     SequentialAnimation {
         id: jumpEffect
-        running: spriteController.isAnimating
+        running: spriteController.isAnimating && !spriteController.suspended
 
         ParallelAnimation {
             NumberAnimation {
@@ -239,9 +224,6 @@ ApplicationWindow {
         }
     }
 
-    onXChanged: console.log("Window X position changed to:", x)
-    onYChanged: console.log("Window Y position changed to:", y)
-
     Component.onCompleted: {
         console.log("Desktop elf main window loaded")
         console.log("Initial sprite position:", spriteController.position)
@@ -257,6 +239,7 @@ ApplicationWindow {
 
         x = posX
         y = posY
+        spriteController.position = Qt.point(posX, posY)
 
         console.log("Window positioned at:", x, y)
         console.log("Window visible:", visible)